@@ -0,0 +1,137 @@
+#pragma once
+#include "Profiler.h"
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+// Per-block execution time of the audio callback, as a share of the block's
+// deadline (block size / sample rate): 1.0 is a miss.
+//
+// Averages hide the blocks that drop out (the filter's NaN recovery, the
+// first blocks after a mode switch, a reverb that starts a tail), so every
+// block is binned and counted. Each octave from 2^-10 to 4 deadlines is
+// split into 16 equal bins: the bin index is the float's exponent and top
+// four mantissa bits, so recording costs no libm call. Percentiles report
+// the bin's upper edge, at most 1/16 (6.25%) above the true value; Max()
+// and the miss count are exact.
+//
+// The worst block of every kWindowBlocks is also published on its own, for
+// the quality governor (QualityGovernor.h) to react to recent load.
+//
+// Written by the callback only; the main loop reads while it runs, so a
+// readout may be one block out of step across its fields.
+class BlockLoadHistogram {
+public:
+  static constexpr int kBinsPerOctave = 16;
+  static constexpr int kMinExponent = -10; // Loads below 2^-10 share bin 0
+  static constexpr int kOctaves = 12;      // Up to 4 deadlines
+  static constexpr int kBins = kBinsPerOctave * kOctaves;
+  static constexpr uint32_t kWindowBlocks = 32;
+
+  // Not while the callback records
+  void Reset() {
+    memset(bins_, 0, sizeof(bins_));
+    blocks_ = 0;
+    misses_ = 0;
+    max_ = 0.0f;
+    window_peak_ = 0.0f;
+    window_fill_ = 0;
+    window_max_ = 0.0f;
+    windows_.store(0, std::memory_order_relaxed);
+  }
+
+  // Callback: one block that took `load` deadlines
+  void Record(float load) {
+    bins_[Bin(load)]++;
+    blocks_++;
+    misses_ += load > 1.0f;
+    if (load > max_)
+      max_ = load;
+    if (load > window_peak_)
+      window_peak_ = load;
+    if (++window_fill_ == kWindowBlocks) {
+      window_max_ = window_peak_;
+      windows_.store(windows_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+      window_peak_ = 0.0f;
+      window_fill_ = 0;
+    }
+  }
+
+  uint32_t Blocks() const { return blocks_; }
+  uint32_t Misses() const { return misses_; }
+  float Max() const { return max_; }
+
+  // Windows completed so far, and the worst load of the latest one (read
+  // after Windows(); a newer window may have replaced it)
+  uint32_t Windows() const { return windows_.load(std::memory_order_acquire); }
+  float WindowMax() const { return window_max_; }
+
+  // Load not exceeded by a share `q` (0..1) of the blocks, rounded up to the
+  // bin edge and capped at Max(); 0 before any block
+  float Percentile(float q) const {
+    uint32_t blocks = blocks_;
+    if (blocks == 0)
+      return 0.0f;
+    uint32_t rank = (uint32_t)(q * (float)blocks + 0.5f);
+    if (rank < 1)
+      rank = 1;
+    uint32_t seen = 0;
+    int bin = 0;
+    for (; bin < kBins - 1; bin++) {
+      seen += bins_[bin];
+      if (seen >= rank)
+        break;
+    }
+    // The last bin is open-ended: anything there is bounded by the maximum
+    float edge = bin < kBins - 1 ? UpperEdge(bin) : max_;
+    return edge < max_ ? edge : max_;
+  }
+
+private:
+  // Biased exponent and top four mantissa bits of the lowest bin
+  static constexpr uint32_t kBase = (uint32_t)(127 + kMinExponent) << 4;
+
+  static int Bin(float load) {
+    uint32_t bits;
+    memcpy(&bits, &load, sizeof(bits));
+    uint32_t key = bits >> 19; // Sign, exponent, four mantissa bits
+    if (key < kBase) // Below 2^-10, including 0
+      return 0;
+    key -= kBase;
+    return key < (uint32_t)kBins ? (int)key : kBins - 1;
+  }
+
+  static float UpperEdge(int bin) {
+    uint32_t bits = (kBase + (uint32_t)bin + 1) << 19;
+    float edge;
+    memcpy(&edge, &bits, sizeof(edge));
+    return edge;
+  }
+
+  uint32_t bins_[kBins] = {};
+  uint32_t blocks_ = 0;
+  uint32_t misses_ = 0;
+  float max_ = 0.0f;
+  float window_peak_ = 0.0f; // Of the window being filled
+  uint32_t window_fill_ = 0;
+  float window_max_ = 0.0f; // Of the last complete window
+  std::atomic<uint32_t> windows_{0};
+};
+
+// Times the enclosing callback into `histogram` against `deadline_ticks`
+// (profiler clock ticks per block)
+class BlockTimer {
+public:
+  BlockTimer(BlockLoadHistogram &histogram, float deadline_ticks)
+      : histogram_(histogram), deadline_ticks_(deadline_ticks),
+        start_(profiler::Now()) {}
+  ~BlockTimer() {
+    histogram_.Record((float)(profiler::Now() - start_) / deadline_ticks_);
+  }
+
+private:
+  BlockLoadHistogram &histogram_;
+  float deadline_ticks_;
+  uint32_t start_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include "LookupTable.h"
+
+// Exponential knob curves of the modes, tabulated at compile time.
+//
+// Each maps a knob position (0..1) to lo * (hi / lo)^x. MapControls evaluates
+// them in the main loop whenever a knob moves; a cubic lookup in a small
+// flash table replaces powf/Exp2 there. `legio_host -B controls` bounds the
+// table error against the curves.
+namespace control_curves {
+
+template <typename Range> struct ExpCurve {
+  static constexpr double Eval(double x) {
+    return Range::kLo * lut::Exp(x * lut::Log(Range::kHi / Range::kLo));
+  }
+};
+
+// ModeFilterDrive cutoff: 5 Hz .. 18 kHz (fmap LOG), deep sub-bass control
+struct FilterCutoff {
+  static constexpr double kLo = 5.0;
+  static constexpr double kHi = 18000.0;
+};
+
+// ModeSpaceEcho first-head time with the Long heads: 0.5 .. 32 s
+struct EchoLongTime {
+  static constexpr double kLo = 0.5;
+  static constexpr double kHi = 32.0;
+};
+
+// ModeShepardTone speed: 0.01 .. 1 octave per second
+struct ShepardSpeed {
+  static constexpr double kLo = 0.01;
+  static constexpr double kHi = 1.0;
+};
+
+// ModeConvolution wet low-pass: 800 Hz .. 16 kHz
+struct ConvolutionTone {
+  static constexpr double kLo = 800.0;
+  static constexpr double kHi = 16000.0;
+};
+
+// 64 intervals keep the cubic lookup within 1.5e-4 of every curve (0.003
+// semitones), largest at the top end where the lookup stops just short of
+// the last point
+static constexpr int kCurvePoints = 64;
+typedef LookupTable<kCurvePoints> CurveTable;
+
+// Generated by the compiler, stored in flash
+static constexpr CurveTable kFilterCutoffTable =
+    CurveTable::Generate<ExpCurve<FilterCutoff>>(0.0, 1.0);
+static constexpr CurveTable kEchoLongTimeTable =
+    CurveTable::Generate<ExpCurve<EchoLongTime>>(0.0, 1.0);
+static constexpr CurveTable kShepardSpeedTable =
+    CurveTable::Generate<ExpCurve<ShepardSpeed>>(0.0, 1.0);
+static constexpr CurveTable kConvolutionToneTable =
+    CurveTable::Generate<ExpCurve<ConvolutionTone>>(0.0, 1.0);
+
+} // namespace control_curves
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Control hand-off from the main loop to the audio callback.
+//
+// The main loop scans the panel into a ControlFrame, each mode maps it to
+// its control targets (MapControls: curves, switch decoding, coefficients
+// that only change with a switch) and the targets are published as one
+// ControlSnapshot. The callback reads the latest snapshot and only smooths
+// towards it (ApplyControls). Mode switches are requested through a
+// CommandQueue. Both are single-producer (main loop), single-consumer
+// (audio interrupt) and lock-free: the callback never waits on the main
+// loop.
+//
+// Knob readings go through a hysteresis and switch reads through a
+// debounce, and a frame where nothing moved is neither remapped nor
+// republished: the callback then keeps applying the same targets, and each
+// mode rebuilds coefficients only when a target or its smoothed value
+// changes.
+
+// Panel state scanned once per main-loop pass
+struct ControlFrame {
+  float knob_top = 0.0f;
+  float knob_bottom = 0.0f;
+  int sw_left = 0; // 2=Top, 1=Mid, 0=Bot
+  int sw_right = 0;
+  int32_t encoder = 0; // Detents since the previous frame
+
+  // Knobs and switches (not the encoder) as in `other`
+  bool SamePanel(const ControlFrame &other) const {
+    return knob_top == other.knob_top && knob_bottom == other.knob_bottom &&
+           sw_left == other.sw_left && sw_right == other.sw_right;
+  }
+};
+
+// Knob reading held until it moves more than kHysteresis away, so ADC noise
+// does not change the frame (and remap, republish and rebuild coefficients)
+// on every pass. Readings within kHysteresis of the ends snap to 0 and 1 so
+// the whole range stays reachable.
+class KnobHysteresis {
+public:
+  static constexpr float kHysteresis = 1.0f / 512.0f; // ~8 LSB at 12 bits
+
+  float Process(float raw) {
+    float x = raw < kHysteresis          ? 0.0f
+              : raw > 1.0f - kHysteresis ? 1.0f
+                                         : raw;
+    if (x == 0.0f || x == 1.0f || x - held_ > kHysteresis ||
+        held_ - x > kHysteresis)
+      held_ = x;
+    return held_;
+  }
+
+  void Reset() { held_ = -1.0f; }
+
+private:
+  float held_ = -1.0f; // Nothing held: the first reading passes
+};
+
+// Switch position accepted once two consecutive reads agree, so contact
+// bounce between positions never reaches the modes (one scan of latency)
+class SwitchDebounce {
+public:
+  int Process(int raw) {
+    if (raw == last_ || held_ < 0)
+      held_ = raw;
+    last_ = raw;
+    return held_;
+  }
+
+  void Reset() { held_ = last_ = -1; }
+
+private:
+  int held_ = -1; // Nothing held: the first read passes
+  int last_ = -1;
+};
+
+// Double-buffered value published with one atomic index swap.
+//
+// Publish() copies into the slot the consumer is not pointed at, then
+// releases the new index; Read() acquires it. Two slots suffice because the
+// consumer is an interrupt the producer cannot preempt: a read always
+// completes within one callback, before the producer can touch that slot
+// again. Read() references must not be kept across callbacks.
+template <typename T> class ControlSnapshot {
+public:
+  // Producer
+  void Publish(const T &value) {
+    uint32_t back = 1 - front_.load(std::memory_order_relaxed);
+    slots_[back] = value;
+    front_.store(back, std::memory_order_release);
+  }
+
+  // Consumer: the latest published value
+  const T &Read() const {
+    return slots_[front_.load(std::memory_order_acquire)];
+  }
+
+private:
+  T slots_[2] = {};
+  std::atomic<uint32_t> front_{0};
+};
+
+// Bounded single-producer single-consumer ring of commands. Head and tail
+// are free-running counters, each written by one side only; kSize is a
+// power of two.
+template <typename T, size_t kSize> class CommandQueue {
+  static_assert((kSize & (kSize - 1)) == 0, "kSize must be a power of two");
+
+public:
+  // Producer: false if full
+  bool Push(const T &command) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kSize)
+      return false;
+    slots_[head & (kSize - 1)] = command;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: false if empty
+  bool Pop(T &command) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    command = slots_[tail & (kSize - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T slots_[kSize];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
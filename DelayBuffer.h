@@ -0,0 +1,174 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+
+// Circular delay line with a mirrored guard region.
+//
+// The first `guard` samples of the line are mirrored past its end, so any
+// span of up to `guard` samples starting inside the line is contiguous in
+// memory: interpolated reads and ReadBlock never test for the wrap, and
+// WriteBlock/ReadBlock move whole runs (SDRAM bursts) with memcpy.
+//
+// Storage is supplied by the owner (BufferSize() floats), like ReverbAllpass.
+// Read semantics follow daisysp::DelayLine: after a Write, Read(1) returns
+// that sample, Read(d) the one written d - 1 writes earlier, and delays run
+// up to length - guard.
+class DelayBuffer {
+public:
+  // Guard needed by the 4-point Hermite read alone
+  static constexpr size_t kHermiteGuard = 4;
+
+  static constexpr size_t BufferSize(size_t length, size_t guard) {
+    return length + guard;
+  }
+
+  // `guard` is the longest ReadBlock/WriteBlock the owner will issue (at
+  // least kHermiteGuard). Storage that is already zero (MemoryArena
+  // allocations) can skip the clear.
+  void Init(float *buffer, size_t length, size_t guard, bool clear = true) {
+    buf_ = buffer;
+    length_ = length;
+    guard_ = guard < kHermiteGuard ? kHermiteGuard : guard;
+    write_ = 0;
+    if (clear)
+      memset(buf_, 0, BufferSize(length_, guard_) * sizeof(float));
+  }
+
+  size_t Length() const { return length_; }
+
+  inline void Write(float x) {
+    buf_[write_] = x;
+    if (write_ < guard_)
+      buf_[write_ + length_] = x;
+    write_ = write_ + 1 == length_ ? 0 : write_ + 1;
+  }
+
+  // Appends `n` (<= guard) samples in chronological order
+  void WriteBlock(const float *in, size_t n) {
+    size_t first = length_ - write_;
+    if (first > n)
+      first = n;
+    CopyIn(write_, in, first);
+    if (first < n)
+      CopyIn(0, in + first, n - first);
+    write_ += n;
+    if (write_ >= length_)
+      write_ -= length_;
+  }
+
+  // In place of WriteBlock: the caller writes the next `n` (<= guard)
+  // samples straight into WriteSpan(), in chronological order, then calls
+  // Advance(n). The span never wraps: samples past the end land in the
+  // mirror and Advance copies them to the start, so only writes at either
+  // end of the line copy anything. Reads of other positions stay valid.
+  float *WriteSpan() { return buf_ + write_; }
+
+  void Advance(size_t n) {
+    size_t end = write_ + n;
+    if (end > length_)
+      memcpy(buf_, buf_ + length_, (end - length_) * sizeof(float));
+    if (write_ < guard_)
+      memcpy(buf_ + length_ + write_, buf_ + write_,
+             ((end < guard_ ? end : guard_) - write_) * sizeof(float));
+    write_ = end >= length_ ? end - length_ : end;
+  }
+
+  inline float Read(size_t delay) const { return buf_[Index(delay)]; }
+
+  // Linear interpolation, fraction towards older samples
+  inline float Read(float delay) const {
+    size_t di = (size_t)delay;
+    float df = delay - (float)di;
+    const float *p = buf_ + Index(di + 1); // p[1] = a, p[0] = b (older)
+    return p[1] + (p[0] - p[1]) * df;
+  }
+
+  // 4-point Hermite, same polynomial as daisysp::DelayLine::ReadHermite
+  inline float ReadHermite(float delay) const {
+    size_t di = (size_t)delay;
+    float f = delay - (float)di;
+    const float *p = buf_ + Index(di + 2); // Oldest of the four points
+    const float x2 = p[0];
+    const float x1 = p[1];
+    const float x0 = p[2];
+    const float xm1 = p[3];
+    const float c = (x1 - xm1) * 0.5f;
+    const float v = x0 - x1;
+    const float w = c + v;
+    const float a = w + v + (x2 - x0) * 0.5f;
+    const float b_neg = w + a;
+    return (((a * f) - b_neg) * f + c) * f + x0;
+  }
+
+  // The same Hermite read split in two, for several taps that share a
+  // fraction (heads at whole-sample distances on one tape): the fraction's
+  // weights are computed once, then each tap is four loads and a dot product
+  struct HermiteTap {
+    size_t delay; // Whole samples
+    float w[4];   // Weights of the four points, oldest first
+  };
+
+  static inline HermiteTap HermiteSetup(float delay) {
+    HermiteTap tap;
+    tap.delay = (size_t)delay;
+    const float f = delay - (float)tap.delay;
+    const float f2 = f * f;
+    const float f3 = f2 * f;
+    tap.w[0] = 0.5f * (f3 - f2);
+    tap.w[1] = -1.5f * f3 + 2.0f * f2 + 0.5f * f;
+    tap.w[2] = 1.5f * f3 - 2.5f * f2 + 1.0f;
+    tap.w[3] = -0.5f * f3 + f2 - 0.5f * f;
+    return tap;
+  }
+
+  // ReadHermite(delay + extra) for the `delay` given to HermiteSetup
+  inline float ReadHermite(const HermiteTap &tap, size_t extra) const {
+    return Interpolate(tap, buf_ + Index(tap.delay + extra + 2));
+  }
+
+  // The tap over four points already in memory, oldest first (a span
+  // fetched with ReadBlock from this or a block-coded line)
+  static inline float Interpolate(const HermiteTap &tap, const float *p) {
+    return tap.w[0] * p[0] + tap.w[1] * p[1] + tap.w[2] * p[2] +
+           tap.w[3] * p[3];
+  }
+
+  // out[i] = Read(delay - i), i.e. `n` (<= guard) consecutive samples in
+  // chronological order starting `delay` samples back
+  void ReadBlock(float *out, size_t n, size_t delay) const {
+    memcpy(out, Span(delay), n * sizeof(float));
+  }
+
+  // out[i] += gain * Read(delay - i), the same span as ReadBlock summed in
+  // place (multi-tap outputs)
+  void AddBlock(float *out, size_t n, size_t delay, float gain) const {
+    const float *p = Span(delay);
+    for (size_t i = 0; i < n; i++)
+      out[i] += gain * p[i];
+  }
+
+  // The span ReadBlock copies, in place: p[i] = Read(delay - i) for i below
+  // the guard. Valid until the next write.
+  const float *Span(size_t delay) const { return buf_ + Index(delay); }
+
+private:
+  float *buf_;
+  size_t length_;
+  size_t guard_;
+  size_t write_; // Next write position
+
+  // Position of the sample `delay` writes back; one conditional add instead
+  // of a modulo
+  inline size_t Index(size_t delay) const {
+    return write_ >= delay ? write_ - delay : write_ + length_ - delay;
+  }
+
+  // Writes a run that does not cross the end and refreshes the mirror
+  void CopyIn(size_t pos, const float *in, size_t n) {
+    memcpy(buf_ + pos, in, n * sizeof(float));
+    if (pos < guard_) {
+      size_t m = guard_ - pos;
+      memcpy(buf_ + length_ + pos, in, (m < n ? m : n) * sizeof(float));
+    }
+  }
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include "FastMath.h"
+#include "LookupTable.h"
+#include "daisy_legio.h"
+
+// Drive-stage waveshapers of ModeFilterDrive.
+//
+// The soft clip and the wavefolder are tabulated at compile time from the
+// analytic curves below; the tables are copied once into DTCM (zero wait
+// states, never evicted from the data cache) so the oversampled drive loop
+// costs one interpolated lookup per sample. The hard clip stays analytic:
+// one VSQRT and a divide on the M7, exact and no slower than a cubic
+// lookup. `legio_host -B shapers` bounds the table error against the curves.
+namespace drive_shapers {
+
+// Warm: smoother asymmetric clipping with gradual knee (tanh-like curve).
+// Constant 0.85 / -0.45 outside +/-1.5, handled by the caller.
+struct SoftClipCurve {
+  static constexpr double kRange = 1.5;
+
+  static constexpr double Eval(double x) {
+    return x > 0.0 ? 0.7 * x + 0.3 * x * lut::Exp(-x * x)
+                   : 0.5 * x + 0.5 * x * lut::Exp(-x * x * 0.5);
+  }
+};
+
+// Destroy: multi-stage wavefolder with cubic interpolation for smoother,
+// more musical folds. Input is clamped to +/-kRange, which the table does.
+struct WavefoldCurve {
+  static constexpr double kRange = 5.0; // Input clamp
+  static constexpr double kStage2Gain = 1.5;
+  static constexpr double kStage3Gain = 1.2;
+  static constexpr double kOutputScale = 0.7;
+
+  static constexpr double Eval(double x) {
+    // Safety Clamp: Impide que entren valores locos que hagan explotar el
+    // algoritmo
+    if (x > kRange)
+      x = kRange;
+    if (x < -kRange)
+      x = -kRange;
+
+    // Stage 1
+    if (x > 1.0)
+      x = 2.0 - x;
+    else if (x < -1.0)
+      x = -2.0 - x;
+
+    // Stage 2 (with gain boost and cubic folding for smoother harmonics)
+    x *= kStage2Gain;
+    if (x > 1.0) {
+      double overshoot = x - 1.0;
+      x = 1.0 - (overshoot * overshoot * overshoot); // Cubic fold
+    } else if (x < -1.0) {
+      double overshoot = -x - 1.0;
+      x = -1.0 + (overshoot * overshoot * overshoot); // Cubic fold
+    }
+
+    // Stage 3 (subtle fold for complexity)
+    x *= kStage3Gain;
+    if (x > 1.0)
+      x = 2.0 - x;
+    else if (x < -1.0)
+      x = -2.0 - x;
+
+    return x * kOutputScale; // Scale down to prevent clipping
+  }
+};
+
+// Table sizes: the smooth curves use cubic lookup, the folder has kinks
+// (cubic would ring around them) and uses a denser linear table
+static constexpr int kSoftClipPoints = 256;
+static constexpr int kWavefoldPoints = 2048;
+
+typedef LookupTable<kSoftClipPoints> SoftClipTable;
+typedef LookupTable<kWavefoldPoints> WavefoldTable;
+
+// Generated by the compiler, stored in flash
+static constexpr SoftClipTable kSoftClipTable =
+    SoftClipTable::Generate<SoftClipCurve>(-SoftClipCurve::kRange,
+                                           SoftClipCurve::kRange);
+static constexpr WavefoldTable kWavefoldTable =
+    WavefoldTable::Generate<WavefoldCurve>(-WavefoldCurve::kRange,
+                                           WavefoldCurve::kRange);
+
+struct Tables {
+  SoftClipTable soft_clip;
+  WavefoldTable wavefold;
+};
+
+// Working copy in fast internal RAM, filled by Init(). A function-local
+// static: one copy for every translation unit that includes this header
+inline Tables &GetTables() {
+  static Tables tables DTCM_MEM_SECTION;
+  return tables;
+}
+
+inline void Init() {
+  static bool loaded = false;
+  if (loaded)
+    return;
+  Tables &tables = GetTables();
+  tables.soft_clip = kSoftClipTable;
+  tables.wavefold = kWavefoldTable;
+  loaded = true;
+}
+
+inline float SoftClip(float x) {
+  if (x > (float)SoftClipCurve::kRange)
+    return 0.85f;
+  if (x < -(float)SoftClipCurve::kRange)
+    return -0.45f;
+  return GetTables().soft_clip.Cubic(x);
+}
+
+// Hard: x / sqrt(1 + x^2)
+inline float Hard(float x) {
+  return x / fastmath::Sqrt<fastmath::Tier::kAccurate>(1.0f + x * x);
+}
+
+inline float Wavefold(float x) {
+  return GetTables().wavefold.Linear(x);
+}
+
+} // namespace drive_shapers
@@ -0,0 +1,188 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+
+// Fast approximations of the transcendentals used in the audio paths.
+//
+// Every function takes an accuracy tier as a template parameter so each mode
+// can pick its own trade-off at compile time:
+//   Tier::kLibm     - calls libm, for reference and A/B listening
+//   Tier::kAccurate - error close to float resolution, a few times faster
+//   Tier::kFast     - audibly transparent in most uses, cheapest
+//
+// Maximum errors below are measured by `legio_host -B math`, which fails if
+// any of them is exceeded.
+namespace fastmath {
+
+enum class Tier { kLibm, kAccurate, kFast };
+
+static constexpr float kLog2E = 1.44269504088896341f;
+static constexpr float kTwoPi = 6.28318530717958647692f;
+static constexpr float kInvTwoPi = 0.159154943091895336f;
+
+union FloatBits {
+  float f;
+  int32_t i;
+};
+
+// 2^x, relative error: kAccurate 2e-7, kFast 8e-5 (|x| < 126)
+template <Tier T> inline float Exp2(float x) {
+  if (T == Tier::kLibm)
+    return exp2f(x);
+
+  if (x > 126.0f)
+    x = 126.0f;
+  if (x < -126.0f)
+    x = -126.0f;
+
+  // Split into integer and fractional part (floor, without libm)
+  int32_t xi = (int32_t)x;
+  if (x < (float)xi)
+    xi--;
+  float f = x - (float)xi;
+
+  // Minimax polynomial for 2^f on [0, 1)
+  float p;
+  if (T == Tier::kAccurate) {
+    p = 9.999999251e-01f +
+        f * (6.931530731e-01f +
+             f * (2.401536178e-01f +
+                  f * (5.582631576e-02f +
+                       f * (8.989342781e-03f + f * 1.877575574e-03f))));
+  } else {
+    p = 9.999252200e-01f +
+        f * (6.958335092e-01f + f * (2.260672467e-01f + f * 7.802445852e-02f));
+  }
+
+  // Scale by 2^xi directly in the exponent field
+  FloatBits u;
+  u.f = p;
+  u.i += xi << 23;
+  return u.f;
+}
+
+// e^x, relative error over |x| <= 10: kAccurate 6e-7, kFast 8e-5
+template <Tier T> inline float Exp(float x) {
+  if (T == Tier::kLibm)
+    return expf(x);
+  return Exp2<T>(x * kLog2E);
+}
+
+// log2(x) for x > 0, absolute error: kAccurate 6e-7, kFast 1e-4
+template <Tier T> inline float Log2(float x) {
+  if (T == Tier::kLibm)
+    return log2f(x);
+
+  // x = m * 2^e with m folded into [sqrt(0.5), sqrt(2))
+  FloatBits u;
+  u.f = x;
+  int32_t e = ((u.i >> 23) & 0xFF) - 127;
+  u.i = (u.i & 0x007FFFFF) | 0x3F800000;
+  float m = u.f;
+  if (m > 1.41421356f) {
+    m *= 0.5f;
+    e++;
+  }
+
+  // log2(m) = 2/ln2 * atanh(s), s = (m - 1) / (m + 1), |s| < 0.172
+  float s = (m - 1.0f) / (m + 1.0f);
+  float s2 = s * s;
+  float p;
+  if (T == Tier::kAccurate)
+    p = 2.885390082f +
+        s2 * (0.961796694f + s2 * (0.577078016f + s2 * 0.412198583f));
+  else
+    p = 2.885390082f + s2 * 0.961796694f;
+  return (float)e + s * p;
+}
+
+// base^x for base > 0 (Exp2 and Log2 errors combine)
+template <Tier T> inline float Pow(float base, float x) {
+  if (T == Tier::kLibm)
+    return powf(base, x);
+  return Exp2<T>(x * Log2<T>(base));
+}
+
+// sin(2 * pi * t) with t in turns (any range within +/-2^22), absolute
+// error: kAccurate 1e-6, kFast 7e-5
+template <Tier T> inline float SinTurns(float t) {
+  if (T == Tier::kLibm)
+    return sinf(t * kTwoPi);
+
+  // Reduce to [-0.5, 0.5] turns, then fold onto the quarter wave
+  t -= (float)(int32_t)(t + (t >= 0.0f ? 0.5f : -0.5f));
+  if (t > 0.25f)
+    t = 0.5f - t;
+  else if (t < -0.25f)
+    t = -0.5f - t;
+
+  float t2 = t * t;
+  if (T == Tier::kAccurate)
+    return t * (6.283164046e+00f +
+                t2 * (-4.133714251e+01f +
+                      t2 * (8.134077283e+01f + t2 * -7.099346701e+01f)));
+  return t * (6.281280159e+00f +
+              t2 * (-4.109524714e+01f + t2 * 7.358556723e+01f));
+}
+
+// cos(2 * pi * t), same error as SinTurns
+template <Tier T> inline float CosTurns(float t) {
+  if (T == Tier::kLibm)
+    return cosf(t * kTwoPi);
+  return SinTurns<T>(t + 0.25f);
+}
+
+// sin(x) with x in radians
+template <Tier T> inline float Sin(float x) {
+  if (T == Tier::kLibm)
+    return sinf(x);
+  return SinTurns<T>(x * kInvTwoPi);
+}
+
+// tanh(x), absolute error: kAccurate 2e-7, kFast 2.4e-2
+template <Tier T> inline float Tanh(float x) {
+  if (T == Tier::kLibm)
+    return tanhf(x);
+
+  if (T == Tier::kAccurate) {
+    // tanh(x) = (e^2x - 1) / (e^2x + 1), saturated where it reaches 1.0f
+    if (x > 9.0f)
+      x = 9.0f;
+    if (x < -9.0f)
+      x = -9.0f;
+    float e = Exp2<T>(x * (2.0f * kLog2E));
+    return (e - 1.0f) / (e + 1.0f);
+  }
+
+  // Rational [3/2] Pade approximant, exactly +/-1 at +/-3
+  if (x > 3.0f)
+    return 1.0f;
+  if (x < -3.0f)
+    return -1.0f;
+  float x2 = x * x;
+  return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+// 1 / sqrt(x) for x > 0, relative error: kAccurate 1e-7 (hardware sqrt),
+// kFast 1.8e-3 (bit estimate + one Newton step)
+template <Tier T> inline float InvSqrt(float x) {
+  if (T == Tier::kLibm)
+    return 1.0f / sqrtf(x);
+  if (T == Tier::kAccurate)
+    return 1.0f / __builtin_sqrtf(x);
+
+  FloatBits u;
+  u.f = x;
+  u.i = 0x5F375A86 - (u.i >> 1);
+  return u.f * (1.5f - 0.5f * x * u.f * u.f);
+}
+
+// sqrt(x) for x >= 0, relative error 1e-7 in both tiers: the Cortex-M7 FPU
+// square root (VSQRT) is already cheaper than any estimate plus refinement
+template <Tier T> inline float Sqrt(float x) {
+  if (T == Tier::kLibm)
+    return sqrtf(x);
+  return __builtin_sqrtf(x);
+}
+
+} // namespace fastmath
@@ -0,0 +1,158 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Impulse responses for the convolution mode, synthesised at activation.
+//
+// No recordings ship with the firmware, so each IR is modelled on the
+// structure of the real device: a plate is a dense noise tail whose highs
+// die first, a spring a train of dispersive chirps at its round-trip time
+// that darken on every pass, a room a few early reflections ahead of a
+// short diffuse tail. Each channel is generated on its own (decorrelated
+// seeds and spring lengths) and normalised to unit energy. A recorded IR
+// can replace any of them: the convolver only sees the samples.
+namespace impulse_responses {
+
+enum class Ir { kRoom, kSpring, kPlate }; // Switch positions 0..2
+
+static constexpr int kIrCount = 3;
+
+static constexpr float Seconds(Ir ir) {
+  return ir == Ir::kPlate ? 2.0f : ir == Ir::kSpring ? 1.6f : 1.0f;
+}
+
+static constexpr float kMaxSeconds = 2.0f;
+
+static constexpr size_t Length(Ir ir, float sample_rate) {
+  return (size_t)(Seconds(ir) * sample_rate);
+}
+
+namespace detail {
+
+// Uniform in [-1, 1)
+inline float Noise(uint32_t &state) {
+  state = state * 1664525u + 1013904223u;
+  return (float)(int32_t)state * (1.0f / 2147483648.0f);
+}
+
+// Zero below -300 dB: the ringing tails of the filters below would
+// otherwise decay into denormals, which are slow on the host
+inline float Flush(float x) { return fabsf(x) < 1.0e-15f ? 0.0f : x; }
+
+// One-pole low-pass coefficient for `freq`
+inline float OnePole(float freq, float sample_rate) {
+  return 1.0f - expf(-6.2831853f * freq / sample_rate);
+}
+
+// Gain per sample for a 60 dB decay over `t60` seconds
+inline float DecayPerSample(float t60, float sample_rate) {
+  return expf(-6.9077553f / (t60 * sample_rate));
+}
+
+// Dense tail: noise under an exponential decay, low-passed by a cutoff that
+// glides from `bright` to `dark` over the IR (high frequencies decay first)
+inline void Tail(float *out, size_t length, float sample_rate, float t60,
+                 float bright, float dark, uint32_t seed, float gain) {
+  float env = gain;
+  float decay = DecayPerSample(t60, sample_rate);
+  // The coefficient glides geometrically too: close enough below fs / 4
+  float coeff = OnePole(bright, sample_rate);
+  float glide = powf(OnePole(dark, sample_rate) / coeff, 1.0f / (float)length);
+  float lp = 0.0f;
+  for (size_t i = 0; i < length; i++) {
+    lp += coeff * (Noise(seed) - lp);
+    out[i] += lp * env;
+    env *= decay;
+    coeff *= glide;
+  }
+}
+
+inline void Plate(float *out, size_t length, float sample_rate, int channel) {
+  Tail(out, length, sample_rate, 2.2f, 14000.0f, 2500.0f,
+       0x9e3779b9u + (uint32_t)channel * 7919u, 1.0f);
+}
+
+// Round trips of the spring, each a chirp from a cascade of first-order
+// allpasses (dispersion: highs arrive first), darker and weaker per pass
+inline void Spring(float *out, size_t length, float sample_rate,
+                   int channel) {
+  constexpr int kStages = 80;
+  constexpr float kDispersion = 0.6f;
+  constexpr size_t kChirp = 2048; // Long enough for the cascade to ring out
+  float chirp[kChirp];
+  memset(chirp, 0, sizeof(chirp));
+  chirp[0] = 1.0f;
+  for (int s = 0; s < kStages; s++) {
+    float x1 = 0.0f, y1 = 0.0f;
+    for (size_t i = 0; i < kChirp; i++) {
+      float y = kDispersion * chirp[i] + x1 - kDispersion * y1;
+      x1 = chirp[i];
+      y1 = Flush(y);
+      chirp[i] = y1;
+    }
+  }
+
+  float trip = (channel == 0 ? 0.037f : 0.043f) * sample_rate;
+  float gain = DecayPerSample(1.8f, sample_rate);
+  float pass_gain = powf(gain, trip);
+  float pass_lp = OnePole(4500.0f, sample_rate);
+  float amp = 1.0f;
+  for (size_t at = 0; at < length; at += (size_t)trip) {
+    size_t n = length - at < kChirp ? length - at : kChirp;
+    for (size_t i = 0; i < n; i++)
+      out[at + i] += chirp[i] * amp;
+    // The next pass: reflected, attenuated and low-passed once more
+    amp *= -pass_gain;
+    float lp = 0.0f;
+    for (size_t i = 0; i < kChirp; i++) {
+      lp = Flush(lp + pass_lp * (chirp[i] - lp));
+      chirp[i] = lp;
+    }
+  }
+  // Some diffuse noise from the coupling between the coils
+  Tail(out, length, sample_rate, 1.6f, 5000.0f, 1500.0f,
+       0x85ebca6bu + (uint32_t)channel * 104729u, 0.02f);
+}
+
+inline void Room(float *out, size_t length, float sample_rate, int channel) {
+  static constexpr float kReflections[] = {0.011f, 0.017f, 0.023f, 0.031f,
+                                           0.038f, 0.047f, 0.053f, 0.061f};
+  uint32_t seed = 0xc2b2ae35u + (uint32_t)channel * 1299709u;
+  float amp = 0.6f;
+  for (float t : kReflections) {
+    size_t at = (size_t)((t + 0.002f * channel) * sample_rate);
+    if (at < length)
+      out[at] += amp * (Noise(seed) < 0.0f ? -1.0f : 1.0f);
+    amp *= 0.85f;
+  }
+  size_t onset = (size_t)(0.02f * sample_rate);
+  if (onset < length)
+    Tail(out + onset, length - onset, sample_rate, 0.9f, 9000.0f, 3000.0f,
+         seed, 0.15f);
+}
+
+} // namespace detail
+
+// One channel (0 = left, 1 = right) of `ir`: Length(ir, sample_rate)
+// samples into `out`
+inline void Generate(Ir ir, float sample_rate, int channel, float *out) {
+  size_t length = Length(ir, sample_rate);
+  memset(out, 0, length * sizeof(float));
+  if (ir == Ir::kPlate)
+    detail::Plate(out, length, sample_rate, channel);
+  else if (ir == Ir::kSpring)
+    detail::Spring(out, length, sample_rate, channel);
+  else
+    detail::Room(out, length, sample_rate, channel);
+
+  double energy = 0.0;
+  for (size_t i = 0; i < length; i++)
+    energy += (double)out[i] * out[i];
+  float norm = energy > 0.0 ? (float)(1.0 / sqrt(energy)) : 0.0f;
+  for (size_t i = 0; i < length; i++)
+    out[i] *= norm;
+}
+
+} // namespace impulse_responses
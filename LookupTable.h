@@ -0,0 +1,113 @@
+#pragma once
+#include <stddef.h>
+
+// Compile-time tabulated curves.
+//
+// A Curve is a struct with `static constexpr double Eval(double x)`; the table
+// is generated by the compiler (no runtime init cost, no libm) and looked up
+// with linear or Catmull-Rom cubic interpolation. Inputs are clamped to the
+// table range, so callers handle anything that should behave differently
+// outside it.
+namespace lut {
+
+// constexpr replacements for libm, double precision over the ranges the
+// curves use (libm is not constexpr)
+constexpr double Exp(double x) {
+  // Halve until |x| < 0.5, Taylor series, square back up
+  int halvings = 0;
+  while (x > 0.5 || x < -0.5) {
+    x *= 0.5;
+    halvings++;
+  }
+  double term = 1.0, sum = 1.0;
+  for (int k = 1; k < 16; k++) {
+    term *= x / k;
+    sum += term;
+  }
+  for (int i = 0; i < halvings; i++)
+    sum *= sum;
+  return sum;
+}
+
+constexpr double Log(double x) {
+  // x = m * 2^e with m in [0.75, 1.5), then the atanh series of m
+  if (x <= 0.0)
+    return -1.0e300;
+  int e = 0;
+  while (x >= 1.5) {
+    x *= 0.5;
+    e++;
+  }
+  while (x < 0.75) {
+    x *= 2.0;
+    e--;
+  }
+  double s = (x - 1.0) / (x + 1.0);
+  double term = s, sum = 0.0;
+  for (int k = 1; k < 40; k += 2) {
+    sum += term / k;
+    term *= s * s;
+  }
+  return 2.0 * sum + e * 0.69314718055994530942;
+}
+
+constexpr double Sqrt(double x) {
+  if (x <= 0.0)
+    return 0.0;
+  double r = x > 1.0 ? x : 1.0;
+  for (int i = 0; i < 64; i++)
+    r = 0.5 * (r + x / r);
+  return r;
+}
+
+} // namespace lut
+
+// N intervals over [lo, hi] (N + 1 points) plus one guard point on each side
+// so the cubic lookup never reads past the ends.
+template <int N> struct LookupTable {
+  float lo;
+  float hi;
+  float scale; // N / (hi - lo)
+  float y[N + 3];
+
+  template <typename Curve>
+  static constexpr LookupTable Generate(double lo, double hi) {
+    LookupTable t{};
+    t.lo = (float)lo;
+    t.hi = (float)hi;
+    t.scale = (float)(N / (hi - lo));
+    for (int i = -1; i <= N + 1; i++)
+      t.y[i + 1] = (float)Curve::Eval(lo + (hi - lo) * i / N);
+    return t;
+  }
+
+  inline float Linear(float x) const {
+    float pos = Position(x);
+    int i = (int)pos;
+    float f = pos - (float)i;
+    const float *p = y + i + 1;
+    return p[0] + f * (p[1] - p[0]);
+  }
+
+  inline float Cubic(float x) const {
+    float pos = Position(x);
+    int i = (int)pos;
+    float f = pos - (float)i;
+    const float *p = y + i + 1;
+    float c1 = 0.5f * (p[1] - p[-1]);
+    float c2 = p[-1] - 2.5f * p[0] + 2.0f * p[1] - 0.5f * p[2];
+    float c3 = 0.5f * (p[2] - p[-1]) + 1.5f * (p[0] - p[1]);
+    return ((c3 * f + c2) * f + c1) * f + p[0];
+  }
+
+private:
+  // Fractional index into the N + 1 points, clamped to [0, N)
+  inline float Position(float x) const {
+    float pos = (x - lo) * scale;
+    if (pos < 0.0f)
+      pos = 0.0f;
+    if (pos > (float)N - 1.0e-3f)
+      pos = (float)N - 1.0e-3f;
+    return pos;
+  }
+};
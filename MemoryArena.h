@@ -0,0 +1,112 @@
+#pragma once
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Bump allocator over a fixed region (the SDRAM pool in main.cpp).
+//
+// Only one mode runs at a time, so its large buffers and objects are carved
+// from the region when it is activated and everything is released at once
+// with Reset() on the next mode switch. There is no per-allocation free and
+// no destructor calls: modes only hold trivially destructible state.
+// Allocations are aligned to a cache line so SDRAM bursts and cache
+// maintenance never straddle two owners.
+//
+// Allocations are zeroed. Consecutive modes allocate from opposite ends of
+// the region, so while one mode still plays, Prepare()/ClearStep() can zero
+// the next mode's share in bounded steps and its activation then costs no
+// clearing at all.
+class MemoryArena {
+public:
+  static constexpr size_t kAlignment = 32; // Cortex-M7 cache line
+
+  void Init(void *base, size_t size) {
+    uintptr_t start = ((uintptr_t)base + kAlignment - 1) & ~(kAlignment - 1);
+    base_ = (char *)start;
+    capacity_ = (size - (start - (uintptr_t)base)) & ~(kAlignment - 1);
+    top_ = true;
+    used_ = 0;
+    zeroed_ = 0;
+    prepare_target_ = 0;
+    prepare_done_ = 0;
+    peak_ = 0;
+  }
+
+  // Releases every allocation and switches to the other end, whose first
+  // prepared bytes are already zero
+  void Reset() {
+    top_ = !top_;
+    used_ = 0;
+    zeroed_ = prepare_done_;
+    prepare_target_ = 0;
+    prepare_done_ = 0;
+  }
+
+  // Starts zeroing the first `bytes` of the end the next Reset() allocates
+  // from, clipped to what the current allocations leave free
+  void Prepare(size_t bytes) {
+    size_t free_bytes = capacity_ - used_;
+    prepare_target_ = bytes < free_bytes ? bytes : free_bytes;
+    prepare_done_ = 0;
+  }
+
+  // Zeroes up to `max_bytes` more of the prepared region. Returns true once
+  // all of it is zero.
+  bool ClearStep(size_t max_bytes) {
+    size_t n = prepare_target_ - prepare_done_;
+    if (n > max_bytes)
+      n = max_bytes;
+    memset(Address(!top_, prepare_done_, n), 0, n);
+    prepare_done_ += n;
+    return prepare_done_ == prepare_target_;
+  }
+
+  // Bytes Allocate<T>(count) takes from the region, for footprint budgets
+  template <typename T> static constexpr size_t Footprint(size_t count) {
+    return (count * sizeof(T) + kAlignment - 1) & ~(kAlignment - 1);
+  }
+
+  // Zeroed storage for `count` objects, nullptr if the region is full
+  template <typename T> T *Allocate(size_t count) {
+    size_t bytes = Footprint<T>(count);
+    if (bytes > capacity_ - used_)
+      return nullptr;
+    size_t end = used_ + bytes;
+    if (end > zeroed_) {
+      size_t from = used_ > zeroed_ ? used_ : zeroed_;
+      memset(Address(top_, from, end - from), 0, end - from);
+      zeroed_ = end;
+    }
+    T *p = (T *)Address(top_, used_, bytes);
+    used_ = end;
+    if (used_ > peak_)
+      peak_ = used_;
+    return p;
+  }
+
+  // Default-constructs one T in the region, nullptr if it does not fit
+  template <typename T> T *New() {
+    void *p = Allocate<T>(1);
+    return p ? new (p) T() : nullptr;
+  }
+
+  size_t Used() const { return used_; }
+  size_t Capacity() const { return capacity_; }
+  size_t Peak() const { return peak_; } // High-water mark of one end
+
+private:
+  char *base_;
+  size_t capacity_;
+  bool top_;                 // Allocating downwards from the end
+  size_t used_;              // Bytes allocated from the current end
+  size_t zeroed_;            // Bytes from the current end known to be zero
+  size_t prepare_target_;    // Prepare(): bytes to zero at the other end
+  size_t prepare_done_;
+  size_t peak_;
+
+  // Start of the `size` bytes found `offset` bytes in from one end
+  char *Address(bool top, size_t offset, size_t size) const {
+    return top ? base_ + capacity_ - offset - size : base_ + offset;
+  }
+};
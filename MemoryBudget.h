@@ -0,0 +1,101 @@
+#pragma once
+#include "DriveShapers.h"
+#include "ModeConvolution.h"
+#include "ModeFilterDrive.h"
+#include "ModeShepardTone.h"
+#include "ModeShimmerReverb.h"
+#include "ModeSpaceEcho.h"
+#include "PlateReverb.h"
+#include "ReverbService.h"
+#include <stddef.h>
+
+// Memory placement of the modes and per-region budgets, checked at compile
+// time.
+//
+// Hot: each mode object holds only per-sample state (filter and oscillator
+// state, envelopes, smoothing, the voice bank) and all of them stay resident
+// in DTCM, next to the drive tables, so a mode switch copies nothing.
+// Cold: delay lines, the DaisySP blocks that embed their own lines
+// (PitchShifter), the convolver and its IR spectra come from the SDRAM
+// arena, which holds only the active mode; the reverb engines all modes
+// share stay resident in SDRAM. SDRAM needs are checked at the highest
+// supported sample rate.
+// `legio_host -B footprint` prints the table below.
+namespace memory_budget {
+
+static constexpr float kNominalSampleRate = 48000.0f;
+static constexpr float kMaxSampleRate = 96000.0f;
+
+// Region budgets
+static constexpr size_t kDtcmBytes = 64 * 1024; // Of 128K, the rest is stack
+static constexpr size_t kSdramArenaBytes = 48 * 1024 * 1024; // Of 64MB
+
+struct Footprint {
+  const char *name;
+  size_t dtcm;        // Resident
+  size_t sdram;       // Arena bytes while active, at kNominalSampleRate
+  size_t sdram_max;   // Same at kMaxSampleRate
+};
+
+static constexpr Footprint kFootprints[] = {
+    {"filter", sizeof(ModeFilterDrive), 0, 0},
+    {"echo", sizeof(ModeSpaceEcho),
+     ModeSpaceEcho::ArenaBytes(kNominalSampleRate),
+     ModeSpaceEcho::ArenaBytes(kMaxSampleRate)},
+    {"shimmer", sizeof(ModeShimmerReverb),
+     ModeShimmerReverb::ArenaBytes(kNominalSampleRate),
+     ModeShimmerReverb::ArenaBytes(kMaxSampleRate)},
+    {"shepard", sizeof(ModeShepardTone), 0, 0},
+    {"convolution", sizeof(ModeConvolution),
+     ModeConvolution::ArenaBytes(kNominalSampleRate),
+     ModeConvolution::ArenaBytes(kMaxSampleRate)},
+    {"reverb", sizeof(ReverbService), 0, 0},
+    {"tables", sizeof(drive_shapers::Tables), 0, 0},
+};
+
+// The shared reverb engines sit in SDRAM next to the arena, resident
+static constexpr size_t kSdramBytes = 64 * 1024 * 1024;
+static constexpr size_t kReverbScBytes = sizeof(ReverbSc);
+static constexpr size_t kPlateBytes = sizeof(PlateReverb);
+static constexpr size_t kReverbEngineBytes = kReverbScBytes + kPlateBytes;
+
+constexpr size_t DtcmTotal() {
+  size_t total = 0;
+  for (const Footprint &f : kFootprints)
+    total += f.dtcm;
+  return total;
+}
+
+// Only one mode is in the arena at a time
+constexpr size_t SdramPeak() {
+  size_t peak = 0;
+  for (const Footprint &f : kFootprints)
+    if (f.sdram_max > peak)
+      peak = f.sdram_max;
+  return peak;
+}
+
+// The next mode's share is zeroed at the free end of the arena while the
+// current one plays, so any two modes should fit side by side
+constexpr size_t SdramPairPeak() {
+  size_t peak = 0;
+  for (const Footprint &a : kFootprints)
+    for (const Footprint &b : kFootprints)
+      if (&a != &b && a.sdram_max + b.sdram_max > peak)
+        peak = a.sdram_max + b.sdram_max;
+  return peak;
+}
+
+static_assert(DtcmTotal() <= kDtcmBytes,
+              "resident mode state overflows the DTCM budget");
+static_assert(SdramPeak() <= kSdramArenaBytes,
+              "a mode's buffers overflow the SDRAM arena at kMaxSampleRate");
+static_assert(kSdramArenaBytes + kReverbEngineBytes <= kSdramBytes,
+              "the arena and the shared reverbs overflow SDRAM");
+static_assert(plate_layout::kMaxSampleRate >= kMaxSampleRate,
+              "PlateReverb lines are too short for kMaxSampleRate");
+static_assert(SdramPairPeak() <= kSdramArenaBytes,
+              "two modes do not fit the arena side by side: switches would "
+              "clear SDRAM while muted instead of during the fade-out");
+
+} // namespace memory_budget
@@ -0,0 +1,302 @@
+#pragma once
+#include "ControlCurves.h"
+#include "ControlSnapshot.h"
+#include "DelayBuffer.h"
+#include "ImpulseResponses.h"
+#include "MemoryArena.h"
+#include "PartitionedConvolver.h"
+#include "Profiler.h"
+#include "SvfCore.h"
+#include "daisy_legio.h"
+#include "daisysp.h"
+#include <stddef.h>
+
+using namespace daisy;
+using namespace daisysp;
+
+// Convolution reverb: the sum of the inputs, pre-delayed, runs through a
+// stereo IR (room, spring or plate) with a partitioned FFT convolver, then a
+// tone low-pass, mixed against the dry signal.
+class ModeConvolution {
+public:
+  // 1024-sample partitions: half the SDRAM traffic of 512 for a 21 ms
+  // latency at 48 kHz, which the wet path takes as part of its pre-delay
+  using Convolver = PartitionedConvolver<10>;
+
+  // Control targets: mapped from the panel in the main loop, applied in the
+  // audio callback (see ControlSnapshot.h)
+  struct Controls {
+    int ir = (int)impulse_responses::Ir::kPlate;
+    size_t predelay_time = 0; // Samples
+    float tone_freq = kToneMax;
+    float mix = kMixDefault;
+  };
+
+  // The object itself is the hot per-sample state (internal RAM); the
+  // convolver, its frequency-domain delay line, the spectra of every IR and
+  // the pre-delay line are taken from `arena` (SDRAM). The IRs are not
+  // ready yet: PrepareStep() builds them. Returns false if they do not fit
+  // (ArenaBytes() is the exact requirement).
+  bool Init(float sample_rate, MemoryArena &arena) {
+    fs_ = sample_rate;
+
+    convolver_ = arena.New<Convolver>();
+    size_t fdl_floats = Convolver::SpectraFloats(MaxPartitions(fs_));
+    fdl_ = arena.Allocate<float>(fdl_floats);
+    bool ok = convolver_ && fdl_;
+    for (int i = 0; i < impulse_responses::kIrCount && ok; i++) {
+      size_t floats = Convolver::SpectraFloats(IrPartitions(i, fs_));
+      ir_l_[i] = arena.Allocate<float>(floats);
+      ir_r_[i] = arena.Allocate<float>(floats);
+      ok = ir_l_[i] && ir_r_[i];
+    }
+    size_t length = PredelayLength(fs_);
+    size_t buf_size = DelayBuffer::BufferSize(length, kChunk);
+    float *buf = arena.Allocate<float>(buf_size);
+    if (!ok || !buf)
+      return false;
+
+    convolver_->Init(fdl_, MaxPartitions(fs_));
+    prepared_ = 0;
+    generated_ = false;
+    next_partition_ = 0;
+
+    ir_ = (int)impulse_responses::Ir::kPlate;
+    pending_ir_ = ir_;
+    convolver_->SetIr(ir_l_[ir_], ir_r_[ir_], IrPartitions(ir_, fs_));
+    ir_gain_ = 1.0f;
+    ir_hold_ = 0;
+    ir_fade_ = 1.0f / (kIrFadeTime * fs_);
+
+    predelay_.Init(buf, length, kChunk, false); // Arena memory is zero
+    predelay_time_ = 0;
+
+    tone_l_.Init();
+    tone_r_.Init();
+    tone_freq_ = kToneMax;
+    tone_coeffs_ = SvfCoeffs::Compute(fs_, tone_freq_, 0.0f, 0.0f);
+    coef_tone_freq_ = tone_freq_;
+    mix_ = kMixDefault;
+    quality_ = 0;
+    return true;
+  }
+
+  // Main loop, after Init and before the first ProcessBlock: one bounded
+  // step of the IR setup, so mode activation stays short and the main loop
+  // keeps servicing the panel. Each IR channel is synthesised into the FDL
+  // (as long as the longest IR) in one step, then transformed
+  // kPreparePartitions partitions per step; the FDL is cleared after the
+  // last. True once every IR is ready.
+  bool PrepareStep() {
+    if (prepared_ == kIrChannels)
+      return true;
+    int i = prepared_ / 2;
+    int channel = prepared_ % 2;
+    impulse_responses::Ir ir = (impulse_responses::Ir)i;
+    size_t length = impulse_responses::Length(ir, fs_);
+    if (!generated_) {
+      impulse_responses::Generate(ir, fs_, channel, fdl_);
+      generated_ = true;
+      return false;
+    }
+
+    size_t partitions = Convolver::Partitions(length);
+    size_t last = next_partition_ + kPreparePartitions;
+    if (last > partitions)
+      last = partitions;
+    convolver_->PrepareIr(fdl_, length, channel ? ir_r_[i] : ir_l_[i],
+                          next_partition_, last);
+    next_partition_ = last;
+    if (last < partitions)
+      return false;
+
+    generated_ = false;
+    next_partition_ = 0;
+    if (++prepared_ < kIrChannels)
+      return false;
+    memset(fdl_, 0,
+           Convolver::SpectraFloats(MaxPartitions(fs_)) * sizeof(float));
+    return true;
+  }
+
+  // Quality levels (QualityGovernor.h): each halves the IR convolved, from
+  // the convolver's next block (the tail is cut shorter, the early part
+  // stays)
+  static constexpr int kQualityLevels = 3;
+
+  // Audio callback, before ApplyControls
+  void SetQuality(int level) {
+    if (level == quality_)
+      return;
+    quality_ = level;
+    convolver_->SetPartitionLimit(IrPartitions(ir_, fs_) >> quality_);
+  }
+
+  int Quality() const { return quality_; }
+
+  static constexpr size_t IrPartitions(int ir, float sample_rate) {
+    return Convolver::Partitions(
+        impulse_responses::Length((impulse_responses::Ir)ir, sample_rate));
+  }
+
+  static constexpr size_t MaxPartitions(float sample_rate) {
+    return Convolver::Partitions(
+        (size_t)(impulse_responses::kMaxSeconds * sample_rate));
+  }
+
+  static constexpr size_t PredelayLength(float sample_rate) {
+    return (size_t)(kPredelayLong * sample_rate) + kChunk; // Longest ReadBlock
+  }
+
+  // SDRAM taken by Init at this sample rate
+  static constexpr size_t ArenaBytes(float sample_rate) {
+    return MemoryArena::Footprint<Convolver>(1) +
+           MemoryArena::Footprint<float>(
+               Convolver::SpectraFloats(MaxPartitions(sample_rate))) +
+           2 * IrBytes(0, sample_rate) +
+           MemoryArena::Footprint<float>(
+               DelayBuffer::BufferSize(PredelayLength(sample_rate), kChunk));
+  }
+
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    for (size_t offset = 0; offset < size; offset += kChunk) {
+      size_t n = size - offset;
+      if (n > kChunk)
+        n = kChunk;
+      const float *dry_l = in_l + offset;
+      const float *dry_r = in_r + offset;
+      float send[kChunk], wet_l[kChunk], wet_r[kChunk];
+
+      // 1. Mono send through the pre-delay (whole samples, one block)
+      {
+        LEGIO_PROFILE_SCOPE("conv/predelay");
+        for (size_t i = 0; i < n; i++)
+          send[i] = (dry_l[i] + dry_r[i]) * 0.5f;
+        predelay_.WriteBlock(send, n);
+        predelay_.ReadBlock(send, n, predelay_time_ + n);
+      }
+
+      // 2. Convolution
+      {
+        LEGIO_PROFILE_SCOPE("conv/convolver");
+        convolver_->ProcessBlock(send, wet_l, wet_r, n);
+      }
+
+      // 3. IR switch: fade the wet out, swap, wait out the convolver's
+      // latency (the old IR's blocks), fade back in
+      {
+        LEGIO_PROFILE_SCOPE("conv/output");
+        if (pending_ir_ != ir_ || ir_hold_ > 0 || ir_gain_ < 1.0f)
+          FadeIr(wet_l, wet_r, n);
+
+        // 4. Tone and Mix
+        for (size_t i = 0; i < n; i++) {
+          tone_l_.Process(wet_l[i], tone_coeffs_);
+          tone_r_.Process(wet_r[i], tone_coeffs_);
+          out_l[offset + i] =
+              dry_l[i] * (1.0f - mix_) + tone_l_.Low() * kWetGain * mix_;
+          out_r[offset + i] =
+              dry_r[i] * (1.0f - mix_) + tone_r_.Low() * kWetGain * mix_;
+        }
+      }
+    }
+  }
+
+  // Main loop: targets for `frame`
+  void MapControls(const ControlFrame &frame, Controls &c) const {
+    // IR: Top=Plate, Mid=Spring, Bot=Room
+    if (frame.sw_left >= 0 && frame.sw_left < impulse_responses::kIrCount)
+      c.ir = frame.sw_left;
+
+    // Pre-delay on top of the convolver latency: Top=Long, Mid=Short, Bot=None
+    float predelay = frame.sw_right == 2   ? kPredelayLong
+                     : frame.sw_right == 1 ? kPredelayShort
+                                           : 0.0f;
+    c.predelay_time = (size_t)(predelay * fs_);
+
+    // Tone: exponential 800 Hz .. 16 kHz low-pass on the wet signal
+    c.tone_freq =
+        control_curves::kConvolutionToneTable.Cubic(frame.knob_bottom);
+
+    c.mix = frame.knob_top;
+  }
+
+  // Audio callback, once per buffer
+  void ApplyControls(const Controls &c) {
+    pending_ir_ = c.ir;
+    predelay_time_ = c.predelay_time;
+    fonepole(tone_freq_, c.tone_freq, kToneSmooth);
+    if (tone_freq_ != coef_tone_freq_) {
+      coef_tone_freq_ = tone_freq_;
+      tone_coeffs_ = SvfCoeffs::Compute(fs_, tone_freq_, 0.0f, 0.0f);
+    }
+    mix_ = c.mix;
+  }
+
+private:
+  // Audio Processing Constants
+  static constexpr size_t kChunk = 64;
+  static constexpr float kPredelayShort = 0.02f;
+  static constexpr float kPredelayLong = 0.06f;
+  static constexpr float kWetGain = 1.0f; // IRs have unit energy
+  static constexpr float kIrFadeTime = 0.02f;
+  static constexpr int kIrChannels = 2 * impulse_responses::kIrCount;
+  static constexpr size_t kPreparePartitions = 16; // FFTs per PrepareStep
+
+  // Control Constants
+  static constexpr float kMixDefault = 0.4f;
+  static constexpr float kToneMax = (float)control_curves::ConvolutionTone::kHi;
+  static constexpr float kToneSmooth = 0.05f;
+
+  Convolver *convolver_;  // In the arena
+  float *fdl_;            // The convolver's, in the arena
+  int prepared_;          // IR channels ready (PrepareStep)
+  bool generated_;        // The next channel is synthesised into fdl_
+  size_t next_partition_; // Of that channel, to transform next
+  float *ir_l_[impulse_responses::kIrCount]; // Spectra in the arena
+  float *ir_r_[impulse_responses::kIrCount];
+  int ir_, pending_ir_;
+  float ir_gain_, ir_fade_; // Wet gain during an IR switch, step per sample
+  size_t ir_hold_;          // Muted samples left after a swap
+  DelayBuffer predelay_;    // Storage in the arena
+  size_t predelay_time_;    // Samples
+  SvfCore tone_l_, tone_r_;
+  SvfCoeffs tone_coeffs_;
+  float tone_freq_;
+  float coef_tone_freq_; // tone_freq_ that tone_coeffs_ were built for
+  float mix_;
+  float fs_;
+  int quality_;
+
+  static constexpr size_t IrBytes(int ir, float sample_rate) {
+    return ir >= impulse_responses::kIrCount
+               ? 0
+               : MemoryArena::Footprint<float>(Convolver::SpectraFloats(
+                     IrPartitions(ir, sample_rate))) +
+                     IrBytes(ir + 1, sample_rate);
+  }
+
+  void FadeIr(float *wet_l, float *wet_r, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      if (pending_ir_ != ir_) {
+        ir_gain_ -= ir_fade_;
+        if (ir_gain_ <= 0.0f) {
+          ir_gain_ = 0.0f;
+          ir_ = pending_ir_;
+          convolver_->SetPartitionLimit(IrPartitions(ir_, fs_) >> quality_);
+          convolver_->SetIr(ir_l_[ir_], ir_r_[ir_], IrPartitions(ir_, fs_));
+          ir_hold_ = Convolver::kBlock; // Old IR output still queued
+        }
+      } else if (ir_hold_ > 0) {
+        ir_hold_--;
+      } else if (ir_gain_ < 1.0f) {
+        ir_gain_ += ir_fade_;
+        if (ir_gain_ > 1.0f)
+          ir_gain_ = 1.0f;
+      }
+      wet_l[i] *= ir_gain_;
+      wet_r[i] *= ir_gain_;
+    }
+  }
+};
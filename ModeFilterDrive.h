@@ -1,37 +1,83 @@
 #pragma once
+#include "ControlCurves.h"
+#include "ControlSnapshot.h"
+#include "DriveShapers.h"
+#include "FastMath.h"
+#include "Oversampler.h"
+#include "Profiler.h"
+#include "SvfCore.h"
 #include "daisy_legio.h"
 #include "daisysp.h"
 #include <math.h>
+#include <stddef.h>
 
 using namespace daisy;
 using namespace daisysp;
 
 class ModeFilterDrive {
 public:
+  enum FilterMode { FILTER_HP, FILTER_BP, FILTER_LP };
+  enum DriveMode { DRIVE_WARM, DRIVE_HARD, DRIVE_DESTROY };
+
+  // Control targets: mapped from the panel in the main loop, applied in the
+  // audio callback (see ControlSnapshot.h)
+  struct Controls {
+    float cutoff = 1000.0f;    // Hz
+    float res = 0.0f;
+    float drive_amount = 0.0f; // Encoder-driven
+    FilterMode filter_mode = FILTER_LP;
+    DriveMode drive_mode = DRIVE_WARM;
+  };
+
   void Init(float sample_rate) {
     fs_ = sample_rate;
 
-    // Initialize Filter Stage 1
-    svf_l_.Init(fs_);
-    svf_r_.Init(fs_);
-    svf_l_.SetFreq(1000.0f);
-    svf_l_.SetRes(0.5f);
-    svf_l_.SetDrive(0.0f);
-    svf_r_.SetFreq(1000.0f);
-    svf_r_.SetRes(0.5f);
-    svf_r_.SetDrive(0.0f);
-
-    // Initialize Filter Stage 2 (for 24dB/oct slope)
-    svf_l2_.Init(fs_);
-    svf_r2_.Init(fs_);
-    svf_l2_.SetFreq(1000.0f);
-    svf_l2_.SetRes(0.5f);
-    svf_l2_.SetDrive(0.0f);
-    svf_r2_.SetFreq(1000.0f);
-    svf_r2_.SetRes(0.5f);
-    svf_r2_.SetDrive(0.0f);
-
-    // Initialize Input LPF Stage 1 (2-pole anti-aliasing)
+    // Drive curves: copy the compile-time tables into DTCM (first call only)
+    drive_shapers::Init();
+
+    // Initialize Drive
+    drive_amount_ = 0.0f;
+    freq_ = 1000.0f;
+    res_ = 0.0f;
+    drive_ = 0.0f;
+
+    // Filter coefficients are built at control rate (see ApplyControls)
+    coef_l_ = SvfCoeffs::Compute(fs_, freq_, res_, drive_);
+    coef_r_ = coef_l_;
+    target_l_ = coef_l_;
+    target_r_ = coef_r_;
+    coef_freq_ = freq_;
+    coef_res_ = res_;
+    coef_drive_ = drive_;
+    coeffs_dirty_ = false;
+
+    // Initialize Drive Oversampling (factor follows the drive mode)
+    os_l_.Init(kOversampleWarm);
+    os_r_.Init(kOversampleWarm);
+
+    ResetState();
+
+    // Initialize stereo spread cache
+    stereo_spread_ = 1.0f;
+
+    // Default switch positions until the first ApplyControls
+    filter_mode_ = FILTER_LP;
+    drive_mode_ = DRIVE_WARM;
+    kernel_ = SelectKernel(filter_mode_, drive_mode_);
+    quality_ = 0;
+  }
+
+  // Clears the audio state (filters, gate, oversampler history) and keeps
+  // the configuration: drive and filter settings, oversampling factor,
+  // quality level and kernel
+  void ResetState() {
+    // Filter Stages (2x 2-pole for 24dB/oct)
+    svf_l_.Init();
+    svf_r_.Init();
+    svf_l2_.Init();
+    svf_r2_.Init();
+
+    // Input LPF Stage 1 (2-pole anti-aliasing)
     input_lpf_l_.Init(fs_);
     input_lpf_r_.Init(fs_);
     input_lpf_l_.SetFreq(14000.0f); // Cut ultrasonic noise
@@ -39,7 +85,7 @@ public:
     input_lpf_r_.SetFreq(14000.0f);
     input_lpf_r_.SetRes(0.0f);
 
-    // Initialize Input LPF Stage 2 (2-pole for 24dB/oct slope)
+    // Input LPF Stage 2 (2-pole for 24dB/oct slope)
     input_lpf_l2_.Init(fs_);
     input_lpf_r2_.Init(fs_);
     input_lpf_l2_.SetFreq(14000.0f);
@@ -47,214 +93,99 @@ public:
     input_lpf_r2_.SetFreq(14000.0f);
     input_lpf_r2_.SetRes(0.0f);
 
-    // Initialize Drive
-    drive_amount_ = 0.0f;
-    freq_ = 1000.0f;
-    res_ = 0.0f;
-    drive_ = 0.0f;
-
-    // Initialize Noise Gate
+    // Noise Gate
     env_follower_l_ = 0.0f;
     env_follower_r_ = 0.0f;
 
-    // Initialize Oversampling History (4 samples for Hermite)
-    for (int i = 0; i < 4; i++) {
-      hist_l_[i] = 0.0f;
-      hist_r_[i] = 0.0f;
-    }
-
-    // Initialize stereo spread cache
-    stereo_spread_ = 1.0f;
+    os_l_.Reset();
+    os_r_.Reset();
   }
 
-  void Process(float in_l, float in_r, float *out_l, float *out_r) {
-    // 0. Noise Gate (Downward Expander)
-    // Simple envelope follower
-    env_follower_l_ =
-        kGateAttack * env_follower_l_ + kGateRelease * fabsf(in_l);
-    env_follower_r_ =
-        kGateAttack * env_follower_r_ + kGateRelease * fabsf(in_r);
-
-    float gate_gain_l = 1.0f;
-    float gate_gain_r = 1.0f;
-
-    if (env_follower_l_ < kGateThreshold) {
-      gate_gain_l = env_follower_l_ / kGateThreshold; // Soft knee expansion
-      gate_gain_l *= gate_gain_l; // Square it for steeper curve
-    }
-    if (env_follower_r_ < kGateThreshold) {
-      gate_gain_r = env_follower_r_ / kGateThreshold;
-      gate_gain_r *= gate_gain_r;
-    }
-
-    // 0.5 Input LPF (2-pole anti-aliasing before drive)
-    input_lpf_l_.Process(in_l);
-    input_lpf_r_.Process(in_r);
-    float stage1_l = input_lpf_l_.Low() * gate_gain_l;
-    float stage1_r = input_lpf_r_.Low() * gate_gain_r;
-
-    // Stage 2 for 24dB/oct slope
-    input_lpf_l2_.Process(stage1_l);
-    input_lpf_r2_.Process(stage1_r);
-    float clean_l = input_lpf_l2_.Low();
-    float clean_r = input_lpf_r2_.Low();
-
-    // 1. Apply Drive (Pre-Filter) with 2x Hermite Oversampling
-    // Gain staging: Boost input based on drive amount
-    float drive_gain = 1.0f + (drive_amount_ * kDriveGainMultiplier);
-    float dry_l = clean_l * drive_gain;
-    float dry_r = clean_r * drive_gain;
-
-    // Hermite Interpolation for upsampling
-    // Generate intermediate sample using 4-point Hermite
-    float dry_l_mid =
-        HermiteInterpolate(hist_l_[0], hist_l_[1], hist_l_[2], dry_l, 0.5f);
-    float dry_r_mid =
-        HermiteInterpolate(hist_r_[0], hist_r_[1], hist_r_[2], dry_r, 0.5f);
-
-    // Process both samples through drive
-    float dist_l_mid = ApplyDrive(dry_l_mid);
-    float dist_r_mid = ApplyDrive(dry_r_mid);
-    float dist_l_curr = ApplyDrive(dry_l);
-    float dist_r_curr = ApplyDrive(dry_r);
-
-    // Decimation with weighted averaging (anti-aliasing)
-    float driven_l = (dist_l_mid * kOversampleMidWeight +
-                      dist_l_curr * kOversampleCurrWeight);
-    float driven_r = (dist_r_mid * kOversampleMidWeight +
-                      dist_r_curr * kOversampleCurrWeight);
-
-    // Update history buffer
-    hist_l_[0] = hist_l_[1];
-    hist_l_[1] = hist_l_[2];
-    hist_l_[2] = dry_l;
-
-    hist_r_[0] = hist_r_[1];
-    hist_r_[1] = hist_r_[2];
-    hist_r_[2] = dry_r;
-
-    // 2. Apply Filter (24dB/oct - 4 Pole)
-    // Stereo Spread: Offset Right channel cutoff slightly for width (cached in
-    // UpdateControls)
-
-    // Stage 1
-    svf_l_.SetFreq(freq_);
-    svf_l_.SetRes(res_);
-    svf_l_.SetDrive(drive_);
-
-    svf_r_.SetFreq(freq_ * stereo_spread_);
-    svf_r_.SetRes(res_);
-    svf_r_.SetDrive(drive_);
-
-    // Stage 2
-    svf_l2_.SetFreq(freq_);
-    svf_l2_.SetRes(res_);
-    svf_l2_.SetDrive(drive_);
-
-    svf_r2_.SetFreq(freq_ * stereo_spread_);
-    svf_r2_.SetRes(res_);
-    svf_r2_.SetDrive(drive_);
-
-    // Process Stage 1
-    svf_l_.Process(driven_l);
-    svf_r_.Process(driven_r);
-
-    // Process Stage 2 (Input is output of Stage 1)
-    // We need to select the correct output from Stage 1 to feed Stage 2
-    float l1_out, r1_out;
-    if (filter_mode_ == FILTER_HP) {
-      l1_out = svf_l_.High();
-      r1_out = svf_r_.High();
-    } else if (filter_mode_ == FILTER_BP) {
-      l1_out = svf_l_.Band();
-      r1_out = svf_r_.Band();
-    } else { // LP
-      l1_out = svf_l_.Low();
-      r1_out = svf_r_.Low();
-    }
-
-    svf_l2_.Process(l1_out);
-    svf_r2_.Process(r1_out);
-
-    float l_filtered = 0.0f;
-    float r_filtered = 0.0f;
-
-    if (filter_mode_ == FILTER_HP) { // HP
-      l_filtered = svf_l2_.High();
-      r_filtered = svf_r2_.High();
-    } else if (filter_mode_ == FILTER_BP) { // BP
-      l_filtered = svf_l2_.Band();
-      r_filtered = svf_r2_.Band();
-    } else { // LP
-      l_filtered = svf_l2_.Low();
-      r_filtered = svf_r2_.Low();
-    }
-
-    // 3. Output Gain Compensation & Limiting
-    // As drive increases, we attenuate output to maintain constant perceived
-    // loudness.
-    float comp_gain = 1.0f / sqrtf(drive_gain);
+  // Quality levels (QualityGovernor.h) of drive mode `d`: each halves its
+  // oversampling, down to 1x (more aliasing, same tone), so Warm has 2,
+  // Hard 3 and Destroy 4
+  static int QualityLevels(DriveMode d) {
+    int levels = 1;
+    for (int factor = OversampleFactor(d); factor > 1; factor >>= 1)
+      levels++;
+    return levels;
+  }
 
-    // Apply compensation
-    l_filtered *= comp_gain;
-    r_filtered *= comp_gain;
+  // Audio callback, before ApplyControls. A level past the drive mode's
+  // last (until the main loop catches up with a switch) runs at 1x
+  void SetQuality(int level) {
+    if (level == quality_)
+      return;
+    quality_ = level;
+    os_l_.SetFactor(OversampleFactor(drive_mode_) >> quality_);
+    os_r_.SetFactor(OversampleFactor(drive_mode_) >> quality_);
+  }
 
-    // Final Safety Limiter (Soft Clip)
-    float final_l = tanhf(l_filtered);
-    float final_r = tanhf(r_filtered);
+  int Quality() const { return quality_; }
 
-    // NAN Check / Safety Recovery (Soluciona el "petado" reiniciando el filtro)
-    if (isnan(final_l) || isinf(final_l) || isnan(final_r) || isinf(final_r)) {
-      Init(fs_);
-      final_l = 0.0f;
-      final_r = 0.0f;
-    }
-
-    *out_l = final_l;
-    *out_r = final_r;
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    // Kernel specialised for the current switch positions (see ApplyControls)
+    (this->*kernel_)(in_l, in_r, out_l, out_r, size);
   }
 
-  void UpdateControls(DaisyLegio &hw) {
+  // Main loop: targets for `frame`
+  void MapControls(const ControlFrame &frame, Controls &c) const {
     // Knobs
-    float k_cutoff = hw.controls[DaisyLegio::CONTROL_KNOB_TOP].Value();
-    float k_res = hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].Value();
+    // Extended Range: 5Hz to 18kHz for deep sub-bass control
+    c.cutoff = control_curves::kFilterCutoffTable.Cubic(frame.knob_top);
+    c.res = frame.knob_bottom;
 
     // Encoder Turn (Drive Amount)
-    float inc = hw.encoder.Increment();
-    drive_amount_ += inc * kDriveEncoderSensitivity;
-    drive_amount_ = fclamp(drive_amount_, 0.0f, 1.0f);
-
-    // Switches
-    int sw_drive = hw.sw[DaisyLegio::SW_LEFT].Read();
-    int sw_filter = hw.sw[DaisyLegio::SW_RIGHT].Read();
+    float inc = frame.encoder;
+    c.drive_amount += inc * kDriveEncoderSensitivity;
+    c.drive_amount = fclamp(c.drive_amount, 0.0f, 1.0f);
 
     // Map Filter Mode (Inverted: 2=Top, 1=Mid, 0=Bot)
-    if (sw_filter == 2)
-      filter_mode_ = FILTER_HP;
-    else if (sw_filter == 1)
-      filter_mode_ = FILTER_BP;
+    if (frame.sw_right == 2)
+      c.filter_mode = FILTER_HP;
+    else if (frame.sw_right == 1)
+      c.filter_mode = FILTER_BP;
     else
-      filter_mode_ = FILTER_LP;
+      c.filter_mode = FILTER_LP;
 
     // Map Drive Mode (Inverted: 2=Top, 1=Mid, 0=Bot)
-    if (sw_drive == 2)
-      drive_mode_ = DRIVE_WARM;
-    else if (sw_drive == 1)
-      drive_mode_ = DRIVE_HARD;
+    if (frame.sw_left == 2)
+      c.drive_mode = DRIVE_WARM;
+    else if (frame.sw_left == 1)
+      c.drive_mode = DRIVE_HARD;
     else
-      drive_mode_ = DRIVE_DESTROY;
+      c.drive_mode = DRIVE_DESTROY;
+  }
 
-    // Update DSP Parameters
-    // Extended Range: 5Hz to 18kHz for deep sub-bass control
-    float target_freq = fmap(k_cutoff, 5.0f, 18000.0f, Mapping::LOG);
+  // Audio callback, once per buffer
+  void ApplyControls(const Controls &c) {
+    drive_amount_ = c.drive_amount;
+    if (c.filter_mode != filter_mode_ || c.drive_mode != drive_mode_) {
+      filter_mode_ = c.filter_mode;
+      drive_mode_ = c.drive_mode;
+      kernel_ = SelectKernel(filter_mode_, drive_mode_);
+      os_l_.SetFactor(OversampleFactor(drive_mode_) >> quality_);
+      os_r_.SetFactor(OversampleFactor(drive_mode_) >> quality_);
+    }
 
     // Smooth parameters
-    fonepole(freq_, target_freq, kParamSmoothCoeff);
-    fonepole(res_, k_res, kParamSmoothCoeff);
+    fonepole(freq_, c.cutoff, kParamSmoothCoeff);
+    fonepole(res_, c.res, kParamSmoothCoeff);
     fonepole(drive_, drive_amount_, kParamSmoothCoeff);
 
     // Calculate stereo spread (moved from Process for efficiency)
     stereo_spread_ = 1.0f + (res_ * kStereoSpreadAmount);
+
+    // Rebuild filter coefficients only when the smoothed parameters moved
+    if (freq_ != coef_freq_ || res_ != coef_res_ || drive_ != coef_drive_) {
+      target_l_ = SvfCoeffs::Compute(fs_, freq_, res_, drive_);
+      target_r_ = SvfCoeffs::Compute(fs_, freq_ * stereo_spread_, res_, drive_);
+      coef_freq_ = freq_;
+      coef_res_ = res_;
+      coef_drive_ = drive_;
+      coeffs_dirty_ = true;
+    }
   }
 
 private:
@@ -263,101 +194,237 @@ private:
   static constexpr float kGateAttack = 0.99f;
   static constexpr float kGateRelease = 0.01f;
   static constexpr float kDriveGainMultiplier = 16.0f;
-  static constexpr float kOversampleMidWeight = 0.4f;
-  static constexpr float kOversampleCurrWeight = 0.6f;
+  static constexpr size_t kDriveChunk = 32; // Samples per oversampler call
   static constexpr float kStereoSpreadAmount = 0.05f; // Up to 5% spread
   static constexpr float kParamSmoothCoeff = 0.05f;
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
   static constexpr float kDriveEncoderSensitivity =
       0.05f; // 5% change per click
 
-  // Wavefolder Constants
-  static constexpr float kWavefoldInputClamp = 5.0f;
-  static constexpr float kWavefoldStage2Gain = 1.5f;
-  static constexpr float kWavefoldStage3Gain = 1.2f;
-  static constexpr float kWavefoldOutputScale = 0.7f;
+  // Oversampling per drive mode: the harder the shaper, the more harmonics
+  // would fold back (see `legio_host -B oversampling`)
+  static constexpr int kOversampleWarm = 2;
+  static constexpr int kOversampleHard = 4;
+  static constexpr int kOversampleDestroy = 8;
 
-  Svf svf_l_, svf_r_;
-  Svf svf_l2_, svf_r2_;             // Second stage for 24dB/oct
+  SvfCore svf_l_, svf_r_;
+  SvfCore svf_l2_, svf_r2_;         // Second stage for 24dB/oct
   Svf input_lpf_l_, input_lpf_r_;   // Input LPF stage 1
   Svf input_lpf_l2_, input_lpf_r2_; // Input LPF stage 2 (2-pole)
   float fs_;
   float drive_amount_;
   float freq_, res_, drive_;
   float env_follower_l_, env_follower_r_; // For Noise Gate
-  float hist_l_[4], hist_r_[4];           // Hermite interpolation history
+  Oversampler os_l_, os_r_;               // Drive stage oversampling
   float stereo_spread_;                   // Cached stereo spread value
 
-  enum FilterMode { FILTER_HP, FILTER_BP, FILTER_LP } filter_mode_;
-  enum DriveMode { DRIVE_WARM, DRIVE_HARD, DRIVE_DESTROY } drive_mode_;
+  // Control-rate filter coefficients (ramped across each block)
+  SvfCoeffs coef_l_, coef_r_;               // Values at the end of last block
+  SvfCoeffs target_l_, target_r_;           // Values for the end of this block
+  float coef_freq_, coef_res_, coef_drive_; // Parameters the targets came from
+  bool coeffs_dirty_;
+
+  FilterMode filter_mode_;
+  DriveMode drive_mode_;
+  int quality_;
+
+  // Block kernel for one (FilterMode, DriveMode) pair: the output tap and the
+  // shaper are template parameters, so the loop carries no mode branches
+  template <FilterMode F, DriveMode D>
+  void ProcessKernel(const float *in_l, const float *in_r, float *out_l,
+                     float *out_r, size_t size) {
+    // Per-sample state is kept in locals so it stays in registers across the
+    // loop; drive_amount_ only changes in ApplyControls (NaN recovery's
+    // ResetState leaves it as is)
+    float env_l = env_follower_l_;
+    float env_r = env_follower_r_;
+    float drive_gain = 1.0f + (drive_amount_ * kDriveGainMultiplier);
+    float comp_gain = 1.0f / sqrtf(drive_gain);
+
+    // Filter coefficients ramp linearly from the previous block's values to
+    // the targets built in ApplyControls; steps stay zero when nothing moved
+    bool ramping = coeffs_dirty_ && size > 0;
+    SvfCoeffs cl = coef_l_;
+    SvfCoeffs cr = coef_r_;
+    SvfCoeffs step_l = {0.0f, 0.0f, 0.0f};
+    SvfCoeffs step_r = {0.0f, 0.0f, 0.0f};
+    if (ramping) {
+      step_l = SvfCoeffs::Ramp(cl, target_l_, size);
+      step_r = SvfCoeffs::Ramp(cr, target_r_, size);
+    }
+
+    for (size_t offset = 0; offset < size; offset += kDriveChunk) {
+      size_t n = size - offset;
+      if (n > kDriveChunk)
+        n = kDriveChunk;
+      const float *chunk_in_l = in_l + offset;
+      const float *chunk_in_r = in_r + offset;
+      float driven_l[kDriveChunk];
+      float driven_r[kDriveChunk];
+
+      // The gate and input LPF run fused per sample: profiled as one stage,
+      // as are the filter and limiter below
+      {
+        LEGIO_PROFILE_SCOPE("filter/gate+lpf");
+        for (size_t i = 0; i < n; i++) {
+          // 0. Noise Gate (Downward Expander)
+          // Simple envelope follower
+          env_l = kGateAttack * env_l + kGateRelease * fabsf(chunk_in_l[i]);
+          env_r = kGateAttack * env_r + kGateRelease * fabsf(chunk_in_r[i]);
+
+          float gate_gain_l = 1.0f;
+          float gate_gain_r = 1.0f;
+
+          if (env_l < kGateThreshold) {
+            gate_gain_l = env_l / kGateThreshold; // Soft knee expansion
+            gate_gain_l *= gate_gain_l;           // Square it for steeper curve
+          }
+          if (env_r < kGateThreshold) {
+            gate_gain_r = env_r / kGateThreshold;
+            gate_gain_r *= gate_gain_r;
+          }
+
+          // 0.5 Input LPF (2-pole anti-aliasing before drive)
+          input_lpf_l_.Process(chunk_in_l[i]);
+          input_lpf_r_.Process(chunk_in_r[i]);
+          float stage1_l = input_lpf_l_.Low() * gate_gain_l;
+          float stage1_r = input_lpf_r_.Low() * gate_gain_r;
+
+          // Stage 2 for 24dB/oct slope
+          input_lpf_l2_.Process(stage1_l);
+          input_lpf_r2_.Process(stage1_r);
+
+          // Gain staging: Boost input based on drive amount
+          driven_l[i] = input_lpf_l2_.Low() * drive_gain;
+          driven_r[i] = input_lpf_r2_.Low() * drive_gain;
+        }
+      }
+
+      // 1. Apply Drive (Pre-Filter), oversampled with halfband stages
+      {
+        LEGIO_PROFILE_SCOPE("filter/drive");
+        auto shaper = [this](float x) { return ApplyDrive<D>(x); };
+        os_l_.Process(driven_l, driven_l, n, shaper);
+        os_r_.Process(driven_r, driven_r, n, shaper);
+      }
+
+      {
+        LEGIO_PROFILE_SCOPE("filter/svf+limit");
+        for (size_t i = 0; i < n; i++) {
+          // 2. Apply Filter (24dB/oct - 4 Pole)
+          // Stereo Spread: Offset Right channel cutoff slightly for width
+          // (cached in ApplyControls)
+
+          cl.Advance(step_l);
+          cr.Advance(step_r);
+
+          // Process Stage 1
+          svf_l_.Process(driven_l[i], cl);
+          svf_r_.Process(driven_r[i], cr);
+
+          // Process Stage 2 (Input is output of Stage 1)
+          // We need to select the correct output from Stage 1 to feed Stage 2
+          float l1_out = SelectOutput<F>(svf_l_);
+          float r1_out = SelectOutput<F>(svf_r_);
+
+          svf_l2_.Process(l1_out, cl);
+          svf_r2_.Process(r1_out, cr);
+
+          float l_filtered = SelectOutput<F>(svf_l2_);
+          float r_filtered = SelectOutput<F>(svf_r2_);
+
+          // 3. Output Gain Compensation & Limiting
+          // As drive increases, we attenuate output to maintain constant
+          // perceived loudness.
+          l_filtered *= comp_gain;
+          r_filtered *= comp_gain;
+
+          // Final Safety Limiter (Soft Clip)
+          float final_l = fastmath::Tanh<kMathTier>(l_filtered);
+          float final_r = fastmath::Tanh<kMathTier>(r_filtered);
+
+          // NAN Check / Safety Recovery (Soluciona el "petado" reiniciando el
+          // filtro). Checked before the limiter: the approximation does not
+          // propagate NaN the way tanhf does
+          if (isnan(l_filtered) || isinf(l_filtered) || isnan(r_filtered) ||
+              isinf(r_filtered)) {
+            // Only the audio state: the settings and quality level stay
+            ResetState();
+            env_l = env_follower_l_;
+            env_r = env_follower_r_;
+            // Settle on the targets rather than resume the ramp
+            coef_l_ = cl = target_l_;
+            coef_r_ = cr = target_r_;
+            coeffs_dirty_ = false;
+            step_l = step_r = {0.0f, 0.0f, 0.0f};
+            ramping = false;
+            final_l = 0.0f;
+            final_r = 0.0f;
+          }
+
+          out_l[offset + i] = final_l;
+          out_r[offset + i] = final_r;
+        }
+      }
+    }
+
+    env_follower_l_ = env_l;
+    env_follower_r_ = env_r;
+
+    // Land exactly on the targets so rounding never accumulates
+    if (ramping) {
+      coef_l_ = target_l_;
+      coef_r_ = target_r_;
+      coeffs_dirty_ = false;
+    }
+  }
+
+  typedef void (ModeFilterDrive::*Kernel)(const float *, const float *,
+                                          float *, float *, size_t);
+  Kernel kernel_;
+
+  static Kernel SelectKernel(FilterMode f, DriveMode d) {
+    static const Kernel kKernels[3][3] = {
+        {&ModeFilterDrive::ProcessKernel<FILTER_HP, DRIVE_WARM>,
+         &ModeFilterDrive::ProcessKernel<FILTER_HP, DRIVE_HARD>,
+         &ModeFilterDrive::ProcessKernel<FILTER_HP, DRIVE_DESTROY>},
+        {&ModeFilterDrive::ProcessKernel<FILTER_BP, DRIVE_WARM>,
+         &ModeFilterDrive::ProcessKernel<FILTER_BP, DRIVE_HARD>,
+         &ModeFilterDrive::ProcessKernel<FILTER_BP, DRIVE_DESTROY>},
+        {&ModeFilterDrive::ProcessKernel<FILTER_LP, DRIVE_WARM>,
+         &ModeFilterDrive::ProcessKernel<FILTER_LP, DRIVE_HARD>,
+         &ModeFilterDrive::ProcessKernel<FILTER_LP, DRIVE_DESTROY>}};
+    return kKernels[f][d];
+  }
 
-  float ApplyDrive(float x) {
-    switch (drive_mode_) {
+  // D is a compile-time constant, so the switch folds to a single shaper
+  template <DriveMode D> float ApplyDrive(float x) {
+    switch (D) {
     case DRIVE_WARM:
-      return AsymmetricSoftClip(x);
+      return drive_shapers::SoftClip(x);
     case DRIVE_HARD:
-      return x / sqrtf(1.0f + (x * x));
+      return drive_shapers::Hard(x);
     case DRIVE_DESTROY:
-      return Wavefolder(x);
+      return drive_shapers::Wavefold(x);
     default:
       return x;
     }
   }
 
-  // Hermite interpolation for smooth upsampling
-  float HermiteInterpolate(float xm1, float x0, float x1, float x2, float t) {
-    float c0 = x0;
-    float c1 = 0.5f * (x1 - xm1);
-    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
-    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
-    return ((c3 * t + c2) * t + c1) * t + c0;
+  static int OversampleFactor(DriveMode d) {
+    return d == DRIVE_WARM   ? kOversampleWarm
+           : d == DRIVE_HARD ? kOversampleHard
+                             : kOversampleDestroy;
   }
 
-  float AsymmetricSoftClip(float x) {
-    // Smoother asymmetric clipping with gradual knee
-    if (x > 1.5f)
-      return 0.85f;
-    if (x < -1.5f)
-      return -0.45f;
-
-    // Smooth transition using tanh-like curve
-    float pos = x * 0.7f;
-    float neg = x * 0.5f;
-    return x > 0.0f ? pos + (x - pos) * expf(-x * x)
-                    : neg + (x - neg) * expf(-x * x * 0.5f);
-  }
-
-  float Wavefolder(float x) {
-    // Safety Clamp: Impide que entren valores locos que hagan explotar el
-    // algoritmo
-    if (x > kWavefoldInputClamp)
-      x = kWavefoldInputClamp;
-    if (x < -kWavefoldInputClamp)
-      x = -kWavefoldInputClamp;
-
-    // Multi-stage wavefolder with cubic interpolation for smoother, more
-    // musical folds Stage 1
-    if (x > 1.0f)
-      x = 2.0f - x;
-    else if (x < -1.0f)
-      x = -2.0f - x;
-
-    // Stage 2 (with gain boost and cubic folding for smoother harmonics)
-    x *= kWavefoldStage2Gain;
-    if (x > 1.0f) {
-      float overshoot = x - 1.0f;
-      x = 1.0f - (overshoot * overshoot * overshoot); // Cubic fold
-    } else if (x < -1.0f) {
-      float overshoot = -x - 1.0f;
-      x = -1.0f + (overshoot * overshoot * overshoot); // Cubic fold
+  template <FilterMode F> static float SelectOutput(const SvfCore &svf) {
+    switch (F) {
+    case FILTER_HP:
+      return svf.High();
+    case FILTER_BP:
+      return svf.Band();
+    default: // LP
+      return svf.Low();
     }
-
-    // Stage 3 (subtle fold for complexity)
-    x *= kWavefoldStage3Gain;
-    if (x > 1.0f)
-      x = 2.0f - x;
-    else if (x < -1.0f)
-      x = -2.0f - x;
-
-    return x * kWavefoldOutputScale; // Scale down to prevent clipping
   }
 };
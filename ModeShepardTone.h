@@ -1,29 +1,61 @@
 #pragma once
+#include "ControlCurves.h"
+#include "ControlSnapshot.h"
+#include "FastMath.h"
+#include "Profiler.h"
+#include "ReverbService.h"
 #include "daisy_legio.h"
 #include "daisysp.h"
 #include <math.h>
+#include <stddef.h>
 
 using namespace daisy;
 using namespace daisysp;
 
-#define NUM_VOICES 8
-#define SHEPARD_TWOPI 6.28318530717958647692f
+// Voice bank layout: stacks of 8 voices spread over the 10-octave cycle.
+// Stack 0 is the classic Shepard layout; further stacks are slightly detuned
+// copies that thicken the tone.
+#define SHEPARD_VOICES_PER_STACK 8
+#define SHEPARD_MAX_STACKS 8
+#define SHEPARD_MAX_VOICES (SHEPARD_VOICES_PER_STACK * SHEPARD_MAX_STACKS)
 
 class ModeShepardTone {
 public:
-  void Init(float sample_rate) {
+  // Control targets: mapped from the panel in the main loop, applied in the
+  // audio callback (see ControlSnapshot.h)
+  struct Controls {
+    float speed = 0.2f; // Octaves per second
+    float tone_cutoff = 12000.0f;
+    float direction = 1.0f;
+    float range = 0.5f;
+    float base_freq = kBaseFreq; // Follows range
+    float reverb_amount = 0.3f;  // Encoder-driven
+  };
+
+  // The object itself is the hot voice bank (internal RAM); the reverb is
+  // the shared `reverb`
+  void Init(float sample_rate, ReverbService &reverb) {
     fs_ = sample_rate;
 
-    // Init 8 voices for cleaner sound (less mud)
-    for (int i = 0; i < NUM_VOICES; i++) {
-      voice_phase_[i] = (float)i / (float)NUM_VOICES;
-      osc_phasor_[i] = 0.0f;
+    // Voice bank (SoA): shared cycle position plus per-voice oscillator state
+    position_ = 0.0f;
+    for (int v = 0; v < SHEPARD_MAX_VOICES; v++) {
+      int stack = v / SHEPARD_VOICES_PER_STACK;
+      int k = v % SHEPARD_VOICES_PER_STACK;
+      voice_offset_[v] = (float)k / (float)SHEPARD_VOICES_PER_STACK +
+                         StackDetune(stack) * kStackDetune;
+
+      // Decorrelated start phases so the stacks do not sum coherently
+      float start = stack == 0 ? 0.0f : (float)v * kGoldenRatio;
+      osc_re_[v] = fastmath::CosTurns<kMathTier>(start);
+      osc_im_[v] = fastmath::SinTurns<kMathTier>(start);
+      amp_[v] = 0.0f;
     }
+    SetVoiceCount(kDefaultVoices);
 
     // Integrated Reverb for "Beautiful" sound
-    verb_.Init(fs_);
-    verb_.SetFeedback(0.85f);
-    verb_.SetLpFreq(10000.0f);
+    reverb_ = &reverb;
+    reverb_->Acquire(kVerbEngine, kVerbFeedback, kVerbLpFreq);
 
     // Stereo spread LFO
     lfo_spread_.Init(fs_);
@@ -37,6 +69,7 @@ public:
     // Default parameters
     speed_ = 0.2f;
     range_ = 0.5f;
+    base_freq_ = kBaseFreq;
     direction_ = 1.0f;
     reverb_amount_ = 0.3f;
     tone_cutoff_ = 12000.0f;
@@ -46,124 +79,192 @@ public:
     tone_filter_r_.Init(fs_);
     tone_filter_l_.SetRes(0.0f);
     tone_filter_r_.SetRes(0.0f);
+    tone_filter_l_.SetFreq(tone_cutoff_);
+    tone_filter_r_.SetFreq(tone_cutoff_ * kToneStereoSpread);
+    quality_ = 0;
   }
 
-  void Process(float in_l, float in_r, float *out_l, float *out_r) {
-    // 1. Calculate Envelope Position
-    float speed_val = speed_ * direction_;
-    float delta = speed_val / fs_; // increment per sample
-
-    float sum_l = 0.0f;
-    float sum_r = 0.0f;
-
-    float spread_mod = lfo_spread_.Process();
-
-    for (int i = 0; i < NUM_VOICES; i++) {
-      voice_phase_[i] += delta;
-      if (voice_phase_[i] >= 1.0f)
-        voice_phase_[i] -= 1.0f;
-      if (voice_phase_[i] < 0.0f)
-        voice_phase_[i] += 1.0f;
-
-      // Calculate Amplitude Envelope (Hann Window)
-      // 0.5 * (1 - cos(2*pi*x))
-      float envelope = 0.5f * (1.0f - cosf(voice_phase_[i] * SHEPARD_TWOPI));
-
-      // Calculate Frequency
-      // 20Hz * 2^(10 * position) -> 10 octaves range
-      float freq = 20.0f * powf(2.0f, voice_phase_[i] * 10.0f);
-
-      // Oscillator Generation (Pure Sine)
-      // Integrate phase: phase += freq/fs
-      osc_phasor_[i] += freq / fs_;
-      if (osc_phasor_[i] >= 1.0f)
-        osc_phasor_[i] -= 1.0f;
+  // Quality levels (QualityGovernor.h): 1 and 2 halve the voices, 32 to 16
+  // to 8; 3 also moves the reverb to the plate engine
+  static constexpr int kQualityLevels = 4;
+
+  // Audio callback, before ApplyControls
+  void SetQuality(int level) {
+    if (level == quality_)
+      return;
+    quality_ = level;
+    int halvings = quality_ < kQualityPlate ? quality_ : kQualityPlate - 1;
+    SetVoiceCount(kDefaultVoices >> halvings);
+    reverb_->Select(quality_ >= kQualityPlate ? ReverbEngine::kPlate
+                                              : kVerbEngine);
+    // Voices dropped now fade in from silence if they come back
+    for (int v = VoiceCount(); v < SHEPARD_MAX_VOICES; v++)
+      amp_[v] = 0.0f;
+  }
 
-      float sine_out = sinf(osc_phasor_[i] * SHEPARD_TWOPI);
+  int Quality() const { return quality_; }
 
-      // Stereo Pan based on LFO and voice index
-      float pan = spread_mod * 0.5f; // -0.5 to 0.5
-      // Add subtle offset per voice for width
-      if (i % 2 == 0)
-        pan += 0.2f;
-      else
-        pan -= 0.2f;
+  // Number of active voices, 8..64 in whole stacks of 8
+  void SetVoiceCount(int voices) {
+    int stacks = voices / SHEPARD_VOICES_PER_STACK;
+    if (stacks < 1)
+      stacks = 1;
+    if (stacks > SHEPARD_MAX_STACKS)
+      stacks = SHEPARD_MAX_STACKS;
+    num_stacks_ = stacks;
 
-      float gain_l = envelope * (0.5f + pan);
-      float gain_r = envelope * (0.5f - pan);
+    // Detuned stacks add incoherently: keep the level constant
+    voice_norm_ = kVoiceNormalization / sqrtf((float)stacks);
+  }
 
-      sum_l += sine_out * gain_l;
-      sum_r += sine_out * gain_r;
+  int VoiceCount() const { return num_stacks_ * SHEPARD_VOICES_PER_STACK; }
+
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    // Generator: inputs are ignored
+    (void)in_l;
+    (void)in_r;
+
+    // Envelope position increment per sample (one cycle = 10 octaves)
+    const float delta = speed_ * direction_ / fs_;
+
+    for (size_t offset = 0; offset < size; offset += kControlBlock) {
+      size_t n = size - offset;
+      if (n > kControlBlock)
+        n = kControlBlock;
+
+      // 1. Voice bank: even and odd voices are summed separately so the
+      // alternating pan offset can be applied once per sample afterwards
+      float even[kControlBlock];
+      float odd[kControlBlock];
+      for (size_t i = 0; i < n; i++) {
+        even[i] = 0.0f;
+        odd[i] = 0.0f;
+      }
+      {
+        LEGIO_PROFILE_SCOPE("shepard/voices");
+        RenderVoices(delta * (float)n, n, even, odd);
+      }
+
+      position_ += delta * (float)n;
+      if (position_ >= 1.0f)
+        position_ -= 1.0f;
+      if (position_ < 0.0f)
+        position_ += 1.0f;
+
+      // Pan, normalize and tone run over the block before the reverb so
+      // each is profiled as its own stage
+      float tone_l[kControlBlock];
+      float tone_r[kControlBlock];
+      {
+        LEGIO_PROFILE_SCOPE("shepard/tone");
+        for (size_t i = 0; i < n; i++) {
+          // Stereo Pan based on LFO and voice index: each voice is panned by
+          // spread_mod * 0.5 plus +/-0.2 (even/odd)
+          float spread_mod = lfo_spread_.Process();
+          float all = even[i] + odd[i];
+          float alt = even[i] - odd[i];
+          float sum_l = ((0.5f + 0.5f * spread_mod) * all + kVoicePan * alt);
+          float sum_r = ((0.5f - 0.5f * spread_mod) * all - kVoicePan * alt);
+
+          // 2. Normalize Sum (safe normalization for the active voice count)
+          sum_l *= voice_norm_;
+          sum_r *= voice_norm_;
+
+          // 3. Tone Shaping (Low Pass for warmth) - filters already
+          // configured in ApplyControls
+          tone_filter_l_.Process(sum_l);
+          tone_filter_r_.Process(sum_r);
+          tone_l[i] = tone_filter_l_.Low();
+          tone_r[i] = tone_filter_r_.Low();
+        }
+      }
+
+      {
+        LEGIO_PROFILE_SCOPE("shepard/reverb");
+        // 4. Reverb (The "Beauty" layer), over the block for the plate
+        float verb_l[kControlBlock];
+        float verb_r[kControlBlock];
+        reverb_->ProcessBlock(tone_l, tone_r, verb_l, verb_r, n);
+
+        for (size_t i = 0; i < n; i++) {
+          // Mix Reverb
+          float sum_l =
+              tone_l[i] * (1.0f - reverb_amount_) + verb_l[i] * reverb_amount_;
+          float sum_r =
+              tone_r[i] * (1.0f - reverb_amount_) + verb_r[i] * reverb_amount_;
+
+          // 5. Final Limiting (Safety)
+          // Soft tanh limit
+          out_l[offset + i] =
+              fastmath::Tanh<kMathTier>(sum_l * kFinalLimitGain) *
+              kFinalLimitScale;
+          out_r[offset + i] =
+              fastmath::Tanh<kMathTier>(sum_r * kFinalLimitGain) *
+              kFinalLimitScale;
+        }
+      }
     }
-
-    // 2. Normalize Sum (8 voices, safe normalization)
-    sum_l *= kVoiceNormalization;
-    sum_r *= kVoiceNormalization;
-
-    // 3. Tone Shaping (Low Pass for warmth) - filters already configured in
-    // UpdateControls
-    tone_filter_l_.Process(sum_l);
-    tone_filter_r_.Process(sum_r);
-    sum_l = tone_filter_l_.Low();
-    sum_r = tone_filter_r_.Low();
-
-    // 4. Reverb (The "Beauty" layer)
-    float verb_l, verb_r;
-    verb_.Process(sum_l, sum_r, &verb_l, &verb_r);
-
-    // Mix Reverb
-    sum_l = sum_l * (1.0f - reverb_amount_) + verb_l * reverb_amount_;
-    sum_r = sum_r * (1.0f - reverb_amount_) + verb_r * reverb_amount_;
-
-    // 5. Final Limiting (Safety)
-    // Soft tanh limit
-    sum_l = tanhf(sum_l * kFinalLimitGain) * kFinalLimitScale;
-    sum_r = tanhf(sum_r * kFinalLimitGain) * kFinalLimitScale;
-
-    *out_l = sum_l;
-    *out_r = sum_r;
   }
 
-  void UpdateControls(DaisyLegio &hw) {
+  // Main loop: targets for `frame`
+  void MapControls(const ControlFrame &frame, Controls &c) const {
     // Knob 1: Speed
-    float k_speed = hw.controls[DaisyLegio::CONTROL_KNOB_TOP].Value();
-    // Exponential speed: 0.01Hz to 5.0Hz (octaves per sec)
-    speed_ = kSpeedMin * powf(kSpeedRange, k_speed);
+    // Exponential speed: 0.01 to 1 octave per second
+    c.speed = control_curves::kShepardSpeedTable.Cubic(frame.knob_top);
 
     // Knob 2: Tone / Brightness
-    float k_tone = hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].Value();
-    tone_cutoff_ = kToneMin + (k_tone * k_tone * kToneRange); // 200Hz to 12kHz
-
-    // Update tone filters (moved from Process for efficiency)
-    tone_filter_l_.SetFreq(tone_cutoff_);
-    tone_filter_r_.SetFreq(tone_cutoff_ * kToneStereoSpread);
+    float k_tone = frame.knob_bottom;
+    c.tone_cutoff = kToneMin + (k_tone * k_tone * kToneRange); // 200Hz to 12kHz
 
     // Encoder Turn: Reverb Amount (The aesthetic control)
-    float inc = hw.encoder.Increment();
-    reverb_amount_ += inc * kReverbEncoderSensitivity;
-    if (reverb_amount_ > 1.0f)
-      reverb_amount_ = 1.0f;
-    if (reverb_amount_ < 0.0f)
-      reverb_amount_ = 0.0f;
+    float inc = frame.encoder;
+    c.reverb_amount += inc * kReverbEncoderSensitivity;
+    if (c.reverb_amount > 1.0f)
+      c.reverb_amount = 1.0f;
+    if (c.reverb_amount < 0.0f)
+      c.reverb_amount = 0.0f;
 
     // Sw Left: Direction
-    int sw_dir = hw.sw[DaisyLegio::SW_LEFT].Read();
-    if (sw_dir == 2)
-      direction_ = 1.0f; // Up
-    else if (sw_dir == 1)
-      direction_ = 0.0f; // Pause
+    if (frame.sw_left == 2)
+      c.direction = 1.0f; // Up
+    else if (frame.sw_left == 1)
+      c.direction = 0.0f; // Pause
     else
-      direction_ = -1.0f; // Down
+      c.direction = -1.0f; // Down
 
     // Sw Right: Frequency Range Center (Low, Mid, High)
-    int sw_range = hw.sw[DaisyLegio::SW_RIGHT].Read();
     // Just shifts the center octave
-    if (sw_range == 2)
-      range_ = 0.8f; // High
-    else if (sw_range == 1)
-      range_ = 0.5f; // Mid
+    float range = 0.5f;
+    if (frame.sw_right == 2)
+      range = 0.8f; // High
+    else if (frame.sw_right == 1)
+      range = 0.5f; // Mid
     else
-      range_ = 0.2f; // Low
+      range = 0.2f; // Low
+    if (range != c.range) {
+      c.range = range;
+      c.base_freq = kBaseFreq * fastmath::Exp2<kMathTier>(
+                                    (range - 0.5f) * kRangeShiftOctaves);
+    }
+  }
+
+  // Audio callback, once per buffer
+  void ApplyControls(const Controls &c) {
+    speed_ = c.speed;
+    direction_ = c.direction;
+    range_ = c.range;
+    base_freq_ = c.base_freq;
+    reverb_amount_ = c.reverb_amount;
+    reverb_->SetReturnLevel(reverb_amount_);
+
+    // Update tone filters when the cutoff moved (SetFreq recomputes the
+    // coefficients)
+    if (c.tone_cutoff != tone_cutoff_) {
+      tone_cutoff_ = c.tone_cutoff;
+      tone_filter_l_.SetFreq(tone_cutoff_);
+      tone_filter_r_.SetFreq(tone_cutoff_ * kToneStereoSpread);
+    }
   }
 
 private:
@@ -172,28 +273,125 @@ private:
   static constexpr float kToneStereoSpread = 1.1f;
   static constexpr float kFinalLimitGain = 1.5f;
   static constexpr float kFinalLimitScale = 0.9f;
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
+
+  // Voice Bank Constants
+  static constexpr int kDefaultVoices = 32;
+  static constexpr size_t kControlBlock = 32; // Envelope/frequency update rate
+  static constexpr float kBaseFreq = 20.0f;   // Bottom of the 10-octave cycle
+  static constexpr float kCycleOctaves = 10.0f;
+  static constexpr float kRangeShiftOctaves = 4.0f; // Low/High = -/+1.2 oct
+  static constexpr float kStackDetune = 3.3e-4f;    // ~4 cents per step
+  static constexpr float kGoldenRatio = 0.618034f;
+  static constexpr float kVoicePan = 0.2f;
+  static constexpr float kVoiceSkipLevel = 1.0e-3f; // -60 dB
+  static constexpr float kBandLimitStart = 0.35f;   // Fade out voices between
+  static constexpr float kBandLimitEnd = 0.45f;     // these fractions of fs
 
   // Control Constants
-  static constexpr float kSpeedMin = 0.01f;
-  static constexpr float kSpeedRange = 100.0f;
   static constexpr float kToneMin = 200.0f;
   static constexpr float kToneRange = 12000.0f;
   static constexpr float kReverbEncoderSensitivity = 0.05f;
+  static constexpr ReverbEngine kVerbEngine = ReverbEngine::kSc;
+  static constexpr int kQualityPlate = 3; // The cheaper engine (-B reverb)
+  static constexpr float kVerbFeedback = 0.85f;
+  static constexpr float kVerbLpFreq = 10000.0f;
 
   float fs_;
-  float voice_phase_[NUM_VOICES]; // 0.0 to 1.0 (shepard cycle position)
-  float osc_phasor_[NUM_VOICES];  // 0.0 to 1.0 (sine wave phase)
+
+  // Voice bank (structure of arrays)
+  float position_;                         // 0.0 to 1.0 (shepard cycle)
+  float voice_offset_[SHEPARD_MAX_VOICES]; // Cycle offset of each voice
+  float osc_re_[SHEPARD_MAX_VOICES];       // Quadrature oscillator state
+  float osc_im_[SHEPARD_MAX_VOICES];       // (im is the sine output)
+  float amp_[SHEPARD_MAX_VOICES];          // Amplitude at end of last block
+  int num_stacks_;
+  float voice_norm_;
+  int quality_;
 
   // Parameters
   float speed_;
   float range_;
+  float base_freq_; // Bottom frequency, shifted by range_
   float direction_;
   float reverb_amount_;
   float tone_cutoff_;
 
   // Modules
-  ReverbSc verb_;
+  ReverbService *reverb_; // Shared
   Oscillator lfo_spread_;
   Limiter limiter_;
   Svf tone_filter_l_, tone_filter_r_;
+
+  // 0, -1, +1, -2, +2, ... detune steps so fewer stacks stay centred
+  static float StackDetune(int stack) {
+    return (stack & 1) ? -(float)((stack + 1) / 2) : (float)(stack / 2);
+  }
+
+  // Adds `n` samples of every active voice into even[] / odd[]. Envelope and
+  // frequency are evaluated once per call: the envelope is ramped linearly
+  // from the previous call's value and each oscillator runs as a rotating
+  // phasor at the frequency of the block midpoint.
+  void RenderVoices(float step, size_t n, float *even, float *odd) {
+    const float inv_n = 1.0f / (float)n;
+    const float nyquist_start = kBandLimitStart * fs_;
+    const float band_limit_scale =
+        1.0f / ((kBandLimitEnd - kBandLimitStart) * fs_);
+    const int voices = num_stacks_ * SHEPARD_VOICES_PER_STACK;
+
+    for (int v = 0; v < voices; v++) {
+      // Cycle position at the start of the block (the end may run past 1.0;
+      // the Hann window is periodic and the frequency stays continuous)
+      float p0 = position_ + voice_offset_[v];
+      if (p0 >= 1.0f)
+        p0 -= 1.0f;
+      float p1 = p0 + step;
+      float pm = p0 + 0.5f * step;
+
+      // Frequency: base * 2^(10 * position)
+      float freq =
+          base_freq_ * fastmath::Exp2<kMathTier>(pm * kCycleOctaves);
+
+      // Amplitude Envelope (Hann Window): 0.5 * (1 - cos(2*pi*x)), faded out
+      // near Nyquist so range shifts never alias
+      float amp1 = 0.5f * (1.0f - fastmath::CosTurns<kMathTier>(p1));
+      float band_limit = 1.0f - (freq - nyquist_start) * band_limit_scale;
+      if (band_limit < 1.0f)
+        amp1 *= band_limit > 0.0f ? band_limit : 0.0f;
+      float amp0 = amp_[v];
+      amp_[v] = amp1;
+
+      // Skip voices that are inaudible after the envelope and the tone
+      // filter's 12 dB/oct roll-off
+      float peak = amp0 > amp1 ? amp0 : amp1;
+      if (freq > tone_cutoff_) {
+        float ratio = tone_cutoff_ / freq;
+        peak *= ratio * ratio;
+      }
+      if (peak < kVoiceSkipLevel)
+        continue;
+
+      // Rotating phasor: one complex multiply per sample
+      float w = freq / fs_;
+      float c = fastmath::CosTurns<kMathTier>(w);
+      float s = fastmath::SinTurns<kMathTier>(w);
+      float re = osc_re_[v];
+      float im = osc_im_[v];
+      float amp = amp0;
+      float amp_step = (amp1 - amp0) * inv_n;
+      float *dst = (v & 1) ? odd : even;
+      for (size_t i = 0; i < n; i++) {
+        float re_next = re * c - im * s;
+        im = re * s + im * c;
+        re = re_next;
+        amp += amp_step;
+        dst[i] += im * amp;
+      }
+
+      // Renormalise once per block (first-order correction of |z| to 1)
+      float g = 1.5f - 0.5f * (re * re + im * im);
+      osc_re_[v] = re * g;
+      osc_im_[v] = im * g;
+    }
+  }
 };
@@ -1,53 +1,128 @@
 #pragma once
+#include "ControlSnapshot.h"
+#include "DelayBuffer.h"
+#include "FastMath.h"
+#include "MemoryArena.h"
+#include "Oversampler.h"
+#include "PhaseVocoder.h"
+#include "Profiler.h"
+#include "ReverbService.h"
 #include "daisy_legio.h"
 #include "daisysp-lgpl.h"
 #include "daisysp.h"
 #include <stddef.h>
+#include <string.h>
 
 using namespace daisy;
 using namespace daisysp;
 
+// The pitch-shift feedback loop is multirate: the reverb output is collected
+// in frames of kLoopFrame samples, decimated by kLoopFactor, run through the
+// loop (anti-rumble, pitch shift, tone, DC blocker, compressor, limiter) at
+// the reduced rate and interpolated back, and the result is fed into the
+// reverb during the next frame. The loop is band-limited by its tone filter
+// anyway, so it loses nothing audible, and one frame of feedback latency on
+// top of the reverb's own is inaudible.
+//
+// The loop's pitch shift runs on one of two engines (kPitchEngine):
+// daisysp::PitchShifter, two crossfaded delay taps per sample, or
+// PhaseVocoder, a phase-locked FFT shifter with purer partials at about five
+// times the cost and one vocoder frame of extra feedback latency
+// (`legio_host -B pitch` compares them).
+enum class PitchEngine { kDelay, kVocoder };
+
 class ModeShimmerReverb {
 public:
-  void Init(float sample_rate) {
+  // Control targets: mapped from the panel in the main loop, applied in the
+  // audio callback (see ControlSnapshot.h)
+  struct Controls {
+    float pitch = 12.0f;          // Semitones, before the stereo detune
+    float tone_freq = 5000.0f;    // Loop tone low-pass
+    float verb_lp_freq = 4000.0f; // Reverb damping
+    float hpf = 250.0f;           // Input high-pass
+    float decay = 0.7f;           // Reverb feedback
+    float shimmer_amount = 0.0f;  // Encoder-driven
+  };
+
+  // The object itself is the hot per-sample state (internal RAM); the pitch
+  // shifters (of kPitchEngine) and pre-delay lines are taken from `arena`
+  // (SDRAM) and the reverb is the shared `reverb`. Returns false if they do
+  // not fit (ArenaBytes() is the exact requirement).
+  bool Init(float sample_rate, MemoryArena &arena, ReverbService &reverb) {
     fs_ = sample_rate;
 
-    // Init Reverb (ReverbSc - Sean Costello FDN)
+    pshift_l_ = pshift_r_ = nullptr;
+    vocoder_l_ = vocoder_r_ = nullptr;
+    bool shifters;
+    if (kPitchEngine == PitchEngine::kVocoder) {
+      vocoder_l_ = arena.New<Vocoder>();
+      vocoder_r_ = arena.New<Vocoder>();
+      shifters = vocoder_l_ && vocoder_r_;
+    } else {
+      pshift_l_ = arena.New<PitchShifter>();
+      pshift_r_ = arena.New<PitchShifter>();
+      shifters = pshift_l_ && pshift_r_;
+    }
+    predelay_ = PredelaySamples(fs_);
+    size_t length = predelay_ + kChunk; // Longest ReadBlock delay
+    size_t buf_size = DelayBuffer::BufferSize(length, kChunk);
+    float *buf_l = arena.Allocate<float>(buf_size);
+    float *buf_r = arena.Allocate<float>(buf_size);
+    if (!shifters || !buf_l || !buf_r)
+      return false;
+
+    // Shared Reverb (ReverbSc - Sean Costello FDN)
     // Tuned for "Lush" sound
-    verb_.Init(fs_);
-    verb_.SetFeedback(0.85f);
-    verb_.SetLpFreq(3500.0f); // Lower cutoff for warmer, less metallic sound
-
-    // Init Pitch Shifter
-    pshift_l_.Init(fs_);
-    pshift_r_.Init(fs_);
-    pshift_l_.SetTransposition(12.0f);
-    pshift_r_.SetTransposition(12.0f);
+    reverb_ = &reverb;
+    reverb_->Acquire(kVerbEngine, kVerbFeedback, kVerbLpFreq);
+
+    // Init Loop Resampling
+    float loop_fs = fs_ / (float)kLoopFactor;
+    loop_down_l_.Init(kHalfbandSteep);
+    loop_down_r_.Init(kHalfbandSteep);
+    loop_up_l_.Init(kHalfbandSteep);
+    loop_up_r_.Init(kHalfbandSteep);
+
+    // Init Pitch Shifter (at the loop rate, same window length in seconds)
+    if (kPitchEngine == PitchEngine::kVocoder) {
+      // Frames alternate between the channels
+      vocoder_l_->Init(loop_fs);
+      vocoder_r_->Init(loop_fs, Vocoder::kHop / 2);
+      vocoder_l_->SetTransposition(12.0f);
+      vocoder_r_->SetTransposition(12.0f);
+    } else {
+      pshift_l_->Init(loop_fs);
+      pshift_r_->Init(loop_fs);
+      pshift_l_->SetDelSize(SHIFT_BUFFER_SIZE / kLoopFactor);
+      pshift_r_->SetDelSize(SHIFT_BUFFER_SIZE / kLoopFactor);
+      pshift_l_->SetTransposition(12.0f);
+      pshift_r_->SetTransposition(12.0f);
+    }
 
     // Init Tone Filter
-    tone_filter_.Init(fs_);
+    tone_filter_.Init(loop_fs);
     tone_filter_.SetFreq(10000.0f);
     tone_filter_.SetRes(0.0f);
 
-    tone_filter_r_.Init(fs_);
+    tone_filter_r_.Init(loop_fs);
     tone_filter_r_.SetFreq(10000.0f);
     tone_filter_r_.SetRes(0.0f);
 
     // Init DC Blocker
-    dc_blocker_.Init(fs_);
+    dc_blocker_.Init(loop_fs);
     dc_blocker_.SetFreq(20.0f);
     dc_blocker_.SetRes(0.0f);
 
-    dc_blocker_r_.Init(fs_);
+    dc_blocker_r_.Init(loop_fs);
     dc_blocker_r_.SetFreq(20.0f);
     dc_blocker_r_.SetRes(0.0f);
 
     // Init Anti-Rumble Filter
-    anti_rumble_.Init(fs_);
+    anti_rumble_.Init(loop_fs);
     anti_rumble_.SetFreq(150.0f);
     anti_rumble_.SetRes(0.0f);
 
-    anti_rumble_r_.Init(fs_);
+    anti_rumble_r_.Init(loop_fs);
     anti_rumble_r_.SetFreq(150.0f);
     anti_rumble_r_.SetRes(0.0f);
 
@@ -69,195 +144,244 @@ public:
     input_hpf_r2_.SetFreq(250.0f);
     input_hpf_r2_.SetRes(0.0f);
 
-    // Init Pre-Delay
-    predelay_l_.Init();
-    predelay_r_.Init();
-    predelay_l_.SetDelay(kPredelayTime * fs_);
-    predelay_r_.SetDelay(kPredelayTime * fs_);
+    // Init Pre-Delay (whole samples: read back as one block per chunk)
+    predelay_l_.Init(buf_l, length, kChunk, false); // Arena memory is zero
+    predelay_r_.Init(buf_r, length, kChunk, false);
 
     shimmer_amount_ = 0.0f;
-    mix_ = 0.5f;
-    shimmer_fb_l_ = 0.0f;
-    shimmer_fb_r_ = 0.0f;
+    // Mix is fixed at 0.5 (50/50) since bottom knob controls HPF
+    mix_ = kMixFixed;
+    reverb_->SetReturnLevel(mix_);
+    decay_ = 0.0f; // The first ApplyControls sets the decay
+    memset(loop_in_l_, 0, sizeof(loop_in_l_));
+    memset(loop_in_r_, 0, sizeof(loop_in_r_));
+    memset(loop_fb_l_, 0, sizeof(loop_fb_l_));
+    memset(loop_fb_r_, 0, sizeof(loop_fb_r_));
+    loop_pos_ = 0;
     shimmer_env_l_ = 0.0f;
     shimmer_env_r_ = 0.0f;
+    // Per-sample time constants, per loop sample and per frame
+    loop_comp_attack_ = powf(kShimmerCompAttack, (float)kLoopFactor);
+    pitch_smooth_frame_ =
+        1.0f - powf(1.0f - kPitchSmoothCoeff, (float)kLoopFrame);
     hpf_freq_ = 250.0f;
+    hpf_applied_ = hpf_freq_;
+    tone_freq_ = 0.0f; // The first ApplyControls sets the tone
     target_pitch_l_ = 12.0f;
     target_pitch_r_ = 12.0f;
     current_pitch_l_ = 12.0f;
     current_pitch_r_ = 12.0f;
+    shifter_pitch_l_ = 12.0f;
+    shifter_pitch_r_ = 12.0f;
+    quality_ = 0;
+    return true;
   }
 
-  void Process(float in_l, float in_r, float *out_l, float *out_r) {
-    float verb_out_l, verb_out_r;
-
-    // 1. Variable Input HPF (2-pole for smooth slope)
-    input_hpf_l_.Process(in_l);
-    input_hpf_r_.Process(in_r);
-    float stage1_l = input_hpf_l_.High();
-    float stage1_r = input_hpf_r_.High();
-
-    // Stage 2 for 24dB/oct slope
-    input_hpf_l2_.Process(stage1_l);
-    input_hpf_r2_.Process(stage1_r);
-    float wet_in_l = input_hpf_l2_.High();
-    float wet_in_r = input_hpf_r2_.High();
-
-    // Attenuate input to prevent internal clipping
-    wet_in_l *= kInputAttenuation;
-    wet_in_r *= kInputAttenuation;
-
-    // 2. Pre-Delay with Hermite Interpolation
-    predelay_l_.Write(wet_in_l);
-    predelay_r_.Write(wet_in_r);
-    float pre_l = predelay_l_.ReadHermite(kPredelayTime * fs_);
-    float pre_r = predelay_r_.ReadHermite(kPredelayTime * fs_);
-
-    // 3. Reverb Engine
-    // Add Shimmer Feedback to Input
-    float shimmer_in_l = pre_l + (shimmer_fb_l_ * shimmer_amount_);
-    float shimmer_in_r = pre_r + (shimmer_fb_r_ * shimmer_amount_);
-
-    verb_.Process(shimmer_in_l, shimmer_in_r, &verb_out_l, &verb_out_r);
-
-    // 4. Pitch Shift Loop with Compression
-    anti_rumble_.Process(verb_out_l);
-    float clean_l = anti_rumble_.High();
+  // Quality levels (QualityGovernor.h): 1 runs the pitch loop in mono. The
+  // reverb stays on ReverbSc: it sits inside the pitch loop, whose gain is
+  // tuned on it, so the plate (Echo and Shepard's last level) is no option.
+  static constexpr int kQualityLevels = 2;
 
-    anti_rumble_r_.Process(verb_out_r);
-    float clean_r = anti_rumble_r_.High();
+  // Audio callback, before ApplyControls
+  void SetQuality(int level) { quality_ = level; }
 
-    // Smooth pitch transitions to reduce artifacts
-    fonepole(current_pitch_l_, target_pitch_l_, kPitchSmoothCoeff);
-    fonepole(current_pitch_r_, target_pitch_r_, kPitchSmoothCoeff);
-    pshift_l_.SetTransposition(current_pitch_l_);
-    pshift_r_.SetTransposition(current_pitch_r_);
+  int Quality() const { return quality_; }
 
-    float shifted_l = pshift_l_.Process(clean_l);
-    float shifted_r = pshift_r_.Process(clean_r);
-
-    tone_filter_.Process(shifted_l);
-    float filtered_shifted_l = tone_filter_.Low();
-
-    tone_filter_r_.Process(shifted_r);
-    float filtered_shifted_r = tone_filter_r_.Low();
-
-    dc_blocker_.Process(filtered_shifted_l);
-    filtered_shifted_l = dc_blocker_.High();
-
-    dc_blocker_r_.Process(filtered_shifted_r);
-    filtered_shifted_r = dc_blocker_r_.High();
-
-    // Shimmer Loop Compressor (Envelope Follower + Soft Knee)
-    shimmer_env_l_ = kShimmerCompAttack * shimmer_env_l_ +
-                     kShimmerCompRelease * fabsf(filtered_shifted_l);
-    shimmer_env_r_ = kShimmerCompAttack * shimmer_env_r_ +
-                     kShimmerCompRelease * fabsf(filtered_shifted_r);
+  static constexpr size_t PredelaySamples(float sample_rate) {
+    return (size_t)(kPredelayTime * sample_rate + 0.5f);
+  }
 
-    float shimmer_gain_l = 1.0f;
-    float shimmer_gain_r = 1.0f;
+  // SDRAM taken by Init at this sample rate
+  static constexpr size_t ArenaBytes(float sample_rate) {
+    return 2 * (kPitchEngine == PitchEngine::kVocoder
+                    ? MemoryArena::Footprint<Vocoder>(1)
+                    : MemoryArena::Footprint<PitchShifter>(1)) +
+           2 * MemoryArena::Footprint<float>(DelayBuffer::BufferSize(
+                   PredelaySamples(sample_rate) + kChunk, kChunk));
+  }
 
-    if (shimmer_env_l_ > kShimmerThreshold) {
-      float over = shimmer_env_l_ - kShimmerThreshold;
-      shimmer_gain_l =
-          kShimmerThreshold / (kShimmerThreshold + over * kShimmerCompRatio);
-    }
-    if (shimmer_env_r_ > kShimmerThreshold) {
-      float over = shimmer_env_r_ - kShimmerThreshold;
-      shimmer_gain_r =
-          kShimmerThreshold / (kShimmerThreshold + over * kShimmerCompRatio);
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    for (size_t offset = 0; offset < size; offset += kChunk) {
+      size_t n = size - offset;
+      if (n > kChunk)
+        n = kChunk;
+      const float *chunk_in_l = in_l + offset;
+      const float *chunk_in_r = in_r + offset;
+      float pre_l[kChunk], pre_r[kChunk];
+
+      // 1. Variable Input HPF (2-pole for smooth slope)
+      {
+        LEGIO_PROFILE_SCOPE("shimmer/hpf");
+        for (size_t i = 0; i < n; i++) {
+          input_hpf_l_.Process(chunk_in_l[i]);
+          input_hpf_r_.Process(chunk_in_r[i]);
+          float stage1_l = input_hpf_l_.High();
+          float stage1_r = input_hpf_r_.High();
+
+          // Stage 2 for 24dB/oct slope
+          input_hpf_l2_.Process(stage1_l);
+          input_hpf_r2_.Process(stage1_r);
+
+          // Attenuate input to prevent internal clipping
+          pre_l[i] = input_hpf_l2_.High() * kInputAttenuation;
+          pre_r[i] = input_hpf_r2_.High() * kInputAttenuation;
+        }
+      }
+
+      // 2. Pre-Delay: write the chunk, read it back predelay_ samples late
+      // (sample i comes from predelay_ - 1 writes before its own)
+      {
+        LEGIO_PROFILE_SCOPE("shimmer/predelay");
+        predelay_l_.WriteBlock(pre_l, n);
+        predelay_r_.WriteBlock(pre_r, n);
+        predelay_l_.ReadBlock(pre_l, n, predelay_ - 1 + n);
+        predelay_r_.ReadBlock(pre_r, n, predelay_ - 1 + n);
+      }
+
+      // 3. Reverb Engine, fed with the previous loop frame's output and
+      // split at loop frame boundaries
+      float verb_l[kChunk], verb_r[kChunk];
+      for (size_t i = 0; i < n;) {
+        size_t span = n - i;
+        if (span > kLoopFrame - loop_pos_)
+          span = kLoopFrame - loop_pos_;
+
+        // Add Shimmer Feedback to Input (pre_ becomes the send)
+        for (size_t j = 0; j < span; j++) {
+          pre_l[i + j] += loop_fb_l_[loop_pos_ + j] * shimmer_amount_;
+          pre_r[i + j] += loop_fb_r_[loop_pos_ + j] * shimmer_amount_;
+        }
+        {
+          LEGIO_PROFILE_SCOPE("shimmer/reverb");
+          reverb_->ProcessBlock(pre_l + i, pre_r + i, verb_l + i, verb_r + i,
+                                span);
+        }
+
+        memcpy(loop_in_l_ + loop_pos_, verb_l + i, span * sizeof(float));
+        memcpy(loop_in_r_ + loop_pos_, verb_r + i, span * sizeof(float));
+        loop_pos_ += span;
+        i += span;
+        if (loop_pos_ == kLoopFrame) {
+          if (quality_ >= kQualityMonoLoop)
+            RunLoop<false>();
+          else
+            RunLoop<true>();
+          loop_pos_ = 0;
+        }
+      }
+
+      {
+        LEGIO_PROFILE_SCOPE("shimmer/mix");
+        for (size_t i = 0; i < n; i++) {
+          // Safety Limiter for Reverb Output (before mix)
+          float verb_out_l = fastmath::Tanh<kMathTier>(verb_l[i]);
+          float verb_out_r = fastmath::Tanh<kMathTier>(verb_r[i]);
+
+          // 5. Mix Output
+          out_l[offset + i] =
+              (chunk_in_l[i] * (1.0f - mix_)) + (verb_out_l * mix_);
+          out_r[offset + i] =
+              (chunk_in_r[i] * (1.0f - mix_)) + (verb_out_r * mix_);
+        }
+      }
     }
-
-    filtered_shifted_l *= shimmer_gain_l;
-    filtered_shifted_r *= shimmer_gain_r;
-
-    // Soft Limiter for Feedback Loop
-    filtered_shifted_l =
-        tanhf(filtered_shifted_l * kShimmerLimitGain) * kShimmerLimitScale;
-    filtered_shifted_r =
-        tanhf(filtered_shifted_r * kShimmerLimitGain) * kShimmerLimitScale;
-
-    // Update feedback vars for next frame
-    shimmer_fb_l_ = filtered_shifted_l;
-    shimmer_fb_r_ = filtered_shifted_r;
-
-    // Safety Limiter for Reverb Output (before mix)
-    verb_out_l = tanhf(verb_out_l);
-    verb_out_r = tanhf(verb_out_r);
-
-    // 5. Mix Output
-    *out_l = (in_l * (1.0f - mix_)) + (verb_out_l * mix_);
-    *out_r = (in_r * (1.0f - mix_)) + (verb_out_r * mix_);
   }
 
-  void UpdateControls(DaisyLegio &hw) {
+  // Main loop: targets for `frame`
+  void MapControls(const ControlFrame &frame, Controls &c) const {
     // Knobs
-    float k_decay = hw.controls[DaisyLegio::CONTROL_KNOB_TOP].Value();
-    float k_hpf = hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].Value();
+    float k_decay = frame.knob_top;
+    float k_hpf = frame.knob_bottom;
 
     // Encoder Turn (Shimmer Amount)
-    float inc = hw.encoder.Increment();
-    shimmer_amount_ += inc * kShimmerEncoderSensitivity;
-    shimmer_amount_ = fclamp(shimmer_amount_, 0.0f, kShimmerAmountMax);
-
-    // Switches
-    int sw_pitch = hw.sw[DaisyLegio::SW_LEFT].Read();
-    int sw_tone = hw.sw[DaisyLegio::SW_RIGHT].Read();
+    float inc = frame.encoder;
+    c.shimmer_amount += inc * kShimmerEncoderSensitivity;
+    c.shimmer_amount = fclamp(c.shimmer_amount, 0.0f, kShimmerAmountMax);
 
     // Map Pitch Interval (Left Switch)
-    float base_pitch = 12.0f;
-    if (sw_pitch == 2)
-      base_pitch = kPitchOctaveUp;
-    else if (sw_pitch == 1)
-      base_pitch = kPitchFifthUp;
+    if (frame.sw_left == 2)
+      c.pitch = kPitchOctaveUp;
+    else if (frame.sw_left == 1)
+      c.pitch = kPitchFifthUp;
     else
-      base_pitch = kPitchOctaveDown;
-
-    // Set target pitch with slight detune for width (+/- 5 cents)
-    target_pitch_l_ = base_pitch - kPitchDetune;
-    target_pitch_r_ = base_pitch + kPitchDetune;
+      c.pitch = kPitchOctaveDown;
 
     // Map Tone (Right Switch)
-    if (sw_tone == 2) { // Bright
-      tone_filter_.SetFreq(kToneBrightFreq);
-      tone_filter_r_.SetFreq(kToneBrightFreq);
-      verb_.SetLpFreq(kVerbBrightFreq);
-    } else if (sw_tone == 1) { // Normal
-      tone_filter_.SetFreq(kToneNormalFreq);
-      tone_filter_r_.SetFreq(kToneNormalFreq);
-      verb_.SetLpFreq(kVerbNormalFreq);
+    if (frame.sw_right == 2) { // Bright
+      c.tone_freq = kToneBrightFreq;
+      c.verb_lp_freq = kVerbBrightFreq;
+    } else if (frame.sw_right == 1) { // Normal
+      c.tone_freq = kToneNormalFreq;
+      c.verb_lp_freq = kVerbNormalFreq;
     } else { // Dark
-      tone_filter_.SetFreq(kToneDarkFreq);
-      tone_filter_r_.SetFreq(kToneDarkFreq);
-      verb_.SetLpFreq(kVerbDarkFreq);
+      c.tone_freq = kToneDarkFreq;
+      c.verb_lp_freq = kVerbDarkFreq;
     }
 
     // Variable HPF (150Hz - 500Hz) controlled by bottom knob
-    float target_hpf = kHPFMin + (k_hpf * kHPFRange);
-    fonepole(hpf_freq_, target_hpf, kHPFSmoothCoeff);
-    input_hpf_l_.SetFreq(hpf_freq_);
-    input_hpf_r_.SetFreq(hpf_freq_);
-    input_hpf_l2_.SetFreq(hpf_freq_);
-    input_hpf_r2_.SetFreq(hpf_freq_);
+    c.hpf = kHPFMin + (k_hpf * kHPFRange);
 
     // Map decay to feedback 0.7 -> 0.98
-    verb_.SetFeedback(kDecayMin + (k_decay * kDecayRange));
+    c.decay = kDecayMin + (k_decay * kDecayRange);
+  }
 
-    // Mix is now fixed at 0.5 (50/50) since bottom knob controls HPF
-    mix_ = kMixFixed;
+  // Audio callback, once per buffer
+  void ApplyControls(const Controls &c) {
+    shimmer_amount_ = c.shimmer_amount;
+
+    // Set target pitch with slight detune for width (+/- 5 cents)
+    target_pitch_l_ = c.pitch - kPitchDetune;
+    target_pitch_r_ = c.pitch + kPitchDetune;
+
+    // Filter frequencies are only set when they move: SetFreq recomputes
+    // the coefficients
+    if (c.tone_freq != tone_freq_) {
+      tone_freq_ = c.tone_freq;
+      tone_filter_.SetFreq(tone_freq_);
+      tone_filter_r_.SetFreq(tone_freq_);
+      reverb_->SetLpFreq(c.verb_lp_freq);
+    }
+
+    fonepole(hpf_freq_, c.hpf, kHPFSmoothCoeff);
+    if (hpf_freq_ != hpf_applied_) {
+      hpf_applied_ = hpf_freq_;
+      input_hpf_l_.SetFreq(hpf_freq_);
+      input_hpf_r_.SetFreq(hpf_freq_);
+      input_hpf_l2_.SetFreq(hpf_freq_);
+      input_hpf_r2_.SetFreq(hpf_freq_);
+    }
+
+    if (c.decay != decay_) {
+      decay_ = c.decay;
+      reverb_->SetFeedback(decay_);
+    }
   }
 
 private:
   // Audio Processing Constants
   static constexpr float kPredelayTime = 0.04f;
+  static constexpr size_t kChunk = 64;
+  // Loop at half rate: the decimator is flat to 7.2 kHz, so the loop tones
+  // stay below that (see kToneBrightFreq); quarter rate (6 kHz Nyquist)
+  // would cut into the Normal tone
+  static constexpr int kLoopFactor = 2;
+  static constexpr size_t kLoopFrame = 64; // Samples of feedback latency
+  static constexpr size_t kLoopSize = kLoopFrame / kLoopFactor;
+  static_assert(kLoopSize <= HalfbandFilter<10>::kMaxSize,
+                "loop frame does not fit the halfband buffers");
+  static constexpr int kQualityMonoLoop = 1;
   static constexpr float kInputAttenuation = 0.8f;
   static constexpr float kPitchSmoothCoeff = 0.001f;
-  static constexpr float kShimmerCompAttack = 0.99f;
-  static constexpr float kShimmerCompRelease = 0.01f;
+  static constexpr float kShimmerCompAttack = 0.99f; // Per sample
   static constexpr float kShimmerThreshold = 0.4f;
   static constexpr float kShimmerCompRatio = 0.66f;
   static constexpr float kShimmerLimitGain = 1.1f;
   static constexpr float kShimmerLimitScale = 0.9f;
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
+  static constexpr PitchEngine kPitchEngine = PitchEngine::kDelay;
+  // 1024 points at the loop rate: 23 Hz bins, 43 ms frames
+  using Vocoder = PhaseVocoder<10>;
 
   // Control Constants
   static constexpr float kShimmerEncoderSensitivity = 0.05f;
@@ -274,28 +398,161 @@ private:
   static constexpr float kMixFixed = 0.5f;
 
   // Tone Constants
-  static constexpr float kToneBrightFreq = 15000.0f;
+  // Bright sits inside the half-rate loop's passband (see kLoopFactor): the
+  // loop cannot carry 15 kHz, and the Svf caps its cutoff at a third of
+  // the loop rate (8 kHz)
+  static constexpr float kToneBrightFreq = 7000.0f;
   static constexpr float kToneNormalFreq = 5000.0f;
   static constexpr float kToneDarkFreq = 1000.0f;
+  // The denser tail suits the pitch-shifted loop
+  static constexpr ReverbEngine kVerbEngine = ReverbEngine::kSc;
+  static constexpr float kVerbFeedback = 0.85f;
+  static constexpr float kVerbLpFreq = 3500.0f; // Warmer, less metallic
   static constexpr float kVerbBrightFreq = 12000.0f;
   static constexpr float kVerbNormalFreq = 4000.0f;
   static constexpr float kVerbDarkFreq = 1000.0f;
 
-  ReverbSc verb_;
-  PitchShifter pshift_l_, pshift_r_;
+  ReverbService *reverb_;              // Shared
+  PitchShifter *pshift_l_, *pshift_r_; // In the arena, kDelay
+  Vocoder *vocoder_l_, *vocoder_r_;    // In the arena, kVocoder
   Svf tone_filter_, tone_filter_r_;
   Svf dc_blocker_, dc_blocker_r_;
   Svf anti_rumble_, anti_rumble_r_;
-  Svf input_hpf_l_, input_hpf_r_;                  // Input HPF stage 1
-  Svf input_hpf_l2_, input_hpf_r2_;                // Input HPF stage 2 (2-pole)
-  DelayLine<float, 4800> predelay_l_, predelay_r_; // ~100ms max
+  Svf input_hpf_l_, input_hpf_r_;       // Input HPF stage 1
+  Svf input_hpf_l2_, input_hpf_r2_;     // Input HPF stage 2 (2-pole)
+  DelayBuffer predelay_l_, predelay_r_; // Storage in the arena
+  size_t predelay_;                     // Samples
   float fs_;
 
   float shimmer_amount_;
   float mix_;
-  float shimmer_fb_l_, shimmer_fb_r_;
+  float decay_; // Feedback the reverb is set to
+  int quality_;
   float shimmer_env_l_, shimmer_env_r_;     // Shimmer loop compressor envelope
   float hpf_freq_;                          // Variable HPF frequency
+  float hpf_applied_;                       // Last set on the filters
+  float tone_freq_;                         // Last set on the tone filters
   float target_pitch_l_, target_pitch_r_;   // Target pitch for smoothing
   float current_pitch_l_, current_pitch_r_; // Current pitch (smoothed)
+  float shifter_pitch_l_, shifter_pitch_r_; // Pitch the shifters are set to
+  float loop_comp_attack_;                  // At the loop rate
+  float pitch_smooth_frame_;                // Per loop frame
+
+  // Multirate loop: frame being collected, feedback being played
+  HalfbandFilter<10> loop_down_l_, loop_down_r_, loop_up_l_, loop_up_r_;
+  float loop_in_l_[kLoopFrame], loop_in_r_[kLoopFrame];
+  float loop_fb_l_[kLoopFrame], loop_fb_r_[kLoopFrame];
+  size_t loop_pos_;
+
+  // 4. Pitch Shift Loop with Compression, one frame at the loop rate:
+  // loop_in_ (reverb output) -> loop_fb_ (fed back during the next frame).
+  // Mono (quality level 1 and up) runs the left chain alone on the mid of
+  // the frame and feeds it back to both sides; the right chain is left as
+  // it was and resumes from there.
+  template <bool kStereo> void RunLoop() {
+    LEGIO_PROFILE_SCOPE("shimmer/pitch loop");
+    float loop_l[kLoopSize], loop_r[kLoopSize];
+    if (!kStereo)
+      for (size_t i = 0; i < kLoopFrame; i++)
+        loop_in_l_[i] = 0.5f * (loop_in_l_[i] + loop_in_r_[i]);
+    loop_down_l_.Downsample(loop_in_l_, loop_l, kLoopSize);
+    if (kStereo)
+      loop_down_r_.Downsample(loop_in_r_, loop_r, kLoopSize);
+
+    // Smooth pitch transitions to reduce artifacts (once per frame)
+    fonepole(current_pitch_l_, target_pitch_l_, pitch_smooth_frame_);
+    fonepole(current_pitch_r_, target_pitch_r_, pitch_smooth_frame_);
+
+    for (size_t i = 0; i < kLoopSize; i++) {
+      anti_rumble_.Process(loop_l[i]);
+      loop_l[i] = anti_rumble_.High();
+
+      if (kStereo) {
+        anti_rumble_r_.Process(loop_r[i]);
+        loop_r[i] = anti_rumble_r_.High();
+      }
+    }
+
+    // Retune only while the smoothed pitch moves
+    if (current_pitch_l_ != shifter_pitch_l_ ||
+        current_pitch_r_ != shifter_pitch_r_) {
+      shifter_pitch_l_ = current_pitch_l_;
+      shifter_pitch_r_ = current_pitch_r_;
+      if (kPitchEngine == PitchEngine::kVocoder) {
+        vocoder_l_->SetTransposition(shifter_pitch_l_);
+        vocoder_r_->SetTransposition(shifter_pitch_r_);
+      } else {
+        pshift_l_->SetTransposition(shifter_pitch_l_);
+        pshift_r_->SetTransposition(shifter_pitch_r_);
+      }
+    }
+
+    if (kPitchEngine == PitchEngine::kVocoder) {
+      vocoder_l_->ProcessBlock(loop_l, kLoopSize);
+      if (kStereo)
+        vocoder_r_->ProcessBlock(loop_r, kLoopSize);
+    } else {
+      for (size_t i = 0; i < kLoopSize; i++) {
+        loop_l[i] = pshift_l_->Process(loop_l[i]);
+        if (kStereo)
+          loop_r[i] = pshift_r_->Process(loop_r[i]);
+      }
+    }
+
+    float env_l = shimmer_env_l_;
+    float env_r = shimmer_env_r_;
+    for (size_t i = 0; i < kLoopSize; i++) {
+      float shifted_l = loop_l[i];
+      tone_filter_.Process(shifted_l);
+      float filtered_shifted_l = tone_filter_.Low();
+      dc_blocker_.Process(filtered_shifted_l);
+      filtered_shifted_l = dc_blocker_.High();
+
+      // Shimmer Loop Compressor (Envelope Follower + Soft Knee)
+      env_l = loop_comp_attack_ * env_l +
+              (1.0f - loop_comp_attack_) * fabsf(filtered_shifted_l);
+      float shimmer_gain_l = 1.0f;
+      if (env_l > kShimmerThreshold) {
+        float over = env_l - kShimmerThreshold;
+        shimmer_gain_l =
+            kShimmerThreshold / (kShimmerThreshold + over * kShimmerCompRatio);
+      }
+      filtered_shifted_l *= shimmer_gain_l;
+
+      // Soft Limiter for Feedback Loop
+      loop_l[i] =
+          fastmath::Tanh<kMathTier>(filtered_shifted_l * kShimmerLimitGain) *
+          kShimmerLimitScale;
+
+      if (kStereo) {
+        float shifted_r = loop_r[i];
+        tone_filter_r_.Process(shifted_r);
+        float filtered_shifted_r = tone_filter_r_.Low();
+        dc_blocker_r_.Process(filtered_shifted_r);
+        filtered_shifted_r = dc_blocker_r_.High();
+
+        env_r = loop_comp_attack_ * env_r +
+                (1.0f - loop_comp_attack_) * fabsf(filtered_shifted_r);
+        float shimmer_gain_r = 1.0f;
+        if (env_r > kShimmerThreshold) {
+          float over = env_r - kShimmerThreshold;
+          shimmer_gain_r = kShimmerThreshold /
+                           (kShimmerThreshold + over * kShimmerCompRatio);
+        }
+        filtered_shifted_r *= shimmer_gain_r;
+
+        loop_r[i] =
+            fastmath::Tanh<kMathTier>(filtered_shifted_r * kShimmerLimitGain) *
+            kShimmerLimitScale;
+      }
+    }
+    shimmer_env_l_ = env_l;
+    shimmer_env_r_ = env_r;
+
+    loop_up_l_.Upsample(loop_l, loop_fb_l_, kLoopSize);
+    if (kStereo)
+      loop_up_r_.Upsample(loop_r, loop_fb_r_, kLoopSize);
+    else
+      memcpy(loop_fb_r_, loop_fb_l_, sizeof(loop_fb_r_));
+  }
 };
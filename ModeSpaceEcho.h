@@ -1,4 +1,14 @@
 #pragma once
+#include "BlockDelayBuffer.h"
+#include "ControlCurves.h"
+#include "ControlSnapshot.h"
+#include "DelayBuffer.h"
+#include "FastMath.h"
+#include "MemoryArena.h"
+#include "Oversampler.h"
+#include "Profiler.h"
+#include "ReverbService.h"
+#include "SvfCore.h"
 #include "daisy_legio.h"
 #include "daisysp-lgpl.h"
 #include "daisysp.h"
@@ -7,28 +17,55 @@
 using namespace daisy;
 using namespace daisysp;
 
-// Allocate Delay Line in SDRAM (64MB available on Seed)
-#define MAX_DELAY_SAMPLES (48000 * 2) // 2 Seconds max delay
-
 class ModeSpaceEcho {
 public:
-  void Init(float sample_rate) {
+  // Tape loops coded as int16 blocks: half the SDRAM traffic and memory of
+  // float at ~98 dB SNR, far below the tape noise and saturation modelled
+  // here (Float32Storage restores float, Packed24Storage is in between)
+  using TapeStorage = Int16BlockStorage;
+  using TapeLoop = BlockDelayBuffer<TapeStorage>;
+
+  // Control targets: mapped from the panel in the main loop, applied in the
+  // audio callback (see ControlSnapshot.h)
+  struct Controls {
+    float delay_time = 0.1f; // First head, seconds
+    int head_mask = kHeadsLong;
+    float head_level = 1.0f;
+    int tone = -1; // Switch position the coefficients were built for
+    SvfCoeffs tone_lp = {}, tone_hp = {};
+    float feedback = 0.0f;
+    float reverb_amount = 0.0f; // Encoder-driven
+  };
+
+  // The object itself is the hot per-sample state (internal RAM); the tape
+  // loops are taken from `arena` (SDRAM), sized for the longest head setting
+  // at this sample rate, and the spring reverb is the shared `reverb`.
+  // Returns false if the loops do not fit (ArenaBytes() is the exact
+  // requirement).
+  bool Init(float sample_rate, MemoryArena &arena, ReverbService &reverb) {
     fs_ = sample_rate;
 
     // Init Delay
-    del_l_.Init();
-    del_r_.Init();
-    del_l_.SetDelay((size_t)MAX_DELAY_SAMPLES);
-    del_r_.SetDelay((size_t)MAX_DELAY_SAMPLES);
-
-    // Init Reverb (Simple ReverbSc for Spring emulation)
-    verb_.Init(fs_);
-    verb_.SetFeedback(0.85f);
-    verb_.SetLpFreq(4000.0f); // Spring-ish dark tail
-
-    // Init Tone Filters
-    tone_lp_.Init(fs_);
-    tone_hp_.Init(fs_);
+    size_t length = DelayLength(fs_);
+    size_t blocks = TapeLoop::BufferBlocks(length);
+    TapeLoop::Block *buf_l = arena.Allocate<TapeLoop::Block>(blocks);
+    TapeLoop::Block *buf_r = arena.Allocate<TapeLoop::Block>(blocks);
+    if (!buf_l || !buf_r)
+      return false;
+    del_l_.Init(buf_l, length, false); // Arena memory is zero
+    del_r_.Init(buf_r, length, false);
+
+    // Shared Reverb (ReverbSc; kVerbEngine can pick the plate instead)
+    reverb_ = &reverb;
+    reverb_->Acquire(kVerbEngine, kVerbFeedback, kVerbLpFreq);
+
+    // Init Tone Filters (separate state per channel, shared coefficients)
+    tone_lp_l_.Init();
+    tone_lp_r_.Init();
+    tone_hp_l_.Init();
+    tone_hp_r_.Init();
+    ToneCoeffs(fs_, 1, tone_lp_coeffs_, tone_hp_coeffs_);
+    tone_ = -1; // The first ApplyControls sets the mapped tone
 
     // Init Flutter LFO (Tape wobble)
     lfo_flutter_.Init(fs_);
@@ -42,150 +79,264 @@ public:
     lfo_drift_.SetFreq(kDriftFreq);
     lfo_drift_.SetAmp(1.0f); // Will be scaled
 
+    // Init Tape Saturation Oversampling
+    sat_os_l_.Init(kTapeSatOversample);
+    sat_os_r_.Init(kTapeSatOversample);
+
     // Init Feedback Compressor (Envelope Follower)
     fb_env_l_ = 0.0f;
     fb_env_r_ = 0.0f;
 
     delay_time_ = 0.1f * fs_;
+    max_time_ = (size_t)(kDelayLongMax * fs_);
+    head_mask_ = kHeadsLong;
+    head_level_ = 1.0f;
+    for (int h = 0; h < kHeads; h++)
+      head_gain_[h] = (kHeadsLong >> h) & 1 ? 1.0f : 0.0f;
     reverb_amount_ = 0.0f;
 
     // Init noise state for organic flutter
     noise_state_ = 12345;
+    quality_ = 0;
+    return true;
   }
 
-  void Process(float in_l, float in_r, float *out_l, float *out_r) {
-    // 1. Delay Logic with Analog Drift
-    // Read from Delay Line (Interpolated)
-    // Stereo Width: Offset Right channel read head by ~15ms
-    float width_offset = kStereoWidthOffset * fs_;
-
-    // Add Flutter (Tape Wobble) with organic noise modulation
-    float flutter = lfo_flutter_.Process();
-
-    // Add subtle noise to flutter for more organic tape feel
-    float noise = GenerateNoise() * kFlutterNoiseAmount;
-    flutter += noise;
-
-    // Add Drift (Slow analog drift for pitch/tone variation)
-    float drift = lfo_drift_.Process();
-    float drift_amount =
-        drift * kDriftAmount; // +/- 3 samples for subtle pitch drift
-
-    float read_time_l = delay_time_ + flutter + drift_amount;
-    float read_time_r = delay_time_ + width_offset + flutter + drift_amount;
-
-    // Use Hermite Interpolation for cleaner pitch shifting
-    float read_l = del_l_.ReadHermite(read_time_l);
-    float read_r = del_r_.ReadHermite(read_time_r);
-
-    // 2. Feedback Processing
-    float fb_l = read_l;
-    float fb_r = read_r;
-
-    // Tone Shaping on Feedback (with drift modulation)
-    tone_lp_.Process(fb_l);
-    fb_l = tone_lp_.Low();
-    tone_hp_.Process(fb_l);
-    fb_l = tone_hp_.High();
-
-    // Same for right channel
-    tone_lp_.Process(fb_r);
-    fb_r = tone_lp_.Low();
-    tone_hp_.Process(fb_r);
-    fb_r = tone_hp_.High();
-
-    // Feedback Compressor (Envelope Follower + Soft Knee)
-    // Track envelope
-    fb_env_l_ = kCompAttack * fb_env_l_ + kCompRelease * fabsf(fb_l);
-    fb_env_r_ = kCompAttack * fb_env_r_ + kCompRelease * fabsf(fb_r);
-
-    // Soft compression (ratio ~3:1 above threshold)
-    float comp_gain_l = 1.0f;
-    float comp_gain_r = 1.0f;
-
-    if (fb_env_l_ > kCompThreshold) {
-      float over = fb_env_l_ - kCompThreshold;
-      comp_gain_l = kCompThreshold / (kCompThreshold + over * kCompRatio);
-    }
-    if (fb_env_r_ > kCompThreshold) {
-      float over = fb_env_r_ - kCompThreshold;
-      comp_gain_r = kCompThreshold / (kCompThreshold + over * kCompRatio);
-    }
-
-    fb_l *= comp_gain_l;
-    fb_r *= comp_gain_r;
-
-    // Enhanced Tape Saturation (Asymmetric + High-freq roll-off)
-    // Boost into saturation for more character
-    fb_l = AsymmetricTapeSat(fb_l * kTapeSatGain);
-    fb_r = AsymmetricTapeSat(fb_r * kTapeSatGain);
-
-    // Soft Limiter before write (prevent runaway feedback)
-    fb_l = tanhf(fb_l * kFeedbackLimitGain) * kFeedbackLimitScale;
-    fb_r = tanhf(fb_r * kFeedbackLimitGain) * kFeedbackLimitScale;
+  // Quality levels (QualityGovernor.h): 1 runs the tape saturation without
+  // oversampling, 2 also plays at most the first two heads (gliding out
+  // like a head switch), 3 also moves the reverb to the plate engine
+  static constexpr int kQualityLevels = 4;
+
+  // Audio callback, before ApplyControls
+  void SetQuality(int level) {
+    if (level == quality_)
+      return;
+    quality_ = level;
+    int factor = quality_ >= 1 ? 1 : kTapeSatOversample;
+    sat_os_l_.SetFactor(factor);
+    sat_os_r_.SetFactor(factor);
+    reverb_->Select(quality_ >= kQualityPlate ? ReverbEngine::kPlate
+                                              : kVerbEngine);
+  }
 
-    // Write back to delay (Input + Feedback)
-    float write_val_l = in_l + (fb_l * feedback_amount_);
-    float write_val_r = in_r + (fb_r * feedback_amount_);
+  int Quality() const { return quality_; }
 
-    del_l_.Write(write_val_l);
-    del_r_.Write(write_val_r);
+  // Tape loop length: the longest head plus the stereo offset, modulation
+  // and the Hermite points
+  static constexpr size_t DelayLength(float sample_rate) {
+    return (size_t)((kDelayLongMax + kStereoWidthOffset) * sample_rate) +
+           kDelayHeadroom;
+  }
 
-    // 3. Reverb Logic
-    float verb_in_l = read_l; // Reverb comes after delay heads
-    float verb_in_r = read_r;
-    float verb_out_l, verb_out_r;
+  // SDRAM taken by Init at this sample rate
+  static constexpr size_t ArenaBytes(float sample_rate) {
+    return 2 * MemoryArena::Footprint<TapeLoop::Block>(
+                   TapeLoop::BufferBlocks(DelayLength(sample_rate)));
+  }
 
-    verb_.Process(verb_in_l, verb_in_r, &verb_out_l, &verb_out_r);
+  // Sum of the heads over a chunk into `out`: per head, one block read from
+  // the oldest to the newest point the chunk's taps touch, then the shared
+  // weights over the decoded span (public for `legio_host -B echo`)
+  static void ReadHeads(const TapeLoop &loop,
+                        const DelayBuffer::HermiteTap *tap, size_t n,
+                        const size_t *extra, const float *gain, int heads,
+                        float *out) {
+    size_t oldest = tap[0].delay, newest = tap[0].delay;
+    for (size_t i = 1; i < n; i++) {
+      oldest = tap[i].delay > oldest ? tap[i].delay : oldest;
+      newest = tap[i].delay < newest ? tap[i].delay : newest;
+    }
+    oldest += 2; // Hermite points delay + 2 .. delay - 1
+    size_t span_length = oldest - newest + 2;
+    memset(out, 0, n * sizeof(float));
+    float span[kReadSpan];
+    for (int h = 0; h < heads; h++) {
+      loop.ReadBlock(span, span_length, oldest + extra[h]);
+      for (size_t i = 0; i < n; i++)
+        out[i] += gain[h] * DelayBuffer::Interpolate(
+                                tap[i], span + (oldest - tap[i].delay - 2));
+    }
+  }
 
-    // 4. Mix
-    // Dry + Wet Delay + Wet Reverb
-    *out_l = in_l + (read_l * kDelayWetMix) + (verb_out_l * reverb_amount_);
-    *out_r = in_r + (read_r * kDelayWetMix) + (verb_out_r * reverb_amount_);
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    // Stereo Width: Offset Right channel read head by ~15ms
+    const float width_offset = kStereoWidthOffset * fs_;
+
+    // The feedback chain runs as one stage per pass over a chunk: read taps,
+    // tone filters, compressor, saturation, write-back. Valid because the
+    // shortest read time (kDelayShortMin minus flutter and drift) is far
+    // longer than a chunk, so no read inside a chunk can reach a sample
+    // written in it.
+    for (size_t offset = 0; offset < size; offset += kFeedbackChunk) {
+      size_t n = size - offset;
+      if (n > kFeedbackChunk)
+        n = kFeedbackChunk;
+      float read_l[kFeedbackChunk], read_r[kFeedbackChunk];
+      float fb_l[kFeedbackChunk], fb_r[kFeedbackChunk];
+
+      // 1. Read Taps with Analog Drift. The tape modulation and the Hermite
+      // weights are computed once per sample and channel. The heads sit at
+      // whole multiples of the head spacing behind the first, so they all
+      // share the weights: each head is one block read of the span its
+      // chunk covers, then a dot product per sample.
+      {
+        LEGIO_PROFILE_SCOPE("echo/read");
+        DelayBuffer::HermiteTap tap_l[kFeedbackChunk], tap_r[kFeedbackChunk];
+        for (size_t i = 0; i < n; i++) {
+          // Add Flutter (Tape Wobble) with organic noise modulation
+          float flutter = lfo_flutter_.Process();
+
+          // Add subtle noise to flutter for more organic tape feel
+          float noise = GenerateNoise() * kFlutterNoiseAmount;
+          flutter += noise;
+
+          // Add Drift (Slow analog drift for pitch/tone variation)
+          float drift = lfo_drift_.Process();
+          float drift_amount =
+              drift * kDriftAmount; // +/- 3 samples for subtle pitch drift
+
+          // The write pointer has not advanced past this chunk yet, hence the
+          // `- i` on both channels
+          float read_time = delay_time_ + flutter + drift_amount - (float)i;
+
+          // Hermite Interpolation for cleaner pitch shifting; the tape
+          // modulation moves every head together
+          tap_l[i] = DelayBuffer::HermiteSetup(read_time);
+          tap_r[i] = DelayBuffer::HermiteSetup(read_time + width_offset);
+        }
+        size_t extra[kHeads];
+        float gain[kHeads];
+        int heads = SetupHeads(extra, gain);
+        ReadHeads(del_l_, tap_l, n, extra, gain, heads, read_l);
+        ReadHeads(del_r_, tap_r, n, extra, gain, heads, read_r);
+      }
+
+      // 2. Tone Shaping on Feedback (LP then HP, per channel)
+      {
+        LEGIO_PROFILE_SCOPE("echo/tone");
+        for (size_t i = 0; i < n; i++) {
+          tone_lp_l_.Process(read_l[i], tone_lp_coeffs_);
+          tone_hp_l_.Process(tone_lp_l_.Low(), tone_hp_coeffs_);
+          fb_l[i] = tone_hp_l_.High();
+        }
+        for (size_t i = 0; i < n; i++) {
+          tone_lp_r_.Process(read_r[i], tone_lp_coeffs_);
+          tone_hp_r_.Process(tone_lp_r_.Low(), tone_hp_coeffs_);
+          fb_r[i] = tone_hp_r_.High();
+        }
+      }
+
+      // 3. Feedback Compressor (Envelope Follower + Soft Knee), boosted into
+      // the saturation stage for more character
+      {
+        LEGIO_PROFILE_SCOPE("echo/comp+sat");
+        fb_env_l_ = CompressBlock(fb_l, n, fb_env_l_);
+        fb_env_r_ = CompressBlock(fb_r, n, fb_env_r_);
+
+        // 4. Enhanced Tape Saturation (Asymmetric) and Soft Limiter before
+        // write (prevent runaway feedback), oversampled together as one shaper
+        auto saturate = [this](float x) {
+          return fastmath::Tanh<kMathTier>(AsymmetricTapeSat(x) *
+                                           kFeedbackLimitGain) *
+                 kFeedbackLimitScale;
+        };
+        sat_os_l_.Process(fb_l, fb_l, n, saturate);
+        sat_os_r_.Process(fb_r, fb_r, n, saturate);
+      }
+
+      // 5. Write back to delay (Input + Feedback), one burst per channel
+      const float *dry_l = in_l + offset;
+      const float *dry_r = in_r + offset;
+      {
+        LEGIO_PROFILE_SCOPE("echo/write");
+        for (size_t i = 0; i < n; i++) {
+          fb_l[i] = dry_l[i] + (fb_l[i] * feedback_amount_);
+          fb_r[i] = dry_r[i] + (fb_r[i] * feedback_amount_);
+        }
+        del_l_.WriteBlock(fb_l, n);
+        del_r_.WriteBlock(fb_r, n);
+      }
+
+      // 6. Reverb (after the delay heads) and Mix
+      // Dry + Wet Delay + Wet Reverb
+      float verb_l[kFeedbackChunk], verb_r[kFeedbackChunk];
+      {
+        LEGIO_PROFILE_SCOPE("echo/reverb");
+        reverb_->ProcessBlock(read_l, read_r, verb_l, verb_r, n);
+      }
+      {
+        LEGIO_PROFILE_SCOPE("echo/mix");
+        for (size_t i = 0; i < n; i++) {
+          out_l[offset + i] = dry_l[i] + (read_l[i] * kDelayWetMix) +
+                              (verb_l[i] * reverb_amount_);
+          out_r[offset + i] = dry_r[i] + (read_r[i] * kDelayWetMix) +
+                              (verb_r[i] * reverb_amount_);
+        }
+      }
+    }
   }
 
-  void UpdateControls(DaisyLegio &hw) {
+  // Main loop: targets for `frame`
+  void MapControls(const ControlFrame &frame, Controls &c) const {
     // Knobs
-    float k_time = hw.controls[DaisyLegio::CONTROL_KNOB_TOP].Value();
-    float k_feedback = hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].Value();
+    float k_time = frame.knob_top;
+    float k_feedback = frame.knob_bottom;
 
     // Encoder Turn (Reverb Amount)
-    float inc = hw.encoder.Increment();
-    reverb_amount_ += inc * kReverbEncoderSensitivity;
-    reverb_amount_ = fclamp(reverb_amount_, 0.0f, 1.0f);
+    float inc = frame.encoder;
+    c.reverb_amount += inc * kReverbEncoderSensitivity;
+    c.reverb_amount = fclamp(c.reverb_amount, 0.0f, 1.0f);
 
     // Switches
-    int sw_head = hw.sw[DaisyLegio::SW_LEFT].Read();
-    int sw_tone = hw.sw[DaisyLegio::SW_RIGHT].Read();
+    int sw_head = frame.sw_left;
+    int sw_tone = frame.sw_right;
 
-    // Map Head Mode (Top=Short, Mid=Med, Bot=Long)
-    float delay_time_target = 0.1f;
+    // Map Head Mode (Top=Short, Mid=Med, Bot=Long): the range of the first
+    // head's time and the heads that play
     // FIX: Inverted Switch Logic (2=Top, 1=Mid, 0=Bot)
     if (sw_head == 2)
-      delay_time_target = kDelayShortMin + (k_time * kDelayShortRange);
+      c.delay_time = kDelayShortMin + (k_time * kDelayShortRange);
     else if (sw_head == 1)
-      delay_time_target = kDelayMedMin + (k_time * kDelayMedRange);
+      c.delay_time = kDelayMedMin + (k_time * kDelayMedRange);
     else
-      delay_time_target = kDelayLongMin + (k_time * kDelayLongRange);
+      c.delay_time = control_curves::kEchoLongTimeTable.Cubic(k_time);
+
+    int mask = sw_head == 2   ? kHeadsShort
+               : sw_head == 1 ? kHeadsMed
+                              : kHeadsLong;
+    if (mask != c.head_mask) {
+      c.head_mask = mask;
+      int count = 0;
+      for (int h = 0; h < kHeads; h++)
+        count += (mask >> h) & 1;
+      c.head_level = 1.0f / sqrtf((float)count); // Same loudness on noise
+    }
+
+    // Map Tone (Top=Bright, Mid=Normal, Bot=Dark), rebuilt only on change
+    if (sw_tone != c.tone) {
+      c.tone = sw_tone;
+      ToneCoeffs(fs_, sw_tone, c.tone_lp, c.tone_hp);
+    }
+
+    c.feedback = k_feedback * kFeedbackMax; // Allow self-oscillation (>1.0)
+  }
+
+  // Audio callback, once per buffer
+  void ApplyControls(const Controls &c) {
+    reverb_amount_ = c.reverb_amount;
+    reverb_->SetReturnLevel(reverb_amount_);
+    head_mask_ = quality_ >= 2 ? c.head_mask & kQualityHeads : c.head_mask;
+    head_level_ = head_mask_ == c.head_mask ? c.head_level : kQualityHeadLevel;
 
     // Smooth delay time changes to simulate tape speed change (pitch warp)
-    fonepole(delay_time_, delay_time_target * fs_, kDelayTimeSmooth);
+    fonepole(delay_time_, c.delay_time * fs_, kDelayTimeSmooth);
 
-    // Map Tone (Top=Bright, Mid=Normal, Bot=Dark)
-    // FIX: Inverted Switch Logic (2=Top, 1=Mid, 0=Bot)
-    if (sw_tone == 2) { // Bright
-      tone_lp_.SetFreq(kToneBrightLP);
-      tone_hp_.SetFreq(kToneBrightHP);
-    } else if (sw_tone == 1) { // Normal
-      tone_lp_.SetFreq(kToneNormalLP);
-      tone_hp_.SetFreq(kToneNormalHP);
-    } else { // Dark
-      tone_lp_.SetFreq(kToneDarkLP);
-      tone_hp_.SetFreq(kToneDarkHP);
+    if (c.tone != tone_) {
+      tone_ = c.tone;
+      tone_lp_coeffs_ = c.tone_lp;
+      tone_hp_coeffs_ = c.tone_hp;
     }
-
-    feedback_amount_ =
-        k_feedback * kFeedbackMax; // Allow self-oscillation (>1.0)
+    feedback_amount_ = c.feedback;
   }
 
 private:
@@ -204,6 +355,15 @@ private:
   static constexpr float kFeedbackLimitGain = 1.2f;
   static constexpr float kFeedbackLimitScale = 0.85f;
   static constexpr float kDelayWetMix = 0.8f;
+  static constexpr int kTapeSatOversample = 2; // Gentle curve, 2x is enough
+  static constexpr size_t kFeedbackChunk = 64;
+  // ReverbSc for the richer tail; the plate is cheaper (-B reverb), the
+  // last quality level
+  static constexpr ReverbEngine kVerbEngine = ReverbEngine::kSc;
+  static constexpr int kQualityPlate = 3;
+  static constexpr float kVerbFeedback = 0.85f;
+  static constexpr float kVerbLpFreq = 4000.0f; // Spring-ish dark tail
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
 
   // Control Constants
   static constexpr float kReverbEncoderSensitivity = 0.05f;
@@ -211,11 +371,36 @@ private:
   static constexpr float kDelayShortRange = 0.2f;
   static constexpr float kDelayMedMin = 0.3f;
   static constexpr float kDelayMedRange = 0.4f;
-  static constexpr float kDelayLongMin = 0.5f;
-  static constexpr float kDelayLongRange = 1.0f;
+  static constexpr float kDelayLongMax =
+      (float)control_curves::EchoLongTime::kHi; // Exponential from 0.5 s
+  static constexpr size_t kDelayHeadroom = 128; // Flutter + drift + guard
   static constexpr float kDelayTimeSmooth = 0.05f;
   static constexpr float kFeedbackMax = 1.1f;
 
+  // Playback heads at whole multiples (1:2:3:4) of the first head's time,
+  // the RE-201's evenly spaced heads plus one; bit h of a combination is
+  // head h + 1, summed into both the output and the feedback as on the tape
+  static constexpr int kHeads = 4;
+  static constexpr int kHeadsShort = 0x7; // Heads 1+2+3
+  static constexpr int kHeadsMed = 0xf;   // All four
+  static constexpr int kHeadsLong = 0x1;  // The first alone
+  static constexpr int kQualityHeads = 0x3; // At most heads 1+2 (quality 2)
+  static constexpr float kQualityHeadLevel = 0.70710678f; // Two heads
+  static constexpr float kHeadFade = 0.1f;      // Per chunk, ~13 ms
+  static constexpr float kHeadSnap = 1.0e-4f;   // Gain glide done below this
+  // Every head of the Med range fits in the tape loop sized for Long
+  static_assert(kHeads * (kDelayMedMin + kDelayMedRange) <= kDelayLongMax,
+                "multi-head combinations must fit the tape loop");
+  // Span one head reads per chunk: the chunk, the modulation swing and the
+  // Hermite points
+  static constexpr size_t kReadSpan = 128;
+  static_assert(kFeedbackChunk +
+                        2 * (kFlutterAmount + kFlutterNoiseAmount +
+                             kDriftAmount) +
+                        4 <=
+                    kReadSpan,
+                "a head's span must fit the read buffer");
+
   // Tone Constants
   static constexpr float kToneBrightLP = 12000.0f;
   static constexpr float kToneBrightHP = 200.0f;
@@ -223,19 +408,31 @@ private:
   static constexpr float kToneNormalHP = 100.0f;
   static constexpr float kToneDarkLP = 1200.0f;
   static constexpr float kToneDarkHP = 400.0f;
-
-  ReverbSc verb_;
-  DelayLine<float, MAX_DELAY_SAMPLES> del_l_;
-  DelayLine<float, MAX_DELAY_SAMPLES> del_r_;
-  Svf tone_lp_, tone_hp_;
+  // daisysp::Svf state after Init + SetFreq (SetRes/SetDrive never called):
+  // resonance 0.5 and a raw band-pass drive coefficient of 0.5
+  static constexpr float kToneRes = 0.5f;
+  static constexpr float kToneDrive = 0.5f;
+
+  ReverbService *reverb_;     // Shared
+  TapeLoop del_l_, del_r_;    // Storage in the arena
+  SvfCore tone_lp_l_, tone_lp_r_;
+  SvfCore tone_hp_l_, tone_hp_r_;
+  SvfCoeffs tone_lp_coeffs_, tone_hp_coeffs_;
+  int tone_; // Switch position the coefficients are for
+  Oversampler sat_os_l_, sat_os_r_; // Tape saturation oversampling
   Oscillator lfo_flutter_;
   Oscillator lfo_drift_; // Analog drift LFO
   float fs_;
   float feedback_amount_;
   float reverb_amount_;
-  float delay_time_;
+  float delay_time_;             // First head, samples
+  size_t max_time_;              // Longest head time the loop holds
+  int head_mask_;                // Heads in the current combination
+  float head_level_;             // Gain of each of them
+  float head_gain_[kHeads];      // Gliding towards 0 or head_level_
   float fb_env_l_, fb_env_r_; // Feedback compressor envelope
   uint32_t noise_state_;      // For noise generation
+  int quality_;
 
   // Simple noise generator for organic flutter
   float GenerateNoise() {
@@ -243,14 +440,77 @@ private:
     return ((float)(noise_state_ >> 16) / 32768.0f) - 1.0f;
   }
 
+  // Once per chunk: glide the head gains (a new combination fades heads in
+  // and out instead of clicking) and list the audible heads with their
+  // distance behind the first. Returns how many.
+  int SetupHeads(size_t *extra, float *gain) {
+    size_t spacing = (size_t)(delay_time_ + 0.5f);
+    // The first head may still be gliding down from a long time after a
+    // switch to more heads: those past the loop stay silent until it is in
+    size_t first = (size_t)delay_time_;
+    size_t room = first < max_time_ ? max_time_ - first : 0;
+    int heads = 0;
+    for (int h = 0; h < kHeads; h++) {
+      float target = (head_mask_ >> h) & 1 ? head_level_ : 0.0f;
+      fonepole(head_gain_[h], target, kHeadFade);
+      if (fabsf(head_gain_[h] - target) < kHeadSnap)
+        head_gain_[h] = target;
+      size_t distance = (size_t)h * spacing;
+      if (head_gain_[h] == 0.0f || distance > room)
+        continue;
+      extra[heads] = distance;
+      gain[heads] = head_gain_[h];
+      heads++;
+    }
+    return heads;
+  }
+
+  // Tone filter coefficients for a switch position
+  // FIX: Inverted Switch Logic (2=Top, 1=Mid, 0=Bot)
+  static void ToneCoeffs(float fs, int sw_tone, SvfCoeffs &lp_coeffs,
+                         SvfCoeffs &hp_coeffs) {
+    float lp, hp;
+    if (sw_tone == 2) { // Bright
+      lp = kToneBrightLP;
+      hp = kToneBrightHP;
+    } else if (sw_tone == 1) { // Normal
+      lp = kToneNormalLP;
+      hp = kToneNormalHP;
+    } else { // Dark
+      lp = kToneDarkLP;
+      hp = kToneDarkHP;
+    }
+    lp_coeffs = SvfCoeffs::Compute(fs, lp, kToneRes, 0.0f);
+    hp_coeffs = SvfCoeffs::Compute(fs, hp, kToneRes, 0.0f);
+    lp_coeffs.drive = kToneDrive;
+    hp_coeffs.drive = kToneDrive;
+  }
+
+  // Feedback compressor over a block in place: envelope follower with a soft
+  // knee (ratio ~3:1 above threshold), then the tape saturation input gain.
+  // Returns the updated envelope.
+  static float CompressBlock(float *x, size_t n, float env) {
+    for (size_t i = 0; i < n; i++) {
+      // Track envelope
+      env = kCompAttack * env + kCompRelease * fabsf(x[i]);
+      float comp_gain = 1.0f;
+      if (env > kCompThreshold) {
+        float over = env - kCompThreshold;
+        comp_gain = kCompThreshold / (kCompThreshold + over * kCompRatio);
+      }
+      x[i] *= comp_gain * kTapeSatGain;
+    }
+    return env;
+  }
+
   // Asymmetric tape saturation (different curves for +/-)
   float AsymmetricTapeSat(float x) {
     if (x > 0.0f) {
       // Positive: softer saturation
-      return tanhf(x * 0.9f);
+      return fastmath::Tanh<kMathTier>(x * 0.9f);
     } else {
       // Negative: harder saturation (asymmetric like tape)
-      return tanhf(x * 1.2f) * 0.95f;
+      return fastmath::Tanh<kMathTier>(x * 1.2f) * 0.95f;
     }
   }
 };
@@ -0,0 +1,197 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+
+// Polyphase halfband resampling for nonlinear stages.
+//
+// A halfband lowpass with 4K-1 taps has every other coefficient equal to zero
+// except the centre one (0.5), so each polyphase branch is either a plain
+// delay or a symmetric K-tap filter: K multiplies per output pair when
+// upsampling and K + 1 per output sample when decimating.
+//
+// Coefficients are Kaiser-windowed sinc, normalised to unity DC gain.
+// Steep (39 taps, beta 8): passband to 0.15 fs ripple < 1e-4, stopband from
+//   0.35 fs below -83 dB. Used next to the base rate, where the transition
+//   band has to fit between 14.4 kHz and the base Nyquist image.
+static const float kHalfbandSteep[10] = {
+    3.1501461297e-01f, -9.6598751894e-02f, 4.8919618723e-02f,
+    -2.6901972541e-02f, 1.4546196408e-02f, -7.3467971294e-03f,
+    3.3106290633e-03f, -1.2478870895e-03f, 3.4353282625e-04f,
+    -3.9181334015e-05f};
+
+// Relaxed (15 taps, beta 7): passband to 0.075 fs ripple < 2e-4, stopband
+//   from 0.425 fs below -74 dB. Enough for the 4x and 8x stages, which only
+//   have to protect the already band-limited audio band.
+static const float kHalfbandRelaxed[4] = {2.9780233927e-01f, -5.6930436460e-02f,
+                                          9.3977683829e-03f,
+                                          -2.6967119215e-04f};
+
+// One halfband stage with K unique nonzero side taps. An instance is used in
+// one direction only (Upsample or Downsample) since it owns the history.
+template <int K> class HalfbandFilter {
+public:
+  // Largest `size` accepted per call (base-side samples)
+  static constexpr size_t kMaxSize = 64;
+
+  void Init(const float *taps) {
+    taps_ = taps;
+    Reset();
+  }
+
+  void Reset() { memset(buf_, 0, sizeof(buf_)); }
+
+  // 2 * size output samples from `size` input samples
+  void Upsample(const float *in, float *out, size_t size) {
+    // Only 2K-1 input samples of history are needed on the way up
+    const size_t hist = 2 * K - 1;
+    float *x = buf_ + kDownHistory - hist;
+    memcpy(x + hist, in, size * sizeof(float));
+
+    for (size_t n = 0; n < size; n++) {
+      // x[n] lives at x[hist + n]; taps pair up around the centre
+      const float *c = x + hist + n - K + 1;
+      float acc = 0.0f;
+      for (int j = 0; j < K; j++)
+        acc += taps_[j] * (c[j] + c[-1 - j]);
+      out[2 * n] = 2.0f * acc;  // Filter branch (gain 2 restores level)
+      out[2 * n + 1] = c[0];    // Centre tap branch: pure delay
+    }
+
+    memmove(x, x + size, hist * sizeof(float));
+  }
+
+  // `size` output samples from 2 * size input samples
+  void Downsample(const float *in, float *out, size_t size) {
+    float *v = buf_;
+    memcpy(v + kDownHistory, in, 2 * size * sizeof(float));
+
+    for (size_t n = 0; n < size; n++) {
+      // v[2n] lives at v[kDownHistory + 2n]; centre at 2n - (2K - 1)
+      const float *c = v + kDownHistory + 2 * n - 2 * K + 1;
+      float acc = 0.5f * c[0];
+      for (int j = 0; j < K; j++)
+        acc += taps_[j] * (c[2 * j + 1] + c[-2 * j - 1]);
+      out[n] = acc;
+    }
+
+    memmove(v, v + 2 * size, kDownHistory * sizeof(float));
+  }
+
+  // Group delay in samples of the higher of the two rates
+  static constexpr float Latency() { return (float)(2 * K - 1); }
+
+private:
+  static constexpr size_t kDownHistory = 4 * K - 2;
+
+  const float *taps_;
+  float buf_[kDownHistory + 2 * kMaxSize];
+};
+
+// 1x/2x/4x/8x oversampling around a memoryless shaper. The first stage uses
+// the steep halfband, the following ones the relaxed one. Audio is processed
+// in chunks of kChunk base-rate samples, so any block size is accepted.
+class Oversampler {
+public:
+  static constexpr int kMaxFactor = 8;
+  static constexpr size_t kChunk = 16;
+  static_assert(kChunk * kMaxFactor / 2 <= HalfbandFilter<1>::kMaxSize,
+                "chunk does not fit the halfband stage buffers");
+
+  void Init(int factor) {
+    up_steep_.Init(kHalfbandSteep);
+    down_steep_.Init(kHalfbandSteep);
+    for (int s = 0; s < 2; s++) {
+      up_relaxed_[s].Init(kHalfbandRelaxed);
+      down_relaxed_[s].Init(kHalfbandRelaxed);
+    }
+    factor_ = 0;
+    SetFactor(factor);
+  }
+
+  // 1, 2, 4 or 8 (anything else rounds down). Filter state is cleared when
+  // the factor changes.
+  void SetFactor(int factor) {
+    int f = factor >= 8 ? 8 : factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    if (f == factor_)
+      return;
+    factor_ = f;
+    Reset();
+  }
+
+  int Factor() const { return factor_; }
+
+  void Reset() {
+    up_steep_.Reset();
+    down_steep_.Reset();
+    for (int s = 0; s < 2; s++) {
+      up_relaxed_[s].Reset();
+      down_relaxed_[s].Reset();
+    }
+  }
+
+  // Delay added by the up/down round trip, in base-rate samples
+  float Latency() const {
+    float latency = 0.0f;
+    float rate = 2.0f; // Output rate of the current up stage
+    for (int f = 2; f <= factor_; f *= 2) {
+      latency += 2.0f *
+                 (f == 2 ? HalfbandFilter<10>::Latency()
+                         : HalfbandFilter<4>::Latency()) /
+                 rate;
+      rate *= 2.0f;
+    }
+    return latency;
+  }
+
+  // out[i] = shaper(in[i]) evaluated at factor x the sample rate. `in` and
+  // `out` may be the same buffer.
+  template <typename Shaper>
+  void Process(const float *in, float *out, size_t size, Shaper shaper) {
+    if (factor_ == 1) {
+      for (size_t i = 0; i < size; i++)
+        out[i] = shaper(in[i]);
+      return;
+    }
+
+    for (size_t offset = 0; offset < size; offset += kChunk) {
+      size_t n = size - offset;
+      if (n > kChunk)
+        n = kChunk;
+
+      // Up: steep stage, then relaxed ones, ping-ponging between work_a_/b_
+      float *cur = work_a_;
+      float *other = work_b_;
+      up_steep_.Upsample(in + offset, cur, n);
+      size_t len = 2 * n;
+      for (int s = 0; s < StageCount() - 1; s++) {
+        up_relaxed_[s].Upsample(cur, other, len);
+        len *= 2;
+        float *t = cur;
+        cur = other;
+        other = t;
+      }
+
+      for (size_t i = 0; i < len; i++)
+        cur[i] = shaper(cur[i]);
+
+      // Down: mirror of the way up
+      for (int s = StageCount() - 2; s >= 0; s--) {
+        len /= 2;
+        down_relaxed_[s].Downsample(cur, other, len);
+        float *t = cur;
+        cur = other;
+        other = t;
+      }
+      down_steep_.Downsample(cur, out + offset, n);
+    }
+  }
+
+private:
+  int factor_;
+  HalfbandFilter<10> up_steep_, down_steep_;
+  HalfbandFilter<4> up_relaxed_[2], down_relaxed_[2];
+  float work_a_[kChunk * kMaxFactor];
+  float work_b_[kChunk * kMaxFactor];
+
+  int StageCount() const { return factor_ == 8 ? 3 : factor_ == 4 ? 2 : 1; }
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include "RealFft.h"
+#include <stddef.h>
+#include <string.h>
+
+// Uniformly partitioned overlap-save convolution, mono in, stereo out.
+//
+// The IR pair is cut into partitions of kBlock samples, each zero-padded to
+// kFftSize and transformed once (PrepareIr). Every kBlock input samples the
+// last kFftSize inputs are transformed into the next slot of a frequency
+// domain delay line (FDL) of one spectrum per partition; the output spectrum
+// is the sum over partitions p of FDL[now - p] times IR[p], and its inverse
+// keeps the last kBlock samples (overlap-save). Per block that is one
+// forward and two inverse FFTs plus a complex multiply-add per bin and
+// partition: the cost depends on the IR length only through the partition
+// count, and one FDL serves both channels.
+//
+// Only partition 0 needs the newest spectrum. The others, for the next
+// block, are summed while the current one is collected, a share of them in
+// every ProcessBlock call in proportion to the samples it takes, so the
+// audio callback sees an even load instead of the whole sum once per block.
+//
+// Latency is kBlock samples. The FDL and the IR spectra live in caller
+// memory (the SDRAM arena) and are streamed once per block: about
+// 3 * 8 bytes per bin and partition, which bounds the IR length on the
+// target more than the arithmetic does. `legio_host -B convolution` prints
+// cost per block against the partition count.
+template <int kLog2Partition> class PartitionedConvolver {
+public:
+  static constexpr int kLog2Block = kLog2Partition;
+  static constexpr size_t kBlock = (size_t)1 << kLog2Block;
+  static constexpr size_t kFftSize = 2 * kBlock;
+  static constexpr size_t kSpectrum = kFftSize + 2; // Floats per spectrum
+
+  static constexpr size_t Partitions(size_t ir_length) {
+    return (ir_length + kBlock - 1) / kBlock;
+  }
+
+  // Floats of FDL, and of spectra per IR channel, for `partitions`
+  static constexpr size_t SpectraFloats(size_t partitions) {
+    return partitions * kSpectrum;
+  }
+
+  // `fdl`: SpectraFloats(partitions) floats, zeroed
+  void Init(float *fdl, size_t partitions) {
+    fft_.Init();
+    fdl_ = fdl;
+    partitions_ = partitions;
+    ir_partitions_ = 0;
+    limit_ = partitions;
+    active_ = 0;
+    head_ = 0;
+    fill_ = 0;
+    ir_l_ = ir_r_ = nullptr;
+    summed_ = 0;
+    memset(in_, 0, sizeof(in_));
+    memset(out_l_, 0, sizeof(out_l_));
+    memset(out_r_, 0, sizeof(out_r_));
+    memset(next_l_, 0, sizeof(next_l_));
+    memset(next_r_, 0, sizeof(next_r_));
+  }
+
+  // Spectra of `length` IR samples into `spectra` (SpectraFloats of
+  // Partitions(length) floats), scaled for the inverse FFT. After Init.
+  void PrepareIr(const float *ir, size_t length, float *spectra) const {
+    PrepareIr(ir, length, spectra, 0, Partitions(length));
+  }
+
+  // The same for partitions [first, last) only, so the work can be spread
+  void PrepareIr(const float *ir, size_t length, float *spectra, size_t first,
+                 size_t last) const {
+    const float scale = 2.0f / (float)kFftSize;
+    for (size_t p = first; p < last; p++) {
+      float *s = spectra + p * kSpectrum;
+      size_t n = length - p * kBlock;
+      if (n > kBlock)
+        n = kBlock;
+      for (size_t i = 0; i < n; i++)
+        s[i] = ir[p * kBlock + i] * scale;
+      memset(s + n, 0, (kFftSize - n) * sizeof(float));
+      fft_.Forward(s);
+    }
+  }
+
+  // Switch to prepared spectra of `partitions` (<= the FDL's) partitions;
+  // the FDL keeps its history, so the new IR applies to past input at once
+  void SetIr(const float *spectra_l, const float *spectra_r,
+             size_t partitions) {
+    ir_l_ = spectra_l;
+    ir_r_ = spectra_r;
+    ir_partitions_ = partitions < partitions_ ? partitions : partitions_;
+    active_ = ir_partitions_ < limit_ ? ir_partitions_ : limit_;
+    // The partial sum was for the old IR: redo it
+    memset(next_l_, 0, sizeof(next_l_));
+    memset(next_r_, 0, sizeof(next_r_));
+    summed_ = 0;
+    SumTail(fill_);
+  }
+
+  void ProcessBlock(const float *in, float *out_l, float *out_r,
+                    size_t size) {
+    while (size > 0) {
+      size_t n = kBlock - fill_;
+      if (n > size)
+        n = size;
+      memcpy(in_ + kBlock + fill_, in, n * sizeof(float));
+      memcpy(out_l, out_l_ + fill_, n * sizeof(float));
+      memcpy(out_r, out_r_ + fill_, n * sizeof(float));
+      fill_ += n;
+      SumTail(fill_);
+      in += n;
+      out_l += n;
+      out_r += n;
+      size -= n;
+      if (fill_ == kBlock) {
+        RunBlock();
+        fill_ = 0;
+      }
+    }
+  }
+
+  // Convolve with the first `limit` (>= 1) partitions of the IR only, from
+  // the next block on: a shorter tail for less work per block, without
+  // redoing the partial sum of the current one
+  void SetPartitionLimit(size_t limit) { limit_ = limit > 0 ? limit : 1; }
+
+  size_t Partitions() const { return active_; }
+
+private:
+  RealFft<kLog2Block + 1> fft_;
+  float in_[kFftSize]; // Previous block, then the one being collected
+  float out_l_[kBlock], out_r_[kBlock];
+  float acc_l_[kSpectrum], acc_r_[kSpectrum];   // This block
+  float next_l_[kSpectrum], next_r_[kSpectrum]; // Partitions 1.. of the next
+  float *fdl_;
+  const float *ir_l_, *ir_r_;
+  size_t partitions_;    // FDL slots
+  size_t ir_partitions_; // Of the current IR
+  size_t limit_;         // SetPartitionLimit
+  size_t active_;        // IR partitions in use
+  size_t head_;          // FDL slot of the newest spectrum
+  size_t fill_;
+  size_t summed_; // Partitions of next_ done, from 1
+
+  void RunBlock() {
+    head_ = head_ + 1 < partitions_ ? head_ + 1 : 0;
+    float *x = fdl_ + head_ * kSpectrum;
+    memcpy(x, in_, kFftSize * sizeof(float));
+    fft_.Forward(x);
+    memcpy(in_, in_ + kBlock, kBlock * sizeof(float));
+
+    // Newest spectrum times partition 0, plus the sum of the rest
+    memcpy(acc_l_, next_l_, sizeof(acc_l_));
+    memcpy(acc_r_, next_r_, sizeof(acc_r_));
+    if (active_ > 0)
+      MultiplyAdd(x, ir_l_, ir_r_, acc_l_, acc_r_);
+    memset(next_l_, 0, sizeof(next_l_));
+    memset(next_r_, 0, sizeof(next_r_));
+    summed_ = 0;
+    active_ = ir_partitions_ < limit_ ? ir_partitions_ : limit_;
+
+    fft_.Inverse(acc_l_);
+    fft_.Inverse(acc_r_);
+    memcpy(out_l_, acc_l_ + kBlock, kBlock * sizeof(float));
+    memcpy(out_r_, acc_r_ + kBlock, kBlock * sizeof(float));
+  }
+
+  // Partitions 1 .. active_ - 1 of the next block, the share due once
+  // `fill` of its kBlock samples are in: partition p takes the spectrum
+  // p - 1 blocks older than the newest
+  void SumTail(size_t fill) {
+    if (active_ < 2)
+      return;
+    size_t due = 1 + ((active_ - 1) * fill + kBlock - 1) / kBlock;
+    while (summed_ + 1 < due) {
+      size_t p = summed_ + 1;
+      size_t slot = head_ + partitions_ - (p - 1);
+      if (slot >= partitions_)
+        slot -= partitions_;
+      MultiplyAdd(fdl_ + slot * kSpectrum, ir_l_ + p * kSpectrum,
+                  ir_r_ + p * kSpectrum, next_l_, next_r_);
+      summed_++;
+    }
+  }
+
+  // acc += x * h, both channels, over all bins
+  static void MultiplyAdd(const float *x, const float *h_l, const float *h_r,
+                          float *acc_l, float *acc_r) {
+    for (size_t k = 0; k < kSpectrum; k += 2) {
+      float x_re = x[k], x_im = x[k + 1];
+      acc_l[k] += x_re * h_l[k] - x_im * h_l[k + 1];
+      acc_l[k + 1] += x_re * h_l[k + 1] + x_im * h_l[k];
+      acc_r[k] += x_re * h_r[k] - x_im * h_r[k + 1];
+      acc_r[k + 1] += x_re * h_r[k + 1] + x_im * h_r[k];
+    }
+  }
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include "FastMath.h"
+#include "RealFft.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Frequency-domain pitch shifter: phase vocoder with identity phase locking
+// (Laroche & Dolson, "New phase-vocoder techniques for pitch-shifting,
+// harmonizing and other exotic effects", 1999).
+//
+// Every kHop samples the last kSize inputs are Hann-windowed and transformed.
+// Each spectral peak and its region of influence (the bins closer to it than
+// to a neighbouring peak) are moved by the nearest whole number of bins to
+// the peak's frequency times the ratio, all rotated by the same phase; the
+// rotation advances by the peak's measured frequency times (ratio - 1) per
+// hop, which sets the exact shifted frequency. Regions keep their relative
+// phases, so partials stay coherent instead of smearing like the grains of
+// a delay-based shifter. The result is windowed again and overlap-added.
+//
+// The work comes in bursts of one frame per kHop samples; a stereo pair
+// staggers its frames by half a hop (Init's `offset`) so they alternate.
+// Latency is kSize samples. Longer frames resolve lower partials and cost
+// more per sample (log2 of the size); at 1024 points the object is about
+// 34K and lives in the SDRAM arena like daisysp::PitchShifter.
+template <int kLog2Frame> class PhaseVocoder {
+public:
+  static constexpr int kLog2Size = kLog2Frame;
+  static constexpr size_t kSize = (size_t)1 << kLog2Size;
+  static constexpr size_t kHop = kSize / 4;
+  static constexpr size_t kBins = kSize / 2 + 1;
+
+  // `offset` (< kHop) shifts this instance's frame schedule
+  void Init(float sample_rate, size_t offset = 0) {
+    (void)sample_rate; // Everything is in bins and samples
+    fft_.Init();
+    // Periodic Hann, analysis and synthesis: at 4x overlap the squared
+    // windows sum to 1.5; the inverse FFT adds kSize / 2
+    for (size_t i = 0; i < kSize; i++)
+      window_[i] = 0.5f - 0.5f * cosf(fastmath::kTwoPi * (float)i / kSize);
+    out_scale_ = 1.0f / (1.5f * (float)(kSize / 2));
+    memset(in_, 0, sizeof(in_));
+    memset(out_, 0, sizeof(out_));
+    memset(prev_, 0, sizeof(prev_));
+    prev_count_ = 0;
+    fill_ = offset % kHop;
+    ratio_ = 1.0f;
+  }
+
+  void SetTransposition(float semitones) {
+    ratio_ = fastmath::Exp2<kMathTier>(semitones * (1.0f / 12.0f));
+  }
+
+  // In place over any number of samples
+  void ProcessBlock(float *x, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      in_[kSize - kHop + fill_] = x[i];
+      x[i] = out_[fill_];
+      if (++fill_ == kHop) {
+        RunFrame();
+        fill_ = 0;
+      }
+    }
+  }
+
+  float Process(float x) {
+    ProcessBlock(&x, 1);
+    return x;
+  }
+
+private:
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
+  static constexpr size_t kMaxPeaks = kBins / 2;
+  static constexpr float kPeakFloor = 1.0e-6f; // Power, -60 dB below the max
+
+  RealFft<kLog2Size> fft_;
+  float window_[kSize];
+  float out_scale_;
+  float in_[kSize];  // Last kSize inputs, oldest first
+  float out_[kSize]; // Overlap-add, out_[0] plays next
+  float spec_[kSize + 2];
+  float prev_[kSize + 2];    // Previous frame's spectrum
+  float shifted_[kSize + 2]; // Output spectrum
+  float power_[kBins];
+  uint16_t peaks_[kMaxPeaks];
+  float theta_[kMaxPeaks]; // Rotation of each peak, turns
+  uint16_t prev_peaks_[kMaxPeaks];
+  float prev_theta_[kMaxPeaks];
+  size_t prev_count_;
+  size_t fill_;
+  float ratio_;
+
+  // Nearest integer of x, any sign
+  static float Round(float x) {
+    return (float)(int32_t)(x + (x >= 0.0f ? 0.5f : -0.5f));
+  }
+
+  void RunFrame() {
+    for (size_t i = 0; i < kSize; i++)
+      spec_[i] = in_[i] * window_[i];
+    fft_.Forward(spec_);
+
+    // Peaks: local maxima over +/-2 bins above the floor
+    float max_power = 0.0f;
+    for (size_t k = 0; k < kBins; k++) {
+      power_[k] =
+          spec_[2 * k] * spec_[2 * k] + spec_[2 * k + 1] * spec_[2 * k + 1];
+      if (power_[k] > max_power)
+        max_power = power_[k];
+    }
+    float floor = max_power * kPeakFloor;
+    size_t count = 0;
+    for (size_t k = 2; k + 2 < kBins && count < kMaxPeaks; k++) {
+      float p = power_[k];
+      if (p > floor && p > power_[k - 1] && p >= power_[k + 1] &&
+          p > power_[k - 2] && p >= power_[k + 2])
+        peaks_[count++] = (uint16_t)k;
+    }
+
+    memset(shifted_, 0, sizeof(shifted_));
+    size_t nearest = 0; // Index into the previous peaks, both ascending
+    for (size_t j = 0; j < count; j++) {
+      size_t k = peaks_[j];
+
+      // Frequency from the phase advance since the previous frame, turns
+      // per sample
+      float a_re = spec_[2 * k], a_im = spec_[2 * k + 1];
+      float b_re = prev_[2 * k], b_im = prev_[2 * k + 1];
+      float advance =
+          atan2f(a_im * b_re - a_re * b_im, a_re * b_re + a_im * b_im) *
+          fastmath::kInvTwoPi;
+      float expected = (float)(k * kHop) / (float)kSize;
+      float deviation = advance - expected;
+      deviation -= Round(deviation);
+      float freq = ((float)k + deviation * (float)kSize / (float)kHop) /
+                   (float)kSize;
+
+      // Rotation carried over from the closest previous peak
+      while (nearest + 1 < prev_count_ && prev_peaks_[nearest + 1] <= k)
+        nearest++;
+      float theta = 0.0f;
+      if (prev_count_ > 0) {
+        size_t best = nearest;
+        if (nearest + 1 < prev_count_ &&
+            abs((int)prev_peaks_[nearest + 1] - (int)k) <
+                abs((int)prev_peaks_[nearest] - (int)k))
+          best = nearest + 1;
+        theta = prev_theta_[best];
+      }
+      theta += (float)kHop * freq * (ratio_ - 1.0f);
+      theta -= Round(theta);
+      theta_[j] = theta;
+
+      // Region of influence: halfway to the neighbouring peaks
+      size_t lo = j == 0 ? 0 : (peaks_[j - 1] + k + 1) / 2;
+      size_t hi = j + 1 == count ? kBins : (k + peaks_[j + 1] + 1) / 2;
+      int shift = (int)Round((float)k * (ratio_ - 1.0f));
+      float r_re = fastmath::CosTurns<kMathTier>(theta);
+      float r_im = fastmath::SinTurns<kMathTier>(theta);
+      for (size_t b = lo; b < hi; b++) {
+        int dest = (int)b + shift;
+        if (dest < 0 || dest >= (int)kBins)
+          continue;
+        float x_re = spec_[2 * b], x_im = spec_[2 * b + 1];
+        shifted_[2 * dest] += x_re * r_re - x_im * r_im;
+        shifted_[2 * dest + 1] += x_re * r_im + x_im * r_re;
+      }
+    }
+    shifted_[1] = 0.0f; // DC and Nyquist stay real
+    shifted_[kSize + 1] = 0.0f;
+
+    memcpy(prev_, spec_, sizeof(prev_));
+    memcpy(prev_peaks_, peaks_, count * sizeof(uint16_t));
+    memcpy(prev_theta_, theta_, count * sizeof(float));
+    prev_count_ = count;
+
+    fft_.Inverse(shifted_);
+    memmove(in_, in_ + kHop, (kSize - kHop) * sizeof(float));
+    memmove(out_, out_ + kHop, (kSize - kHop) * sizeof(float));
+    memset(out_ + kSize - kHop, 0, kHop * sizeof(float));
+    for (size_t i = 0; i < kSize; i++)
+      out_[i] += shifted_[i] * window_[i] * out_scale_;
+  }
+};
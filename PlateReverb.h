@@ -1,139 +1,230 @@
 #pragma once
+#include "DelayBuffer.h"
+#include "FastMath.h"
 #include "daisy_legio.h"
 #include "daisysp.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 using namespace daisy;
 using namespace daisysp;
 
-// Helper: Delay-based Allpass Filter
+// Line lengths and output taps of the Dattorro plate (J. Dattorro, "Effect
+// Design Part 1", JAES 1997), given at the paper's 29761 Hz and scaled to the
+// running rate. They live outside PlateReverb so its storage can be sized
+// from them.
+namespace plate_layout {
+
+static constexpr float kReferenceRate = 29761.0f;
+static constexpr float kMaxSampleRate = 96000.0f; // Storage is sized for it
+static constexpr size_t kChunk = 64;              // Samples per block pass
+static constexpr size_t kExcursion = 16;          // Tank modulation depth
+
+enum Line {
+  kInAp1, // Input diffusers
+  kInAp2,
+  kInAp3,
+  kInAp4,
+  kModApL, // Left tank
+  kDelayL1,
+  kApL,
+  kDelayL2,
+  kModApR, // Right tank
+  kDelayR1,
+  kApR,
+  kDelayR2,
+  kLineCount
+};
+
+static constexpr size_t kLength[kLineCount] = {
+    142, 107, 379, 277, 672, 4453, 1800, 3720, 908, 4217, 2656, 3163};
+
+// Output taps: line, position at the reference rate, sign
+struct Tap {
+  uint8_t line;
+  uint16_t position;
+  int8_t sign;
+};
+
+static constexpr size_t kTapsPerChannel = 7;
+static constexpr size_t kTapCount = 2 * kTapsPerChannel;
+static constexpr Tap kTaps[kTapCount] = {
+    // Left
+    {kDelayR1, 266, 1},
+    {kDelayR1, 2974, 1},
+    {kApR, 1913, -1},
+    {kDelayR2, 1996, 1},
+    {kDelayL1, 1990, -1},
+    {kApL, 187, -1},
+    {kDelayL2, 1066, -1},
+    // Right
+    {kDelayL1, 353, 1},
+    {kDelayL1, 3627, 1},
+    {kApL, 1228, -1},
+    {kDelayL2, 2673, 1},
+    {kDelayR1, 2111, -1},
+    {kApR, 335, -1},
+    {kDelayR2, 121, -1},
+};
+
+constexpr size_t Scaled(size_t samples, float fs) {
+  return (size_t)((float)samples * fs / kReferenceRate + 0.5f);
+}
+
+constexpr bool Modulated(size_t line) {
+  return line == kModApL || line == kModApR;
+}
+
+// Longest span read from a line in one go: a chunk, plus on the modulated
+// allpasses the excursion either side and the interpolation's second point
+constexpr size_t Guard(size_t line, float fs) {
+  return Modulated(line) ? kChunk + 2 * Scaled(kExcursion, fs) + 1 : kChunk;
+}
+
+// Every line can be read up to its delay plus the excursion, a span back
+// from the write position (taps are read after the chunk is written)
+constexpr size_t LineLength(size_t line, float fs) {
+  return Scaled(kLength[line], fs) + Scaled(kExcursion, fs) +
+         Guard(line, fs);
+}
+
+constexpr size_t LineFloats(size_t line, float fs) {
+  return DelayBuffer::BufferSize(LineLength(line, fs), Guard(line, fs));
+}
+
+constexpr size_t PoolFloats(float fs) {
+  size_t total = 0;
+  for (size_t line = 0; line < kLineCount; line++)
+    total += LineFloats(line, fs);
+  return total;
+}
+
+} // namespace plate_layout
+
+// Schroeder allpass over a DelayBuffer whose delay is fixed at Init. The
+// delay is at least a chunk, so the delayed samples a whole chunk meets are
+// already in the line: the caller reads them as one span (Delayed), runs
+// Step per sample into the line's WriteSpan, and then calls Advance.
 class ReverbAllpass {
 public:
-  void Init(float *buffer, int size) {
-    buf_ = buffer;
-    max_size_ = size;
-    write_pos_ = 0;
-    for (int i = 0; i < max_size_; i++) {
-      buf_[i] = 0.0f;
-    }
+  // `buffer` holds DelayBuffer::BufferSize(length, guard) floats, `guard`
+  // is the longest span read, and `delay` is at least a chunk (plus the
+  // excursion if modulated)
+  void Init(float *buffer, size_t length, size_t guard, size_t delay,
+            bool clear = true) {
+    delay_ = delay;
+    line_.Init(buffer, length, guard, clear);
   }
 
-  float Process(float in, float coeff) {
-    float buf_out = buf_[write_pos_];
-    float out = -in + buf_out;
-    buf_[write_pos_] = in + (buf_out * coeff);
-
-    write_pos_++;
-    if (write_pos_ >= max_size_)
-      write_pos_ = 0;
+  // p[i] meets input i of the next chunk; `extra` samples further back
+  // for a modulated read that can reach ahead of the delay
+  const float *Delayed(size_t extra = 0) const {
+    return line_.Span(delay_ + extra);
+  }
 
-    return out;
+  // Output for input `x` against the delayed `d`; `w` enters the line
+  static inline float Step(float x, float d, float coeff, float &w) {
+    w = x + coeff * d;
+    return d - coeff * w;
   }
 
+  float *WriteSpan() { return line_.WriteSpan(); }
+  void Advance(size_t n) { line_.Advance(n); }
+
+  const DelayBuffer &Line() const { return line_; } // For output taps
+
 private:
-  float *buf_;
-  int max_size_;
-  int write_pos_;
+  DelayBuffer line_;
+  size_t delay_;
 };
 
+// Dattorro plate: bandwidth filter and four input diffusers into two
+// cross-coupled tanks (modulated allpass, delay, damping, allpass, delay),
+// with the paper's seven output taps per channel.
+//
+// Processed in blocks of up to kChunk samples. Every line is longer than a
+// chunk, so everything a chunk reads from the lines is in memory before it
+// starts: the delayed samples are read in place as spans, the input
+// diffusers and both tanks each run as one fused loop writing straight into
+// the lines, and each channel sums its seven taps in a single pass. No line
+// access tests for the wrap, not even the modulated read, whose span covers
+// the excursion.
+//
+// Placement: like ReverbSc the object holds its own lines, sized for
+// plate_layout::kMaxSampleRate, and the owner puts it in SDRAM; the block
+// copies are sequential bursts the data cache absorbs.
 class PlateReverb {
 public:
+  static constexpr size_t kChunk = plate_layout::kChunk;
+
+  // The shortest line (107 at the reference rate) must cover a chunk, so
+  // sample_rate is at least 18 kHz
   void Init(float sample_rate) {
-    fs_ = sample_rate;
-
-    // Initialize Input Diffusion Allpasses
-    ap1_.Init(ap1_buf_, 142);
-    ap2_.Init(ap2_buf_, 107);
-    ap3_.Init(ap3_buf_, 379);
-    ap4_.Init(ap4_buf_, 277);
-
-    // Initialize Tank Left
-    del_l_.Init();
-    del_l_.SetDelay(4453.0f); // Base delay
-    ap5_.Init(ap5_buf_, 1800);
-    ap6_.Init(ap6_buf_, 2656);
-    tank_l_end_.Init();
-    tank_l_end_.SetDelay(3720.0f);
-
-    // Initialize Tank Right
-    del_r_.Init();
-    del_r_.SetDelay(4217.0f); // Base delay
-    ap7_.Init(ap7_buf_, 2656);
-    ap8_.Init(ap8_buf_, 1800);
-    tank_r_end_.Init();
-    tank_r_end_.SetDelay(3163.0f);
-
-    // LFO for modulation
-    lfo_.Init(fs_);
-    lfo_.SetWaveform(Oscillator::WAVE_SIN);
-    lfo_.SetFreq(1.0f); // Slow modulation
-    lfo_.SetAmp(10.0f); // +/- 10 samples
+    using namespace plate_layout;
+    fs_ = fminf(sample_rate, kMaxSampleRate); // Higher rates: shorter tail
+    memset(pool_, 0, PoolFloats(fs_) * sizeof(float));
+
+    float *buf = pool_;
+    size_t delay[kLineCount];
+    for (size_t line = 0; line < kLineCount; line++)
+      delay[line] = Scaled(kLength[line], fs_);
+    for (size_t line = 0; line < kLineCount; line++) {
+      size_t length = LineLength(line, fs_);
+      switch (line) {
+      case kDelayL1:
+      case kDelayL2:
+      case kDelayR1:
+      case kDelayR2:
+        Delay(line).Init(buf, length, Guard(line, fs_), false);
+        break;
+      default:
+        Allpass(line).Init(buf, length, Guard(line, fs_), delay[line], false);
+        break;
+      }
+      buf += LineFloats(line, fs_);
+    }
+    delay_l1_ = delay[kDelayL1];
+    delay_l2_ = delay[kDelayL2];
+    delay_r1_ = delay[kDelayR1];
+    delay_r2_ = delay[kDelayR2];
+    for (size_t tap = 0; tap < kTapCount; tap++)
+      taps_[tap] = Scaled(kTaps[tap].position, fs_);
+
+    // Quadrature LFO: sine to the left tank, cosine to the right
+    lfo_inc_ = (uint32_t)(kLfoFreq / fs_ / kPhaseToTurns + 0.5f);
+    lfo_phase_ = 0;
+    lfo_s_ = 0.0f;
+    lfo_c_ = 1.0f;
+    excursion_ = Scaled(kExcursion, fs_);
 
     decay_ = 0.5f;
-    damping_ = 0.005f; // Lowpass coefficient
+    SetLpFreq(fs_ * 0.25f);
+    bandwidth_state_ = 0.0f;
     lp_l_ = 0.0f;
     lp_r_ = 0.0f;
-    tank_l_out_ = 0.0f;
-    tank_r_out_ = 0.0f;
+  }
+
+  // Bytes of the line storage Init uses at `sample_rate`
+  static constexpr size_t UsedBytes(float sample_rate) {
+    return plate_layout::PoolFloats(sample_rate) * sizeof(float);
+  }
+
+  // Any block size; per sample (size 1) for use inside a feedback loop
+  void ProcessBlock(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t size) {
+    for (size_t offset = 0; offset < size; offset += kChunk) {
+      size_t n = size - offset;
+      if (n > kChunk)
+        n = kChunk;
+      ProcessChunk(in_l + offset, in_r + offset, out_l + offset,
+                   out_r + offset, n);
+    }
   }
 
   void Process(float in_l, float in_r, float *out_l, float *out_r) {
-    // Mono-sum input for diffusion (simplification)
-    float in = (in_l + in_r) * 0.5f;
-
-    // Input Diffusion
-    float t = ap1_.Process(in, 0.75f);
-    t = ap2_.Process(t, 0.75f);
-    t = ap3_.Process(t, 0.625f);
-    t = ap4_.Process(t, 0.625f);
-
-    // Cross-coupling feedback with Safety Clip
-    // Prevent explosion if decay is high or input is hot
-    float tank_in_l = t + (tank_r_out_ * decay_);
-    float tank_in_r = t + (tank_l_out_ * decay_);
-
-    tank_in_l = fclamp(tank_in_l, -4.0f, 4.0f);
-    tank_in_r = fclamp(tank_in_r, -4.0f, 4.0f);
-
-    // Modulation
-    float mod = lfo_.Process();
-
-    // Tank Left
-    // Modulated Delay
-    del_l_.Write(tank_in_l);
-    float d_l = del_l_.Read(4453.0f + mod);
-
-    // Damping (Lowpass)
-    lp_l_ = (d_l * (1.0f - damping_)) + (lp_l_ * damping_);
-
-    // Allpasses
-    float a_l = ap5_.Process(lp_l_, 0.5f);
-    a_l = ap6_.Process(a_l, 0.5f);
-
-    // End Delay
-    tank_l_end_.Write(a_l);
-    tank_l_out_ = tank_l_end_.Read(3720.0f);
-
-    // Tank Right
-    // Modulated Delay
-    del_r_.Write(tank_in_r);
-    float d_r = del_r_.Read(4217.0f - mod); // Anti-phase mod
-
-    // Damping
-    lp_r_ = (d_r * (1.0f - damping_)) + (lp_r_ * damping_);
-
-    // Allpasses
-    float a_r = ap7_.Process(lp_r_, 0.5f);
-    a_r = ap8_.Process(a_r, 0.5f);
-
-    // End Delay
-    tank_r_end_.Write(a_r);
-    tank_r_out_ = tank_r_end_.Read(3163.0f);
-
-    // Output Taps (Simplified for safety and clarity)
-    // Summing multiple taps creates the dense plate sound
-    // But for now, let's stick to the main tank outputs + early reflections
-    *out_l = tank_l_out_ + d_l - d_r;
-    *out_r = tank_r_out_ + d_r - d_l;
+    ProcessChunk(&in_l, &in_r, out_l, out_r, 1);
   }
 
   void SetDecay(float decay) {
@@ -145,33 +236,197 @@ public:
     damping_ = fclamp(damping, 0.0f, 1.0f);
   }
 
+  // Damping as the cutoff of the one-pole in each tank
+  void SetLpFreq(float freq) {
+    SetDamping(expf(-TWOPI_F * fclamp(freq, 0.0f, fs_ * 0.5f) / fs_));
+  }
+
 private:
+  static constexpr float kBandwidth = 0.9995f;
+  static constexpr float kInputDiffusion1 = 0.75f;
+  static constexpr float kInputDiffusion2 = 0.625f;
+  static constexpr float kDecayDiffusion1 = -0.70f; // Inverted, as in the paper
+  static constexpr float kDecayDiffusion2 = 0.50f;
+  static constexpr float kLfoFreq = 1.0f;
+  static constexpr float kOutputGain = 0.6f;
+  static constexpr fastmath::Tier kMathTier = fastmath::Tier::kAccurate;
+  static constexpr float kPhaseToTurns = 1.0f / 4294967296.0f;
+
   float fs_;
   float decay_;
   float damping_;
+  float bandwidth_state_;
   float lp_l_, lp_r_;
-  float tank_l_out_, tank_r_out_;
-
-  Oscillator lfo_;
-
-  // Diffusion Allpasses
-  ReverbAllpass ap1_, ap2_, ap3_, ap4_;
-  float ap1_buf_[142];
-  float ap2_buf_[107];
-  float ap3_buf_[379];
-  float ap4_buf_[277];
-
-  // Tank Left
-  DelayLine<float, 6000> del_l_;
-  ReverbAllpass ap5_, ap6_;
-  float ap5_buf_[1800];
-  float ap6_buf_[2656];
-  DelayLine<float, 4000> tank_l_end_;
-
-  // Tank Right
-  DelayLine<float, 6000> del_r_;
-  ReverbAllpass ap7_, ap8_;
-  float ap7_buf_[2656];
-  float ap8_buf_[1800];
-  DelayLine<float, 4000> tank_r_end_;
+  uint32_t lfo_phase_, lfo_inc_; // Turns, wrapping at 2^32
+  float lfo_s_, lfo_c_;         // At lfo_phase_
+  size_t excursion_; // Samples
+  size_t delay_l1_, delay_l2_, delay_r1_, delay_r2_;
+  size_t taps_[plate_layout::kTapCount];
+
+  ReverbAllpass in_ap_[4];
+  ReverbAllpass mod_ap_l_, ap_l_, mod_ap_r_, ap_r_;
+  DelayBuffer delay_l1_line_, delay_l2_line_, delay_r1_line_, delay_r2_line_;
+
+  float pool_[plate_layout::PoolFloats(plate_layout::kMaxSampleRate)];
+
+  ReverbAllpass &Allpass(size_t line) {
+    switch (line) {
+    case plate_layout::kModApL:
+      return mod_ap_l_;
+    case plate_layout::kApL:
+      return ap_l_;
+    case plate_layout::kModApR:
+      return mod_ap_r_;
+    case plate_layout::kApR:
+      return ap_r_;
+    default:
+      return in_ap_[line - plate_layout::kInAp1];
+    }
+  }
+
+  DelayBuffer &Delay(size_t line) {
+    switch (line) {
+    case plate_layout::kDelayL1:
+      return delay_l1_line_;
+    case plate_layout::kDelayL2:
+      return delay_l2_line_;
+    case plate_layout::kDelayR1:
+      return delay_r1_line_;
+    default:
+      return delay_r2_line_;
+    }
+  }
+
+  const DelayBuffer &TapLine(size_t line) const {
+    switch (line) {
+    case plate_layout::kDelayL1:
+      return delay_l1_line_;
+    case plate_layout::kApL:
+      return ap_l_.Line();
+    case plate_layout::kDelayL2:
+      return delay_l2_line_;
+    case plate_layout::kDelayR1:
+      return delay_r1_line_;
+    case plate_layout::kApR:
+      return ap_r_.Line();
+    default:
+      return delay_r2_line_;
+    }
+  }
+
+  // One pass of every stage over `n` (<= kChunk) samples
+  void ProcessChunk(const float *in_l, const float *in_r, float *out_l,
+                    float *out_r, size_t n) {
+    using namespace plate_layout;
+
+    // Bandwidth-limited mono input through the four input diffusers
+    const float *d1 = in_ap_[0].Delayed();
+    const float *d2 = in_ap_[1].Delayed();
+    const float *d3 = in_ap_[2].Delayed();
+    const float *d4 = in_ap_[3].Delayed();
+    float *w1 = in_ap_[0].WriteSpan();
+    float *w2 = in_ap_[1].WriteSpan();
+    float *w3 = in_ap_[2].WriteSpan();
+    float *w4 = in_ap_[3].WriteSpan();
+    float x[kChunk];
+    float bw = bandwidth_state_;
+    for (size_t i = 0; i < n; i++) {
+      bw = kBandwidth * 0.5f * (in_l[i] + in_r[i]) + (1.0f - kBandwidth) * bw;
+      float v = ReverbAllpass::Step(bw, d1[i], kInputDiffusion1, w1[i]);
+      v = ReverbAllpass::Step(v, d2[i], kInputDiffusion1, w2[i]);
+      v = ReverbAllpass::Step(v, d3[i], kInputDiffusion2, w3[i]);
+      x[i] = ReverbAllpass::Step(v, d4[i], kInputDiffusion2, w4[i]);
+    }
+    bandwidth_state_ = bw;
+    for (ReverbAllpass &ap : in_ap_)
+      ap.Advance(n);
+
+    // The 1 Hz LFO is evaluated once per chunk and ramped across it; its
+    // phase is exact, so it does not drift with the chunk size
+    float exc = (float)excursion_;
+    float s = lfo_s_ * exc, c = lfo_c_ * exc;
+    lfo_phase_ += lfo_inc_ * (uint32_t)n;
+    float turns = (float)lfo_phase_ * kPhaseToTurns;
+    lfo_s_ = fastmath::SinTurns<kMathTier>(turns);
+    lfo_c_ = fastmath::CosTurns<kMathTier>(turns);
+    float ds = (lfo_s_ * exc - s) / (float)n;
+    float dc = (lfo_c_ * exc - c) / (float)n;
+
+    // Both tanks side by side. Sample i of a modulated allpass is read at
+    // delay - i + mod, i.e. at position excursion - mod + i of its span
+    // (which starts the excursion beyond the delay), linearly interpolated.
+    // Each tank is fed by the other's end delay.
+    const float *end_l = delay_r2_line_.Span(delay_r2_);
+    const float *end_r = delay_l2_line_.Span(delay_l2_);
+    const float *mod_l = mod_ap_l_.Delayed(excursion_);
+    const float *mod_r = mod_ap_r_.Delayed(excursion_);
+    const float *del_l = delay_l1_line_.Span(delay_l1_);
+    const float *del_r = delay_r1_line_.Span(delay_r1_);
+    const float *ap_l = ap_l_.Delayed();
+    const float *ap_r = ap_r_.Delayed();
+    float *wm_l = mod_ap_l_.WriteSpan(), *wm_r = mod_ap_r_.WriteSpan();
+    float *y1_l = delay_l1_line_.WriteSpan();
+    float *y1_r = delay_r1_line_.WriteSpan();
+    float *wa_l = ap_l_.WriteSpan(), *wa_r = ap_r_.WriteSpan();
+    float *y2_l = delay_l2_line_.WriteSpan();
+    float *y2_r = delay_r2_line_.WriteSpan();
+    float p_l = exc - s, step_l = 1.0f - ds;
+    float p_r = exc - c, step_r = 1.0f - dc;
+    float lp_l = lp_l_, lp_r = lp_r_;
+    float damp_in = (1.0f - damping_) * decay_, damp_fb = damping_;
+    for (size_t i = 0; i < n; i++) {
+      float t_l = x[i] + decay_ * end_l[i];
+      float t_r = x[i] + decay_ * end_r[i];
+
+      int j_l = (int)p_l; // p >= 0: truncation is floor
+      int j_r = (int)p_r;
+      float m_l = mod_l[j_l] + (mod_l[j_l + 1] - mod_l[j_l]) * (p_l - j_l);
+      float m_r = mod_r[j_r] + (mod_r[j_r + 1] - mod_r[j_r]) * (p_r - j_r);
+      p_l += step_l;
+      p_r += step_r;
+      y1_l[i] = ReverbAllpass::Step(t_l, m_l, kDecayDiffusion1, wm_l[i]);
+      y1_r[i] = ReverbAllpass::Step(t_r, m_r, kDecayDiffusion1, wm_r[i]);
+
+      // First delay, damping, allpass; the end delay takes the result
+      lp_l = del_l[i] * damp_in + lp_l * damp_fb;
+      lp_r = del_r[i] * damp_in + lp_r * damp_fb;
+      y2_l[i] = ReverbAllpass::Step(lp_l, ap_l[i], kDecayDiffusion2, wa_l[i]);
+      y2_r[i] = ReverbAllpass::Step(lp_r, ap_r[i], kDecayDiffusion2, wa_r[i]);
+    }
+    lp_l_ = lp_l;
+    lp_r_ = lp_r;
+    mod_ap_l_.Advance(n);
+    mod_ap_r_.Advance(n);
+    delay_l1_line_.Advance(n);
+    delay_r1_line_.Advance(n);
+    ap_l_.Advance(n);
+    ap_r_.Advance(n);
+    delay_l2_line_.Advance(n);
+    delay_r2_line_.Advance(n);
+
+    // Output taps, read after the chunk is written: sample i of a tap
+    // `position` back is `position + n - i` writes back
+    Taps<0>(out_l, n);
+    Taps<kTapsPerChannel>(out_r, n);
+  }
+
+  // One channel's taps, from kTaps[kFirst], summed in one pass
+  template <size_t kFirst> void Taps(float *out, size_t n) const {
+    using namespace plate_layout;
+    const float *p[kTapsPerChannel];
+    for (size_t t = 0; t < kTapsPerChannel; t++)
+      p[t] = TapLine(kTaps[kFirst + t].line).Span(taps_[kFirst + t] + n);
+    // The signs are +1/-1: added or subtracted, one gain for the sum, which
+    // is a tree (a chain of seven adds is bound by their latency)
+    static_assert(kTapsPerChannel == 7, "tap sum below");
+    auto tap = [&](size_t t, size_t i) {
+      return kTaps[kFirst + t].sign > 0 ? p[t][i] : -p[t][i];
+    };
+    for (size_t i = 0; i < n; i++) {
+      float a = tap(0, i) + tap(1, i);
+      float b = tap(2, i) + tap(3, i);
+      float c = tap(4, i) + tap(5, i);
+      out[i] = kOutputGain * ((a + b) + (c + tap(6, i)));
+    }
+  }
 };
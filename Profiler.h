@@ -0,0 +1,226 @@
+#pragma once
+#include "daisy_legio.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef LEGIO_HOST
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LEGIO_PROFILE_TSC 1
+#endif
+#endif
+
+// Per-stage timing of the audio path (`make PROFILE=1`, or
+// `make -f Makefile.host PROFILE=1`; compiled out otherwise).
+//
+// LEGIO_PROFILE_SCOPE("mode/stage") times the rest of the enclosing block
+// in clock ticks: the Cortex-M7 DWT cycle counter on target, the TSC (or
+// clock_gettime) on the host. Each stage keeps its last kWindow durations
+// in a ring; the main loop summarises them (min/avg/max/p99) with
+// Summarize() and prints them. A stage records one duration per pass
+// through its scope, so stages inside a chunk loop record one per chunk.
+// The clock (Init, Now, TicksPerUs) is always built: BlockLoad.h times
+// every callback with it. The stages are built with LEGIO_PROFILE only.
+//
+// Stages register by name on first use and are recorded from the audio
+// callback only; a scope in a template kernel shares one stage across its
+// instantiations. Each scope keeps its stage index in a constant-initialised
+// StageId, so the callback runs no static-initialisation guard. The ring is
+// written by the callback and read by the main loop without locks: the
+// reader retries if a call completed during its copy.
+namespace profiler {
+
+// Clock ticks per microsecond, set by Init (a constant-initialised static:
+// no guard)
+inline float &TickRate() {
+  static float ticks_per_us = 0.0f;
+  return ticks_per_us;
+}
+
+inline uint32_t Now() {
+#if defined(LEGIO_PROFILE_TSC)
+  return (uint32_t)__rdtsc();
+#elif defined(LEGIO_HOST)
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#else
+  return DWT->CYCCNT;
+#endif
+}
+
+// Starts the clock: enables the cycle counter on target, calibrates the
+// TSC on the host. Call once before audio starts.
+inline void Init() {
+#if defined(LEGIO_HOST)
+#if defined(LEGIO_PROFILE_TSC)
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint32_t c0 = Now();
+  double ns = 0.0;
+  while (ns < 1.0e7) { // 10 ms
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1.0e9 + (t1.tv_nsec - t0.tv_nsec);
+  }
+  TickRate() = (float)((Now() - c0) * 1.0e3 / ns);
+#else
+  TickRate() = 1.0e3f;
+#endif
+#else
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55; // Cortex-M7: unlock the DWT registers
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  TickRate() = SystemCoreClock * 1.0e-6f;
+#endif
+}
+
+inline float TicksPerUs() { return TickRate(); }
+
+#ifdef LEGIO_PROFILE
+static constexpr int kMaxStages = 32;
+static constexpr uint32_t kWindow = 128; // Calls kept per stage
+
+struct Stage {
+  const char *name;
+  uint32_t ticks[kWindow];
+  std::atomic<uint32_t> calls; // Total; the newest is calls - 1
+};
+
+// Summary of a stage's window, in ticks
+struct Stats {
+  const char *name;
+  uint32_t calls;
+  uint32_t min, max, p99;
+  float avg;
+};
+
+// One registry per program (an inline function's static, zero-initialised:
+// no guard), in plain RAM: the rings are too large to spend DTCM on
+struct Registry {
+  Stage stages[kMaxStages];
+  std::atomic<int> count;
+};
+
+inline Registry &GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+// Index of the stage called `name`, added on first use; -1 if the registry
+// is full
+inline int Register(const char *name) {
+  Registry &r = GetRegistry();
+  int n = r.count.load(std::memory_order_relaxed);
+  for (int i = 0; i < n; i++)
+    if (!strcmp(r.stages[i].name, name))
+      return i;
+  if (n == kMaxStages)
+    return -1;
+  r.stages[n].name = name;
+  r.stages[n].calls.store(0, std::memory_order_relaxed);
+  r.count.store(n + 1, std::memory_order_release);
+  return n;
+}
+
+inline void Record(int stage, uint32_t ticks) {
+  if (stage < 0)
+    return;
+  Stage &s = GetRegistry().stages[stage];
+  uint32_t n = s.calls.load(std::memory_order_relaxed);
+  s.ticks[n % kWindow] = ticks;
+  s.calls.store(n + 1, std::memory_order_release);
+}
+
+// A scope's stage: its name, and its index once the first pass has
+// registered it
+struct StageId {
+  static constexpr int kUnregistered = -2; // Register returns -1 when full
+
+  constexpr explicit StageId(const char *stage_name)
+      : name(stage_name), index(kUnregistered) {}
+
+  const char *name;
+  int index;
+};
+
+class Scope {
+public:
+  explicit Scope(StageId &id) : stage_(Index(id)), start_(Now()) {}
+  ~Scope() { Record(stage_, Now() - start_); }
+
+private:
+  int stage_;
+  uint32_t start_;
+
+  static int Index(StageId &id) {
+    if (id.index == StageId::kUnregistered)
+      id.index = Register(id.name);
+    return id.index;
+  }
+};
+
+inline int StageCount() {
+  return GetRegistry().count.load(std::memory_order_acquire);
+}
+
+// Main loop: summary of the last kWindow calls of `stage`; false if it has
+// not been called
+inline bool Summarize(int stage, Stats &out) {
+  Stage &s = GetRegistry().stages[stage];
+  uint32_t window[kWindow];
+  uint32_t calls, again;
+  do {
+    calls = s.calls.load(std::memory_order_acquire);
+    memcpy(window, s.ticks, sizeof(window));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    again = s.calls.load(std::memory_order_relaxed);
+  } while (calls != again);
+  if (calls == 0)
+    return false;
+
+  uint32_t n = calls < kWindow ? calls : kWindow;
+  // Insertion sort: small, and off the audio path
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t v = window[i];
+    sum += v;
+    uint32_t j = i;
+    for (; j > 0 && window[j - 1] > v; j--)
+      window[j] = window[j - 1];
+    window[j] = v;
+  }
+  out.name = s.name;
+  out.calls = calls;
+  out.min = window[0];
+  out.max = window[n - 1];
+  out.p99 = window[(n - 1) * 99 / 100];
+  out.avg = (float)sum / (float)n;
+  return true;
+}
+
+// Clears every stage's window (not while the callback runs)
+inline void Reset() {
+  Registry &r = GetRegistry();
+  for (int i = 0; i < StageCount(); i++)
+    r.stages[i].calls.store(0, std::memory_order_relaxed);
+}
+#endif // LEGIO_PROFILE
+
+} // namespace profiler
+
+#ifdef LEGIO_PROFILE
+#define LEGIO_PROFILE_CONCAT2(a, b) a##b
+#define LEGIO_PROFILE_CONCAT(a, b) LEGIO_PROFILE_CONCAT2(a, b)
+#define LEGIO_PROFILE_SCOPE(name)                                             \
+  static profiler::StageId LEGIO_PROFILE_CONCAT(profile_stage_, __LINE__)(    \
+      name);                                                                  \
+  profiler::Scope LEGIO_PROFILE_CONCAT(profile_scope_, __LINE__)(             \
+      LEGIO_PROFILE_CONCAT(profile_stage_, __LINE__))
+#else
+#define LEGIO_PROFILE_SCOPE(name)                                             \
+  do {                                                                        \
+  } while (0)
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+// Quality level of the active mode, chosen from the recent block loads
+// (BlockLoadHistogram windows).
+//
+// Level 0 is full quality; each mode defines cheaper levels above it
+// (SetQuality). The governor runs in the main loop, once per completed
+// window, and reacts to the worst block of the window rather than the
+// average: a mode that overruns its deadline once every few blocks already
+// drops audio. It steps down (cheaper) after kDownWindows consecutive
+// windows above kStepDownLoad, and back up only after hold_ consecutive
+// windows below kStepUpLoad. The gap between the two thresholds keeps a
+// load near one of them from toggling the level; the window after a change
+// is skipped, as it still holds blocks of the previous level. If a step up
+// is followed by a step down within the hold, the hold doubles (up to
+// kMaxHoldWindows), so a level that does not fit is retried less and less
+// often.
+class QualityGovernor {
+public:
+  static constexpr float kStepDownLoad = 0.85f; // Of the block deadline
+  static constexpr float kStepUpLoad = 0.6f;
+  static constexpr int kDownWindows = 2;
+  static constexpr int kHoldWindows = 32;     // ~1 s of 48-sample blocks
+  static constexpr int kMaxHoldWindows = 512; // ~16 s
+
+  // On mode activation: `levels` quality levels, starting at full quality
+  // (or at the pinned level)
+  void Reset(int levels) {
+    levels_ = levels;
+    level_ = pinned_ < 0 ? 0 : pinned_ < levels ? pinned_ : levels - 1;
+    over_ = 0;
+    calm_ = 0;
+    hold_ = kHoldWindows;
+    since_up_ = kMaxHoldWindows;
+    settle_ = false;
+  }
+
+  // Fixes the level (clamped by Reset) for every mode; -1 lets the load
+  // decide. Applies from the next Reset.
+  void Pin(int level) { pinned_ = level; }
+
+  // One completed window whose worst block took `window_max` deadlines;
+  // true if the level changed
+  bool Update(float window_max) {
+    if (pinned_ >= 0)
+      return false;
+    if (since_up_ < kMaxHoldWindows)
+      since_up_++;
+    if (settle_) {
+      settle_ = false;
+      return false;
+    }
+
+    if (window_max > kStepDownLoad) {
+      calm_ = 0;
+      if (++over_ < kDownWindows || level_ == levels_ - 1)
+        return false;
+      if (since_up_ <= hold_) // The level above did not fit after all
+        hold_ = hold_ * 2 < kMaxHoldWindows ? hold_ * 2 : kMaxHoldWindows;
+      return Step(level_ + 1);
+    }
+    over_ = 0;
+    if (window_max >= kStepUpLoad) {
+      calm_ = 0;
+      return false;
+    }
+    if (++calm_ < hold_ || level_ == 0)
+      return false;
+    since_up_ = 0;
+    return Step(level_ - 1);
+  }
+
+  int Level() const { return level_; }
+  int Levels() const { return levels_; }
+
+private:
+  int levels_ = 1;
+  int level_ = 0;
+  int pinned_ = -1;
+  int over_ = 0;     // Consecutive windows above kStepDownLoad
+  int calm_ = 0;     // Consecutive windows below kStepUpLoad
+  int hold_ = kHoldWindows;
+  int since_up_ = kMaxHoldWindows; // Windows since the last step up
+  bool settle_ = false;
+
+  bool Step(int level) {
+    level_ = level;
+    over_ = 0;
+    calm_ = 0;
+    settle_ = true;
+    return true;
+  }
+};
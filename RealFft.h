@@ -0,0 +1,146 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Real FFT of 2^kLog2Size points, in place.
+//
+// The N real samples are taken as N/2 complex ones (even samples real, odd
+// imaginary), transformed with an iterative decimation-in-time FFT of N/2
+// points and split into the N/2 + 1 bins of the real spectrum. The first two
+// DIT stages have only trivial twiddles (1, -i) and run as one radix-4 pass;
+// the rest are radix-2. Twiddles and the bit-reversal permutation are
+// tables filled by Init().
+//
+// Spectrum layout (kSize + 2 floats): bin k at [2k] (re), [2k + 1] (im) for
+// k = 0..kSize/2; the imaginary parts of bins 0 and kSize/2 are zero.
+template <int kLog2Size> class RealFft {
+public:
+  static constexpr size_t kSize = (size_t)1 << kLog2Size;
+  static constexpr size_t kBins = kSize / 2 + 1;
+  static_assert(kLog2Size >= 4, "radix-4 first pass needs 8+ points");
+
+  void Init() {
+    for (size_t k = 0; k < kHalf; k++) {
+      double w = 2.0 * M_PI * (double)k / (double)kSize;
+      cos_[k] = (float)cos(w);
+      sin_[k] = (float)sin(w);
+    }
+    for (size_t i = 0; i < kHalf; i++) {
+      size_t r = 0;
+      for (int b = 0; b < kLog2Size - 1; b++)
+        r |= ((i >> b) & 1) << (kLog2Size - 2 - b);
+      bitrev_[i] = (uint16_t)r;
+    }
+  }
+
+  // `data`: kSize samples in, spectrum (kSize + 2 floats) out, unscaled
+  void Forward(float *data) const {
+    Complex(data, false);
+
+    // Split: bins k and kHalf - k from Z[k] and Z[kHalf - k]
+    float z0_re = data[0], z0_im = data[1];
+    data[0] = z0_re + z0_im;
+    data[1] = 0.0f;
+    data[kSize] = z0_re - z0_im;
+    data[kSize + 1] = 0.0f;
+    for (size_t k = 1; k <= kHalf / 2; k++) {
+      size_t m = kHalf - k;
+      float zk_re = data[2 * k], zk_im = data[2 * k + 1];
+      float zm_re = data[2 * m], zm_im = -data[2 * m + 1]; // conj(Z[m])
+      float e_re = 0.5f * (zk_re + zm_re), e_im = 0.5f * (zk_im + zm_im);
+      float o_re = 0.5f * (zk_re - zm_re), o_im = 0.5f * (zk_im - zm_im);
+      // t = i W^k o with W^k = cos - i sin
+      float wo_re = cos_[k] * o_re + sin_[k] * o_im;
+      float wo_im = cos_[k] * o_im - sin_[k] * o_re;
+      float t_re = -wo_im, t_im = wo_re;
+      data[2 * k] = e_re - t_re; // X[k] = e - t
+      data[2 * k + 1] = e_im - t_im;
+      data[2 * m] = e_re + t_re; // X[m] = conj(e + t)
+      data[2 * m + 1] = -(e_im + t_im);
+    }
+  }
+
+  // Spectrum in, kSize samples out, scaled by kSize / 2
+  void Inverse(float *data) const {
+    float x0 = data[0], xn = data[kSize];
+    for (size_t k = 1; k <= kHalf / 2; k++) {
+      size_t m = kHalf - k;
+      float xk_re = data[2 * k], xk_im = data[2 * k + 1];
+      float xm_re = data[2 * m], xm_im = -data[2 * m + 1]; // conj(X[m])
+      float e_re = 0.5f * (xk_re + xm_re), e_im = 0.5f * (xk_im + xm_im);
+      // t = i W^k o = 0.5 (conj(X[m]) - X[k]); o = -i conj(W^k) t
+      float t_re = 0.5f * (xm_re - xk_re), t_im = 0.5f * (xm_im - xk_im);
+      float u_re = cos_[k] * t_re - sin_[k] * t_im; // conj(W^k) t
+      float u_im = cos_[k] * t_im + sin_[k] * t_re;
+      float o_re = u_im, o_im = -u_re;
+      data[2 * k] = e_re + o_re; // Z[k] = e + o
+      data[2 * k + 1] = e_im + o_im;
+      data[2 * m] = e_re - o_re; // Z[m] = conj(e - o)
+      data[2 * m + 1] = -(e_im - o_im);
+    }
+    data[0] = 0.5f * (x0 + xn);
+    data[1] = 0.5f * (x0 - xn);
+    Complex(data, true);
+  }
+
+private:
+  static constexpr size_t kHalf = kSize / 2; // Complex points
+
+  float cos_[kHalf], sin_[kHalf]; // e^(-2 pi i k / kSize) = cos - i sin
+  uint16_t bitrev_[kHalf];
+
+  // kHalf-point complex FFT of interleaved data; the inverse is unscaled
+  void Complex(float *data, bool inverse) const {
+    for (size_t i = 0; i < kHalf; i++) {
+      size_t r = bitrev_[i];
+      if (r > i) {
+        float re = data[2 * i], im = data[2 * i + 1];
+        data[2 * i] = data[2 * r];
+        data[2 * i + 1] = data[2 * r + 1];
+        data[2 * r] = re;
+        data[2 * r + 1] = im;
+      }
+    }
+
+    // Stages 1 and 2: radix-4 butterflies, twiddles 1 and -i (+i inverse)
+    float sign = inverse ? -1.0f : 1.0f;
+    for (size_t i = 0; i < kHalf; i += 4) {
+      float *p = data + 2 * i;
+      float t0_re = p[0] + p[2], t0_im = p[1] + p[3];
+      float t1_re = p[0] - p[2], t1_im = p[1] - p[3];
+      float t2_re = p[4] + p[6], t2_im = p[5] + p[7];
+      float t3_re = p[4] - p[6], t3_im = p[5] - p[7];
+      // -i t3 forward, +i t3 inverse
+      float r3_re = sign * t3_im, r3_im = -sign * t3_re;
+      p[0] = t0_re + t2_re;
+      p[1] = t0_im + t2_im;
+      p[4] = t0_re - t2_re;
+      p[5] = t0_im - t2_im;
+      p[2] = t1_re + r3_re;
+      p[3] = t1_im + r3_im;
+      p[6] = t1_re - r3_re;
+      p[7] = t1_im - r3_im;
+    }
+
+    // Remaining radix-2 stages
+    for (size_t len = 8; len <= kHalf; len *= 2) {
+      size_t half = len / 2;
+      size_t step = kSize / len; // Twiddle j is table entry j * step
+      for (size_t i = 0; i < kHalf; i += len) {
+        for (size_t j = 0; j < half; j++) {
+          float w_re = cos_[j * step];
+          float w_im = -sign * sin_[j * step];
+          float *a = data + 2 * (i + j);
+          float *b = a + 2 * half;
+          float b_re = b[0] * w_re - b[1] * w_im;
+          float b_im = b[0] * w_im + b[1] * w_re;
+          b[0] = a[0] - b_re;
+          b[1] = a[1] - b_im;
+          a[0] += b_re;
+          a[1] += b_im;
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include "PlateReverb.h"
+#include "daisy_legio.h"
+#include "daisysp-lgpl.h"
+#include "daisysp.h"
+#include <math.h>
+#include <stddef.h>
+
+#include <atomic>
+
+using namespace daisy;
+using namespace daisysp;
+
+// Reverb engines a mode can ask the service for
+enum class ReverbEngine {
+  kSc,    // ReverbSc: 8 modulated lines, per-sample, the richer tail
+  kPlate, // PlateReverb: Dattorro plate, block kernel, far less arithmetic
+};
+
+// One reverb shared by every mode, owned by the top level.
+//
+// Modes send into it and take its return per sample (it can sit inside a
+// feedback loop, as in Shimmer) or per block, and set their own feedback and
+// LP on activation and from ApplyControls. Each mode picks the engine on
+// activation; only one engine runs at a time, and it is initialised when a
+// mode first asks for it instead of on every activation.
+//
+// Tail handover: the engine is not cleared on a mode switch, so the tail of
+// the previous mode keeps ringing into the next one if both use the same
+// engine. A mode without a reverb (the filter) lets it ring out through
+// Drain() at the level the previous mode returned it. Switching engines
+// drops the tail, silently: the switch has already faded it out.
+//
+// Quality steps (Select) switch engines inside a mode, from the audio
+// callback. The engine switched to must already be silent, as its Init is
+// far too long for a callback: the main loop clears the idle engine after
+// every switch (Service), and Select waits for it. The return of the
+// running engine fades out over kFadeSamples first; the other one starts
+// from silence, with the same feedback and LP.
+class ReverbService {
+public:
+  // Both engines live in SDRAM; each is initialised when it is acquired,
+  // or by Service while it is idle
+  void Init(float sample_rate, ReverbSc *sc, PlateReverb *plate) {
+    fs_ = sample_rate;
+    sc_ = sc;
+    plate_ = plate;
+    engine_ = ReverbEngine::kSc;
+    selected_ = engine_;
+    ready_ = false;
+    ringing_ = false;
+    return_level_ = 0.0f;
+    feedback_ = 0.0f;
+    lp_freq_ = 0.0f;
+    fade_left_ = 0;
+    spare_ready_.store(false, std::memory_order_relaxed);
+  }
+
+  // Called by a mode on activation with its own settings
+  void Acquire(ReverbEngine engine, float feedback, float lp_freq) {
+    if (!ready_ || engine != engine_) {
+      if (engine != engine_) // The other one holds the old tail
+        spare_ready_.store(false, std::memory_order_relaxed);
+      engine_ = engine;
+      InitEngine(engine_);
+      ready_ = true;
+    }
+    selected_ = engine_;
+    fade_left_ = 0;
+    SetFeedback(feedback);
+    SetLpFreq(lp_freq);
+    ringing_ = true;
+  }
+
+  // Drops the tail (re-initialises the engine on the next Acquire)
+  void Clear() {
+    ready_ = false;
+    ringing_ = false;
+  }
+
+  // Audio callback (a mode's SetQuality): the engine for the mode's
+  // quality level, switched to once the main loop has cleared it
+  void Select(ReverbEngine engine) { selected_ = engine; }
+
+  // Main loop, once per pass: clears the idle engine after a switch
+  void Service() {
+    if (spare_ready_.load(std::memory_order_acquire))
+      return;
+    // Only a ready spare lets the callback switch: engine_ holds still
+    InitEngine(Spare());
+    spare_ready_.store(true, std::memory_order_release);
+  }
+
+  // Feedback is the plate's decay
+  void SetFeedback(float feedback) {
+    feedback_ = feedback;
+    if (engine_ == ReverbEngine::kPlate)
+      plate_->SetDecay(feedback);
+    else
+      sc_->SetFeedback(feedback);
+  }
+
+  void SetLpFreq(float freq) {
+    lp_freq_ = freq;
+    if (engine_ == ReverbEngine::kPlate)
+      plate_->SetLpFreq(freq);
+    else
+      sc_->SetLpFreq(freq);
+  }
+
+  // Gain the active mode applies to the return; Drain() uses the last one
+  void SetReturnLevel(float level) { return_level_ = level; }
+
+  // Per sample costs the plate a whole pass of its block kernel: modes that
+  // can should use ProcessBlock, the only one that switches engines
+  inline void Process(float send_l, float send_r, float *ret_l, float *ret_r) {
+    if (engine_ == ReverbEngine::kPlate)
+      plate_->Process(send_l, send_r, ret_l, ret_r);
+    else
+      sc_->Process(send_l, send_r, ret_l, ret_r);
+  }
+
+  void ProcessBlock(const float *send_l, const float *send_r, float *ret_l,
+                    float *ret_r, size_t size) {
+    if (fade_left_ == 0 && selected_ != engine_ &&
+        spare_ready_.load(std::memory_order_acquire))
+      fade_left_ = kFadeSamples;
+
+    if (engine_ == ReverbEngine::kPlate) {
+      plate_->ProcessBlock(send_l, send_r, ret_l, ret_r, size);
+    } else {
+      for (size_t i = 0; i < size; i++)
+        sc_->Process(send_l[i], send_r[i], &ret_l[i], &ret_r[i]);
+    }
+    if (fade_left_ > 0)
+      FadeOut(ret_l, ret_r, size);
+  }
+
+  // Adds the ringing tail (no send) to out; stops once it is inaudible
+  void Drain(float *out_l, float *out_r, size_t size) {
+    if (!ringing_)
+      return;
+    static const float kNoSend[kDrainChunk] = {};
+    float peak = 0.0f;
+    for (size_t offset = 0; offset < size; offset += kDrainChunk) {
+      size_t n = size - offset;
+      if (n > kDrainChunk)
+        n = kDrainChunk;
+      float ret_l[kDrainChunk], ret_r[kDrainChunk];
+      ProcessBlock(kNoSend, kNoSend, ret_l, ret_r, n);
+      for (size_t i = 0; i < n; i++) {
+        ret_l[i] *= return_level_;
+        ret_r[i] *= return_level_;
+        out_l[offset + i] += ret_l[i];
+        out_r[offset + i] += ret_r[i];
+        peak = fmaxf(peak, fmaxf(fabsf(ret_l[i]), fabsf(ret_r[i])));
+      }
+    }
+    if (peak < kSilence)
+      ringing_ = false;
+  }
+
+  bool Ringing() const { return ringing_; }
+
+private:
+  static constexpr float kSilence = 1.0e-4f; // -80 dBFS
+  static constexpr size_t kDrainChunk = PlateReverb::kChunk;
+  static constexpr size_t kFadeSamples = 256; // ~5 ms
+
+  ReverbSc *sc_;
+  PlateReverb *plate_;
+  ReverbEngine engine_;
+  ReverbEngine selected_; // By the callback; engine_ follows after a fade
+  float fs_;
+  float return_level_;
+  float feedback_;
+  float lp_freq_;
+  size_t fade_left_; // Samples of the switch fade still to run
+  bool ready_;
+  bool ringing_;
+  std::atomic<bool> spare_ready_; // The idle engine is silent
+
+  ReverbEngine Spare() const {
+    return engine_ == ReverbEngine::kPlate ? ReverbEngine::kSc
+                                           : ReverbEngine::kPlate;
+  }
+
+  void InitEngine(ReverbEngine engine) {
+    if (engine == ReverbEngine::kPlate)
+      plate_->Init(fs_);
+    else
+      sc_->Init(fs_);
+  }
+
+  // Ramps the return down over the rest of the fade; the samples after its
+  // end are silent, and the next block runs on the other engine
+  void FadeOut(float *ret_l, float *ret_r, size_t size) {
+    constexpr float kStep = 1.0f / kFadeSamples;
+    for (size_t i = 0; i < size; i++) {
+      float gain = fade_left_ > 0 ? (float)--fade_left_ * kStep : 0.0f;
+      ret_l[i] *= gain;
+      ret_r[i] *= gain;
+    }
+    if (fade_left_ > 0)
+      return;
+    engine_ = Spare();
+    SetFeedback(feedback_);
+    SetLpFreq(lp_freq_);
+    spare_ready_.store(false, std::memory_order_release);
+  }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include "daisysp.h"
+#include <math.h>
+#include <stddef.h>
+
+using namespace daisysp;
+
+// Coefficients of the double-sampled Chamberlin SVF used by daisysp::Svf.
+// Computing them is the expensive part (sinf + powf + division), so they are
+// built at control rate and shared by every filter running the same settings.
+struct SvfCoeffs {
+  float freq;  // 2 * sin(pi * fc / (2 * fs))
+  float damp;  // Resonance damping
+  float drive; // Band-pass saturation
+
+  // Same mapping as daisysp::Svf::SetFreq / SetRes / SetDrive
+  static SvfCoeffs Compute(float sample_rate, float cutoff, float res,
+                           float drive) {
+    SvfCoeffs c;
+    float fc = fclamp(cutoff, 1.0e-6f, sample_rate / 3.0f);
+    res = fclamp(res, 0.0f, 1.0f);
+    c.freq = 2.0f * sinf(PI_F * fminf(0.25f, fc / (sample_rate * 2.0f)));
+    c.damp = fminf(2.0f * (1.0f - powf(res, 0.25f)),
+                   fminf(2.0f, 2.0f / c.freq - c.freq * 0.5f));
+    c.drive = fclamp(drive * 0.1f, 0.0f, 1.0f) * res;
+    return c;
+  }
+
+  // Per-sample increment that ramps `from` to `to` over `n` samples
+  static SvfCoeffs Ramp(const SvfCoeffs &from, const SvfCoeffs &to, size_t n) {
+    float inv_n = 1.0f / (float)n;
+    SvfCoeffs s;
+    s.freq = (to.freq - from.freq) * inv_n;
+    s.damp = (to.damp - from.damp) * inv_n;
+    s.drive = (to.drive - from.drive) * inv_n;
+    return s;
+  }
+
+  inline void Advance(const SvfCoeffs &step) {
+    freq += step.freq;
+    damp += step.damp;
+    drive += step.drive;
+  }
+};
+
+// State-only SVF: same response as daisysp::Svf, but coefficients are passed
+// in per call so they can be computed once per block and ramped across it.
+class SvfCore {
+public:
+  void Init() {
+    low_ = band_ = 0.0f;
+    out_low_ = out_band_ = out_high_ = 0.0f;
+  }
+
+  inline void Process(float in, float freq, float damp, float drive) {
+    // First pass
+    float notch = in - damp * band_;
+    low_ = low_ + freq * band_;
+    float high = notch - low_;
+    band_ = freq * high + band_ - drive * band_ * band_ * band_;
+    out_low_ = 0.5f * low_;
+    out_high_ = 0.5f * high;
+    out_band_ = 0.5f * band_;
+
+    // Second pass (average of both passes)
+    notch = in - damp * band_;
+    low_ = low_ + freq * band_;
+    high = notch - low_;
+    band_ = freq * high + band_ - drive * band_ * band_ * band_;
+    out_low_ += 0.5f * low_;
+    out_high_ += 0.5f * high;
+    out_band_ += 0.5f * band_;
+  }
+
+  inline void Process(float in, const SvfCoeffs &c) {
+    Process(in, c.freq, c.damp, c.drive);
+  }
+
+  inline float Low() const { return out_low_; }
+  inline float Band() const { return out_band_; }
+  inline float High() const { return out_high_; }
+
+private:
+  float low_, band_;
+  float out_low_, out_band_, out_high_;
+};
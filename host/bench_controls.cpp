@@ -0,0 +1,216 @@
+// Control path: curve tables, panel conditioning and cost per block
+//
+// The exponential knob curves of ControlCurves.h are checked against
+// pow() in double and timed against the powf() they replace. The knob
+// hysteresis must hold a reading under ADC-like jitter and still reach both
+// ends of a slow sweep, and the switch debounce must pass one change per
+// bouncing transition. Then every mode runs the main loop's control pass
+// (MapControls when the frame moved) and the callback's ApplyControls once
+// per pass, for a still panel, a jittering knob read raw and through the
+// hysteresis, and a knob being turned: the cost of controls per audio
+// block, and how often the targets were remapped.
+#include "../ControlCurves.h"
+#include "../ControlSnapshot.h"
+#include "../MemoryBudget.h"
+#include "../ModeConvolution.h"
+#include "../ModeFilterDrive.h"
+#include "../ModeShepardTone.h"
+#include "../ModeShimmerReverb.h"
+#include "../ModeSpaceEcho.h"
+#include "../ReverbService.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = memory_budget::kNominalSampleRate;
+constexpr double kCurveBound = 2.0e-4; // Relative
+constexpr float kJitter = 4.0f / 4096.0f; // +/-4 LSB at 12 bits
+constexpr int kPasses = 100000;           // One per audio block
+constexpr int kSweepPasses = 2000;        // A full turn in 2 s at 1 kHz
+constexpr int kLookups = 1000000;
+
+int failures = 0;
+
+float Noise() { return (float)rand() / RAND_MAX - 0.5f; }
+
+ReverbSc reverb_sc;
+PlateReverb reverb_plate;
+ReverbService reverb;
+ModeFilterDrive mode_filter;
+ModeSpaceEcho mode_echo;
+ModeShimmerReverb mode_shimmer;
+ModeShepardTone mode_shepard;
+ModeConvolution mode_convolution;
+
+// Table vs the curve in double, and ns per lookup vs powf
+template <typename Range>
+void CurveRow(const char *name, const control_curves::CurveTable &table) {
+  double worst = 0.0;
+  for (int i = 0; i <= 100000; i++) {
+    double x = i / 100000.0;
+    double ref = Range::kLo * pow(Range::kHi / Range::kLo, x);
+    worst = fmax(worst, fabs(table.Cubic((float)x) / ref - 1.0));
+  }
+  bool ok = worst <= kCurveBound;
+  failures += !ok;
+
+  float lo = (float)Range::kLo, ratio = (float)(Range::kHi / Range::kLo);
+  float sink = 0.0f;
+  uint64_t t0 = NowNs();
+  for (int i = 0; i < kLookups; i++)
+    sink += table.Cubic((float)(i & 1023) * (1.0f / 1023.0f));
+  double table_ns = (double)(NowNs() - t0) / kLookups;
+  t0 = NowNs();
+  for (int i = 0; i < kLookups; i++)
+    sink += lo * powf(ratio, (float)(i & 1023) * (1.0f / 1023.0f));
+  double pow_ns = (double)(NowNs() - t0) / kLookups;
+  DoNotOptimize(sink);
+  printf("%-16s %10.2e %9.2f %9.2f  %s\n", name, worst, table_ns, pow_ns,
+         ok ? "ok" : "FAIL");
+}
+
+void CheckPanelConditioning() {
+  // Jitter around a still knob: held after the first reading
+  KnobHysteresis knob;
+  float first = knob.Process(0.5f);
+  int changes = 0;
+  for (int i = 0; i < kPasses; i++)
+    changes += knob.Process(0.5f + 2.0f * Noise() * kJitter) != first;
+
+  // A slow sweep with jitter reaches both ends and tracks within the band
+  knob.Reset();
+  float lag = 0.0f;
+  bool top = false, bottom = false;
+  for (int i = 0; i <= 2 * kSweepPasses; i++) {
+    float ramp = i <= kSweepPasses ? (float)i / kSweepPasses
+                                   : 2.0f - (float)i / kSweepPasses;
+    float raw = fminf(fmaxf(ramp + 2.0f * Noise() * kJitter, 0.0f), 1.0f);
+    float held = knob.Process(raw);
+    lag = fmaxf(lag, fabsf(held - raw));
+    top |= held == 1.0f;
+    bottom |= i > kSweepPasses && held == 0.0f;
+  }
+  bool knob_ok = changes == 0 && top && bottom &&
+                 lag <= KnobHysteresis::kHysteresis + 2.0f * kJitter;
+  failures += !knob_ok;
+  printf("knob hysteresis: %d changes under +/-%.0f LSB jitter, sweep reaches "
+         "0 %s 1 %s, max lag %.4f  %s\n",
+         changes, kJitter * 4096.0f, bottom ? "yes" : "no",
+         top ? "yes" : "no", lag, knob_ok ? "ok" : "FAIL");
+
+  // A 1 -> 2 transition bouncing for a few reads
+  static const int kReads[] = {1, 1, 2, 1, 2, 1, 2, 2, 2, 2};
+  SwitchDebounce sw;
+  int held = -1, transitions = 0;
+  for (int raw : kReads) {
+    int h = sw.Process(raw);
+    transitions += held >= 0 && h != held;
+    held = h;
+  }
+  bool sw_ok = transitions == 1 && held == 2;
+  failures += !sw_ok;
+  printf("switch debounce: %d transition(s) for a bouncing 1 -> 2, ends at "
+         "%d  %s\n",
+         transitions, held, sw_ok ? "ok" : "FAIL");
+}
+
+enum Panel { kStill, kJitterRaw, kJitterHeld, kTurning };
+
+// The main loop's pass and the callback's ApplyControls, `kPasses` times:
+// ns per pass, and the share of passes that remapped
+template <typename Mode>
+double ControlPass(Mode &mode, Panel panel, double *remapped) {
+  std::vector<float> raw(kPasses);
+  for (int i = 0; i < kPasses; i++) {
+    float turn = (float)(i % (2 * kSweepPasses)) / kSweepPasses;
+    raw[i] = panel == kStill     ? 0.5f
+             : panel == kTurning ? (turn <= 1.0f ? turn : 2.0f - turn)
+                                 : 0.5f + 2.0f * Noise() * kJitter;
+  }
+  typename Mode::Controls c;
+  KnobHysteresis knob;
+  ControlFrame frame, published;
+  frame.sw_left = frame.sw_right = 1;
+  int maps = 0;
+  uint64_t t0 = NowNs();
+  for (int i = 0; i < kPasses; i++) {
+    float k = panel == kJitterRaw ? raw[i] : knob.Process(raw[i]);
+    frame.knob_top = k;
+    frame.knob_bottom = k;
+    if (i == 0 || !frame.SamePanel(published)) {
+      mode.MapControls(frame, c);
+      published = frame;
+      maps++;
+    }
+    mode.ApplyControls(c);
+  }
+  double ns = (double)(NowNs() - t0) / kPasses;
+  *remapped = 100.0 * maps / kPasses;
+  return ns;
+}
+
+template <typename Mode> void ModeRow(const char *name, Mode &mode) {
+  double ns[4], remapped[4];
+  for (int p = kStill; p <= kTurning; p++)
+    ns[p] = ControlPass(mode, (Panel)p, &remapped[p]);
+  printf("%-12s %8.1f %8.1f %8.1f %8.1f %10.1f%% %7.1f%%\n", name, ns[0],
+         ns[1], ns[2], ns[3], remapped[kJitterRaw], remapped[kJitterHeld]);
+}
+
+} // namespace
+
+int BenchControls() {
+  failures = 0;
+  srand(1);
+  using namespace control_curves;
+  printf("%-16s %10s %9s %9s\n", "curve", "max error", "table ns",
+         "powf ns");
+  CurveRow<FilterCutoff>("filter cutoff", kFilterCutoffTable);
+  CurveRow<EchoLongTime>("echo long time", kEchoLongTimeTable);
+  CurveRow<ShepardSpeed>("shepard speed", kShepardSpeedTable);
+  CurveRow<ConvolutionTone>("convolution tone", kConvolutionToneTable);
+  printf("bound: relative error <= %.0e\n\n", kCurveBound);
+
+  CheckPanelConditioning();
+
+  // Each mode initialised as on activation, with its own zeroed arena
+  reverb.Init(kSampleRate, &reverb_sc, &reverb_plate);
+  size_t arena_bytes =
+      std::max({ModeSpaceEcho::ArenaBytes(kSampleRate),
+                ModeShimmerReverb::ArenaBytes(kSampleRate),
+                ModeConvolution::ArenaBytes(kSampleRate)});
+  std::vector<char> pool;
+  MemoryArena arena;
+  auto fresh_arena = [&]() -> MemoryArena & {
+    pool.assign(arena_bytes + MemoryArena::kAlignment, 0);
+    arena.Init(pool.data(), pool.size());
+    return arena;
+  };
+
+  printf("\ncontrol pass per audio block, ns (both knobs, switches Mid)\n");
+  printf("%-12s %8s %8s %8s %8s %11s %8s\n", "mode", "still", "jitter",
+         "jitter", "turning", "remapped", "");
+  printf("%-12s %8s %8s %8s %8s %11s %8s\n", "", "", "raw", "held", "", "raw",
+         "held");
+  mode_filter.Init(kSampleRate);
+  ModeRow("filter", mode_filter);
+  if (mode_echo.Init(kSampleRate, fresh_arena(), reverb))
+    ModeRow("echo", mode_echo);
+  if (mode_shimmer.Init(kSampleRate, fresh_arena(), reverb))
+    ModeRow("shimmer", mode_shimmer);
+  mode_shepard.Init(kSampleRate, reverb);
+  ModeRow("shepard", mode_shepard);
+  if (mode_convolution.Init(kSampleRate, fresh_arena()))
+    ModeRow("convolution", mode_convolution);
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
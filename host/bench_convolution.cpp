@@ -0,0 +1,166 @@
+// Partitioned convolution: accuracy and cost against the partition count
+//
+// PartitionedConvolver is checked against a direct convolution in double,
+// fed in blocks of varying size so the spread partition sums and the block
+// edges are exercised, including an IR swap. Then the mode's convolver
+// (ModeConvolution::Convolver) runs with 1 to 256 partitions in 48-sample
+// callbacks; each row reports the mean cost per sample, the mean and the
+// 99th percentile callback as a share of its deadline at 48 kHz (one
+// callback in 21 carries the block edge's FFTs, so the p99 is that cost
+// without the host's scheduling spikes), and the SDRAM traffic of streaming
+// the FDL and both IR spectra once per block.
+#include "../ModeConvolution.h"
+#include "../PartitionedConvolver.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = 48000.0f;
+constexpr size_t kCallback = 48;
+constexpr double kErrorBound = 1.0e-5; // Of the reference's peak
+constexpr int kTimingBlocks = 4000;    // 4 s of callbacks per row
+
+int failures = 0;
+
+float Noise() { return (float)rand() / RAND_MAX - 0.5f; }
+
+// Convolver output vs a direct convolution of the same input (double),
+// delayed by the latency, with the IR pair swapped mid-block
+template <int kLog2Block>
+void CheckAccuracy(const char *name, size_t ir_length, size_t samples) {
+  using Convolver = PartitionedConvolver<kLog2Block>;
+  size_t partitions = Convolver::Partitions(ir_length);
+  static Convolver conv;
+  std::vector<float> fdl(Convolver::SpectraFloats(partitions));
+  std::vector<float> spectra[4];
+  std::vector<float> ir[4];
+  conv.Init(fdl.data(), partitions);
+  for (int c = 0; c < 4; c++) {
+    ir[c].resize(ir_length);
+    for (float &v : ir[c])
+      v = Noise();
+    spectra[c].resize(Convolver::SpectraFloats(partitions));
+    conv.PrepareIr(ir[c].data(), ir_length, spectra[c].data());
+  }
+  conv.SetIr(spectra[0].data(), spectra[1].data(), partitions);
+
+  std::vector<float> x(samples), out_l(samples), out_r(samples);
+  for (float &v : x)
+    v = Noise();
+  size_t swap = samples / 2 + 123; // Mid-block
+  size_t at = 0;
+  while (at < samples) {
+    size_t n = 1 + (size_t)rand() % 200;
+    if (at < swap && at + n > swap)
+      n = swap - at;
+    if (n > samples - at)
+      n = samples - at;
+    if (at == swap)
+      conv.SetIr(spectra[2].data(), spectra[3].data(), partitions);
+    conv.ProcessBlock(&x[at], &out_l[at], &out_r[at], n);
+    at += n;
+  }
+
+  // Output sample t is input t - latency through the IR in use when the
+  // block holding that input completed: the second pair from the first
+  // block edge after the swap on
+  size_t latency = Convolver::kBlock;
+  size_t first_new = (swap / latency + 1) * latency;
+  double worst = 0.0, peak = 0.0;
+  for (size_t t = latency; t < samples; t++) {
+    int pair = t >= first_new ? 2 : 0;
+    size_t u = t - latency;
+    for (int c = 0; c < 2; c++) {
+      const std::vector<float> &h = ir[pair + c];
+      double ref = 0.0;
+      for (size_t k = 0; k < ir_length && k <= u; k++)
+        ref += (double)h[k] * x[u - k];
+      double got = c == 0 ? out_l[t] : out_r[t];
+      worst = fmax(worst, fabs(got - ref));
+      peak = fmax(peak, fabs(ref));
+    }
+  }
+  bool ok = worst <= kErrorBound * peak;
+  failures += !ok;
+  printf("%-26s %3zu partitions: max error %.2e of peak %.1f (<= %.0e) "
+         "%s\n",
+         name, partitions, worst, peak, kErrorBound, ok ? "ok" : "FAIL");
+}
+
+void CostRow(size_t partitions) {
+  using Convolver = ModeConvolution::Convolver;
+  static Convolver conv;
+  std::vector<float> fdl(Convolver::SpectraFloats(partitions));
+  std::vector<float> ir_l(Convolver::SpectraFloats(partitions));
+  std::vector<float> ir_r(Convolver::SpectraFloats(partitions));
+  std::vector<float> ir(partitions * Convolver::kBlock);
+  for (float &v : ir)
+    v = Noise() * 0.01f;
+  conv.Init(fdl.data(), partitions);
+  conv.PrepareIr(ir.data(), ir.size(), ir_l.data());
+  conv.PrepareIr(ir.data(), ir.size(), ir_r.data());
+  conv.SetIr(ir_l.data(), ir_r.data(), partitions);
+
+  constexpr size_t kNoise = 1 << 14;
+  std::vector<float> in(kNoise + kCallback);
+  for (float &v : in)
+    v = Noise();
+  float out_l[kCallback], out_r[kCallback];
+  std::vector<double> times(kTimingBlocks);
+  double total = 0.0;
+  for (int b = 0; b < kTimingBlocks; b++) {
+    uint64_t t0 = NowNs();
+    conv.ProcessBlock(&in[(b * kCallback) % kNoise], out_l, out_r,
+                      kCallback);
+    times[b] = (double)(NowNs() - t0);
+    DoNotOptimize(out_l[0]);
+    total += times[b];
+  }
+  std::sort(times.begin(), times.end());
+  double p99 = times[kTimingBlocks * 99 / 100];
+  double deadline = 1.0e9 * kCallback / kSampleRate;
+  double per_sample = total / ((double)kTimingBlocks * kCallback);
+  double traffic = 3.0 * Convolver::SpectraFloats(partitions) *
+                   sizeof(float) / Convolver::kBlock * kSampleRate;
+  printf("%10zu %8.2f s %10.1f %8.2f%% %9.2f%% %10.1f\n", partitions,
+         (double)partitions * Convolver::kBlock / kSampleRate, per_sample,
+         100.0 * total / kTimingBlocks / deadline, 100.0 * p99 / deadline,
+         traffic * 1.0e-6);
+}
+
+} // namespace
+
+int BenchConvolution() {
+  failures = 0;
+  srand(1);
+  printf("Accuracy vs direct convolution, blocks of 1..200 samples, IR "
+         "swap mid-stream\n");
+  CheckAccuracy<6>("64-sample partitions", 1000, 6000);
+  CheckAccuracy<ModeConvolution::Convolver::kLog2Block>("mode partitions",
+                                                       3000, 12000);
+
+  printf("\nCost of the mode's convolver (%zu-sample partitions, latency "
+         "%.1f ms) in %zu-sample callbacks at %.0f Hz\n",
+         ModeConvolution::Convolver::kBlock,
+         1000.0 * ModeConvolution::Convolver::kBlock / kSampleRate,
+         kCallback, kSampleRate);
+  printf("%10s %10s %10s %9s %10s %10s\n", "partitions", "IR",
+         "ns/sample", "load avg", "load p99", "SDRAM MB/s");
+  for (size_t p = 1; p <= 256; p *= 2)
+    CostRow(p);
+  printf("mode IRs at %.0f Hz: room %zu, spring %zu, plate %zu partitions\n",
+         kSampleRate, ModeConvolution::IrPartitions(0, kSampleRate),
+         ModeConvolution::IrPartitions(1, kSampleRate),
+         ModeConvolution::IrPartitions(2, kSampleRate));
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
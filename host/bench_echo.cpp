@@ -0,0 +1,152 @@
+// Multi-head tape echo: shared Hermite setup vs one read per head
+//
+// ModeSpaceEcho reads up to four heads from one tape loop per channel. The
+// heads sit whole samples apart, so the fraction's Hermite weights are
+// computed once per sample and each head is four loads and a dot product
+// (DelayBuffer::HermiteSetup + Interpolate). The split read is checked
+// against the Hermite polynomial in double, then timed for 1 to 4 heads on
+// a loop of the mode's length with the heads 0.3 s apart, as in the Med
+// combination: a full ReadHermite per head and the split read on a float
+// DelayBuffer, and the mode's own ReadHeads on its block-coded tape loop
+// (one span decode per head and chunk). The last column is the cost each
+// head adds to the mode's read.
+#include "../DelayBuffer.h"
+#include "../ModeSpaceEcho.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = 48000.0f;
+constexpr size_t kChunk = 64;
+constexpr int kMaxHeads = 4;
+constexpr float kSpacing = 0.3f * kSampleRate;
+constexpr double kErrorBound = 1.0e-6; // Signal in [-0.5, 0.5]
+constexpr int kTimingChunks = 20000;
+
+int failures = 0;
+
+float Noise() { return (float)rand() / RAND_MAX - 0.5f; }
+
+float wobble[kChunk]; // Flutter stand-in, a few samples
+
+// Mode-like read pass over a chunk: a fractional time wobbling a few
+// samples, `heads` heads summed. `shared` selects the split read.
+template <bool shared>
+float ReadChunk(const DelayBuffer &del, float base, int heads, float *out) {
+  size_t spacing = (size_t)kSpacing;
+  for (size_t i = 0; i < kChunk; i++) {
+    float read_time = base + wobble[i] - (float)i;
+    float sum = 0.0f;
+    if (shared) {
+      DelayBuffer::HermiteTap tap = DelayBuffer::HermiteSetup(read_time);
+      for (int h = 0; h < heads; h++)
+        sum += del.ReadHermite(tap, (size_t)h * spacing);
+    } else {
+      for (int h = 0; h < heads; h++)
+        sum += del.ReadHermite(read_time + (float)h * kSpacing);
+    }
+    out[i] = sum;
+  }
+  return out[kChunk - 1];
+}
+
+// The mode's read over the same chunk
+float ReadChunkTape(const ModeSpaceEcho::TapeLoop &loop, float base, int heads,
+                    float *out) {
+  DelayBuffer::HermiteTap tap[kChunk];
+  for (size_t i = 0; i < kChunk; i++)
+    tap[i] = DelayBuffer::HermiteSetup(base + wobble[i] - (float)i);
+  size_t extra[kMaxHeads];
+  float gain[kMaxHeads];
+  for (int h = 0; h < heads; h++) {
+    extra[h] = (size_t)h * (size_t)kSpacing;
+    gain[h] = 1.0f;
+  }
+  ModeSpaceEcho::ReadHeads(loop, tap, kChunk, extra, gain, heads, out);
+  return out[kChunk - 1];
+}
+
+} // namespace
+
+int BenchEcho() {
+  failures = 0;
+  srand(1);
+  for (size_t i = 0; i < kChunk; i++)
+    wobble[i] = 3.0f * sinf(0.1f * (float)i);
+  size_t length = ModeSpaceEcho::DelayLength(kSampleRate);
+  std::vector<float> buf(DelayBuffer::BufferSize(length, kChunk));
+  DelayBuffer del;
+  del.Init(buf.data(), length, kChunk);
+  std::vector<ModeSpaceEcho::TapeLoop::Block> tape_buf(
+      ModeSpaceEcho::TapeLoop::BufferBlocks(length));
+  ModeSpaceEcho::TapeLoop tape;
+  tape.Init(tape_buf.data(), length);
+  float block[kChunk];
+  for (size_t at = 0; at < length; at += kChunk) {
+    for (float &v : block)
+      v = Noise();
+    del.WriteBlock(block, kChunk);
+    tape.WriteBlock(block, kChunk);
+  }
+
+  // Split read vs the Hermite polynomial in double at random fractions and
+  // head distances (ReadHermite(float) would round the fraction away at
+  // long delays)
+  double worst = 0.0;
+  for (int t = 0; t < 100000; t++) {
+    float delay = 10.0f + (float)rand() / RAND_MAX * 48000.0f;
+    size_t extra = (size_t)rand() % (length / 2);
+    DelayBuffer::HermiteTap tap = DelayBuffer::HermiteSetup(delay);
+    size_t d = tap.delay + extra;
+    double f = (double)delay - tap.delay;
+    double xm1 = del.Read(d - 1), x0 = del.Read(d), x1 = del.Read(d + 1),
+           x2 = del.Read(d + 2);
+    double c = (x1 - xm1) * 0.5;
+    double v = x0 - x1;
+    double w = c + v;
+    double a = w + v + (x2 - x0) * 0.5;
+    double ref = (((a * f) - (w + a)) * f + c) * f + x0;
+    worst = fmax(worst, fabs((double)del.ReadHermite(tap, extra) - ref));
+  }
+  bool ok = worst <= kErrorBound;
+  failures += !ok;
+  printf("shared-setup read vs Hermite in double: max error %.2e (<= %.0e) "
+         "%s\n\n",
+         worst, kErrorBound, ok ? "ok" : "FAIL");
+
+  printf("Read pass, one channel, %zu-sample chunks over a %.1f s loop, heads "
+         "%.1f s apart\n",
+         kChunk, (double)length / kSampleRate, kSpacing / kSampleRate);
+  printf("ns per sample\n%6s %10s %10s %10s %12s\n", "heads", "per head",
+         "shared", "tape loop", "extra head");
+  double first = 0.0;
+  for (int heads = 1; heads <= kMaxHeads; heads++) {
+    double ns[3];
+    for (int s = 0; s < 3; s++) {
+      float sink = 0.0f;
+      uint64_t t0 = NowNs();
+      for (int c = 0; c < kTimingChunks; c++) {
+        float base = 4800.0f + (float)(c % 1000) * 3.7f;
+        sink += s == 2   ? ReadChunkTape(tape, base, heads, block)
+                : s == 1 ? ReadChunk<true>(del, base, heads, block)
+                         : ReadChunk<false>(del, base, heads, block);
+      }
+      ns[s] = (double)(NowNs() - t0) / ((double)kTimingChunks * kChunk);
+      DoNotOptimize(sink);
+    }
+    if (heads == 1)
+      first = ns[2];
+    printf("%6d %10.2f %10.2f %10.2f %12.2f\n", heads, ns[0], ns[1], ns[2],
+           heads > 1 ? (ns[2] - first) / (heads - 1) : 0.0);
+  }
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
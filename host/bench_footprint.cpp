@@ -0,0 +1,38 @@
+// Memory footprint per mode and region (MemoryBudget.h)
+//
+// Prints the resident DTCM state and the SDRAM arena share of each mode, and
+// checks them against the region budgets. Sizes are the host's; the firmware
+// build enforces the same budgets for the ARM layout with static_assert.
+#include "../MemoryBudget.h"
+#include "benchmarks.h"
+
+#include <stdio.h>
+
+namespace {
+
+void PrintRow(const memory_budget::Footprint &f) {
+  printf("%-11s %9zu %12zu %12zu\n", f.name, f.dtcm, f.sdram, f.sdram_max);
+}
+
+} // namespace
+
+int BenchFootprint() {
+  using namespace memory_budget;
+  printf("bytes       %9s %12s %12s\n", "DTCM", "SDRAM@48k", "SDRAM@96k");
+  for (const Footprint &f : kFootprints)
+    PrintRow(f);
+
+  bool dtcm_ok = DtcmTotal() <= kDtcmBytes;
+  bool sdram_ok = SdramPeak() <= kSdramArenaBytes;
+  bool pair_ok = SdramPairPeak() <= kSdramArenaBytes;
+  printf("DTCM  resident total %9zu of %9zu %s\n", DtcmTotal(), kDtcmBytes,
+         dtcm_ok ? "ok" : "FAIL");
+  printf("SDRAM shared reverbs %9zu (resident, outside the arena: "
+         "ReverbSc %zu, plate %zu)\n",
+         kReverbEngineBytes, kReverbScBytes, kPlateBytes);
+  printf("SDRAM active peak    %9zu of %9zu %s\n", SdramPeak(),
+         kSdramArenaBytes, sdram_ok ? "ok" : "FAIL");
+  printf("SDRAM two-mode peak  %9zu of %9zu %s\n", SdramPairPeak(),
+         kSdramArenaBytes, pair_ok ? "ok" : "FAIL");
+  return dtcm_ok && sdram_ok && pair_ok ? 0 : 1;
+}
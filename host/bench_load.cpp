@@ -0,0 +1,132 @@
+// Block load histogram: percentile accuracy and cost, and one known spike
+//
+// BlockLoadHistogram percentiles are compared with the exact ones of a
+// sorted copy for a few load distributions shaped like callback timings
+// (steady, jittery, rare long blocks): each must be at or above the exact
+// value and within one bin (1/16 of the octave's start). Misses and the
+// maximum must be exact. Then the cost of Record, and what the filter's NaN
+// recovery (ResetState inside a block) adds to a block, as loads.
+#include "../BlockLoad.h"
+#include "../MemoryBudget.h"
+#include "../ModeFilterDrive.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = memory_budget::kNominalSampleRate;
+constexpr int kBlocks = 100000;
+constexpr size_t kBlockSize = 48;
+constexpr double kBinRatio = 1.0625 + 1e-6; // Widest bin: 1/16 of 2^k
+constexpr int kRecords = 10000000;
+constexpr int kRecoveryRuns = 200;
+
+int failures = 0;
+
+float Uniform() { return (float)rand() / RAND_MAX; }
+
+ModeFilterDrive mode_filter;
+
+// Histogram vs exact percentiles of `loads`
+void DistributionRow(const char *name, const std::vector<float> &loads) {
+  BlockLoadHistogram h;
+  for (float l : loads)
+    h.Record(l);
+  std::vector<float> sorted(loads);
+  std::sort(sorted.begin(), sorted.end());
+  uint32_t misses = 0;
+  for (float l : loads)
+    misses += l > 1.0f;
+
+  static const float kQuantiles[] = {0.5f, 0.99f, 0.999f};
+  bool ok = h.Misses() == misses && h.Max() == sorted.back() &&
+            h.Blocks() == loads.size();
+  printf("%-10s", name);
+  for (float q : kQuantiles) {
+    size_t rank = (size_t)(q * loads.size() + 0.5f);
+    float exact = sorted[std::max<size_t>(rank, 1) - 1];
+    float binned = h.Percentile(q);
+    ok &= binned >= exact && binned <= exact * kBinRatio;
+    printf(" %8.3f %8.3f", 100.0f * exact, 100.0f * binned);
+  }
+  printf(" %8.2f %7u  %s\n", 100.0f * h.Max(), h.Misses(),
+         ok ? "ok" : "FAIL");
+  failures += !ok;
+}
+
+void CheckPercentiles() {
+  printf("%-10s %17s %17s %17s %8s %7s\n", "loads (%)", "p50", "p99",
+         "p99.9", "", "");
+  printf("%-10s %8s %8s %8s %8s %8s %8s %8s %7s\n", "", "exact", "binned",
+         "exact", "binned", "exact", "binned", "max", "misses");
+  std::vector<float> loads(kBlocks);
+  for (float &l : loads)
+    l = 0.42f + 0.01f * Uniform();
+  DistributionRow("steady", loads);
+  for (float &l : loads)
+    l = 0.3f * expf(0.6f * (Uniform() - 0.5f) * 4.0f);
+  DistributionRow("jittery", loads);
+  for (int i = 0; i < kBlocks; i++) // Rare blocks at 2-6 deadlines
+    loads[i] =
+        i % 997 == 0 ? 2.0f + 4.0f * Uniform() : 0.2f + 0.1f * Uniform();
+  DistributionRow("spikes", loads);
+  printf("bound: binned within [exact, exact * 17/16]; misses, max exact\n");
+}
+
+void TimeRecord() {
+  BlockLoadHistogram h;
+  std::vector<float> loads(1024);
+  for (float &l : loads)
+    l = 0.1f + Uniform();
+  uint64_t t0 = NowNs();
+  for (int i = 0; i < kRecords; i++)
+    h.Record(loads[i & 1023]);
+  double ns = (double)(NowNs() - t0) / kRecords;
+  DoNotOptimize(h);
+  printf("\nRecord: %.2f ns per block\n", ns);
+}
+
+// A normal filter block vs the ResetState its NaN recovery runs inside the
+// block, as host loads of a kBlockSize-sample deadline
+void TimeNanRecovery() {
+  float in_l[kBlockSize], in_r[kBlockSize];
+  float out_l[kBlockSize], out_r[kBlockSize];
+  for (size_t i = 0; i < kBlockSize; i++)
+    in_l[i] = in_r[i] = 0.5f * sinf(0.05f * i);
+  double deadline_ns = 1e9 * kBlockSize / kSampleRate;
+
+  mode_filter.Init(kSampleRate);
+  uint64_t block_ns = ~0ull, reset_ns = ~0ull;
+  for (int run = 0; run < kRecoveryRuns; run++) {
+    uint64_t t0 = NowNs();
+    mode_filter.ProcessBlock(in_l, in_r, out_l, out_r, kBlockSize);
+    block_ns = std::min(block_ns, NowNs() - t0);
+
+    t0 = NowNs();
+    mode_filter.ResetState();
+    reset_ns = std::min(reset_ns, NowNs() - t0);
+  }
+  printf("filter block (%zu samples): %.2f%% of the deadline, NaN recovery "
+         "adds %.2f%% (host, best of %d)\n",
+         kBlockSize, 100.0 * block_ns / deadline_ns,
+         100.0 * reset_ns / deadline_ns, kRecoveryRuns);
+}
+
+} // namespace
+
+int BenchLoad() {
+  failures = 0;
+  srand(1);
+  CheckPercentiles();
+  TimeRecord();
+  TimeNanRecovery();
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
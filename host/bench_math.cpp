@@ -0,0 +1,137 @@
+// FastMath.h accuracy and speed check
+//
+// Sweeps every approximation over its working range against a double
+// precision libm reference, compares the worst error with the bound
+// documented in FastMath.h, and times each tier against the float libm call.
+// Host glibc has vectorised expf/sinf, so speedups here understate the gain
+// over newlib on the Cortex-M7; the error figures carry over unchanged.
+#include "../FastMath.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+using fastmath::Tier;
+
+constexpr int kErrorPoints = 400000;
+constexpr int kTimingPoints = 4096;
+constexpr int kTimingRepeats = 512;
+
+template <typename F, typename R>
+double MaxError(F approx, R ref, float lo, float hi, bool relative) {
+  double worst = 0.0;
+  for (int i = 0; i < kErrorPoints; i++) {
+    float x = lo + (hi - lo) * (float)i / (float)(kErrorPoints - 1);
+    double r = ref((double)x);
+    double e = fabs((double)approx(x) - r);
+    if (relative) {
+      if (fabs(r) < 1e-30)
+        continue;
+      e /= fabs(r);
+    }
+    if (e > worst)
+      worst = e;
+  }
+  return worst;
+}
+
+template <typename F> double NsPerCall(F fn, float lo, float hi) {
+  std::vector<float> xs(kTimingPoints);
+  for (int i = 0; i < kTimingPoints; i++)
+    xs[i] = lo + (hi - lo) * (float)((i * 2654435761u) % kTimingPoints) /
+                     (float)kTimingPoints;
+  float acc = 0.0f;
+  uint64_t t0 = NowNs();
+  for (int r = 0; r < kTimingRepeats; r++) {
+    for (float x : xs)
+      acc += fn(x);
+    DoNotOptimize(acc);
+  }
+  return (double)(NowNs() - t0) / ((double)kTimingPoints * kTimingRepeats);
+}
+
+struct Bound {
+  double accurate;
+  double fast;
+};
+
+int failures = 0;
+
+// Checks both approximate tiers of one function; `fn` is a generic lambda
+// taking a tier tag so every tier is instantiated with full inlining
+template <typename Fn, typename R>
+void Check(const char *name, Fn fn, R ref, float lo, float hi, bool relative,
+           Bound bound) {
+  auto libm = [&](float x) {
+    return fn(std::integral_constant<Tier, Tier::kLibm>(), x);
+  };
+  auto accurate = [&](float x) {
+    return fn(std::integral_constant<Tier, Tier::kAccurate>(), x);
+  };
+  auto fast = [&](float x) {
+    return fn(std::integral_constant<Tier, Tier::kFast>(), x);
+  };
+
+  double ns_libm = NsPerCall(libm, lo, hi);
+  double err_acc = MaxError(accurate, ref, lo, hi, relative);
+  double err_fast = MaxError(fast, ref, lo, hi, relative);
+  double ns_acc = NsPerCall(accurate, lo, hi);
+  double ns_fast = NsPerCall(fast, lo, hi);
+
+  bool ok_acc = err_acc <= bound.accurate;
+  bool ok_fast = err_fast <= bound.fast;
+  failures += !ok_acc + !ok_fast;
+
+  printf("%-9s %s  libm %5.2f ns | accurate %9.2e (<= %.1e) %s %5.2f ns "
+         "x%4.1f | fast %9.2e (<= %.1e) %s %5.2f ns x%4.1f\n",
+         name, relative ? "rel" : "abs", ns_libm, err_acc, bound.accurate,
+         ok_acc ? "ok  " : "FAIL", ns_acc, ns_libm / ns_acc, err_fast,
+         bound.fast, ok_fast ? "ok  " : "FAIL", ns_fast, ns_libm / ns_fast);
+}
+
+} // namespace
+
+#define TIERED(expr)                                                           \
+  [](auto tier, float x) {                                                     \
+    constexpr Tier T = decltype(tier)::value;                                  \
+    return expr;                                                               \
+  }
+
+int BenchMath() {
+  failures = 0;
+  printf("FastMath.h: max error vs double libm, cost per call (speedup vs "
+         "float libm)\n");
+
+  Check("Exp2", TIERED(fastmath::Exp2<T>(x)), [](double x) { return exp2(x); },
+        -20.0f, 20.0f, true, {2.0e-7, 8.0e-5});
+  Check("Exp", TIERED(fastmath::Exp<T>(x)), [](double x) { return exp(x); },
+        -10.0f, 10.0f, true, {6.0e-7, 8.0e-5});
+  Check("Log2", TIERED(fastmath::Log2<T>(x)), [](double x) { return log2(x); },
+        1.0e-4f, 1.0e4f, false, {6.0e-7, 1.0e-4});
+  Check("Pow100", TIERED(fastmath::Pow<T>(100.0f, x)),
+        [](double x) { return pow(100.0, x); }, 0.0f, 1.0f, true,
+        {1.0e-6, 5.0e-4});
+  Check("SinTurns", TIERED(fastmath::SinTurns<T>(x)),
+        [](double x) { return sin(2.0 * M_PI * x); }, -4.0f, 4.0f, false,
+        {1.0e-6, 7.0e-5});
+  Check("CosTurns", TIERED(fastmath::CosTurns<T>(x)),
+        [](double x) { return cos(2.0 * M_PI * x); }, -4.0f, 4.0f, false,
+        {1.0e-6, 7.0e-5});
+  Check("Tanh", TIERED(fastmath::Tanh<T>(x)), [](double x) { return tanh(x); },
+        -10.0f, 10.0f, false, {2.0e-7, 2.4e-2});
+  Check("InvSqrt", TIERED(fastmath::InvSqrt<T>(x)),
+        [](double x) { return 1.0 / sqrt(x); }, 1.0e-3f, 1.0e3f, true,
+        {1.0e-7, 1.8e-3});
+  Check("Sqrt", TIERED(fastmath::Sqrt<T>(x)),
+        [](double x) { return sqrt(x); }, 1.0e-3f, 1.0e3f, true,
+        {1.0e-7, 1.0e-7});
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
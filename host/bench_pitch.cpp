@@ -0,0 +1,225 @@
+// Shimmer pitch shifters: the FFT kernel and both engines
+//
+// RealFft<10> (the phase vocoder's transform) is checked against a direct DFT
+// in double and through a forward/inverse round trip, and timed per
+// transform pair. Then daisysp::PitchShifter and PhaseVocoder shift sines by
+// the shimmer's intervals at the loop rate; each result is fitted to a sine
+// at the target frequency and the residual gives the tone purity in dB. The
+// vocoder runs at three frame sizes, so its cost can be read at the purity
+// the delay shifter reaches; the shimmer's size (1024) must be at least as
+// clean as the delay shifter on every case and above kPurityBound.
+//
+// PitchShifter comes from DAISYSP_DIR: its cost and purity only mean
+// something against the real DaisySP, not a reduced stand-in.
+#include "../PhaseVocoder.h"
+#include "../RealFft.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+#include "daisysp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace daisysp;
+
+namespace {
+
+constexpr float kLoopRate = 24000.0f; // Shimmer loop at 48 kHz / 2
+constexpr int kLog2Size = 10; // The shimmer's vocoder frame
+constexpr size_t kSize = RealFft<kLog2Size>::kSize;
+constexpr double kForwardBound = 1.0e-5;   // Of the largest bin
+constexpr double kRoundTripBound = 1.0e-5; // Of the largest sample
+constexpr int kFftReps = 2000;
+constexpr size_t kBlock = 32; // One loop frame
+constexpr int kShiftSeconds = 4;
+constexpr int kSettleSeconds = 1; // Skipped before the purity fit
+constexpr double kPurityBound = 30.0; // dB, vocoder
+
+RealFft<kLog2Size> fft;
+PitchShifter delay_shifter;
+
+int failures = 0;
+
+void Check(const char *what, double value, double bound, bool below) {
+  bool ok = below ? value <= bound : value >= bound;
+  failures += !ok;
+  printf("%-34s %10.3g (%s %.3g) %s\n", what, value, below ? "<=" : ">=",
+         bound, ok ? "ok" : "FAIL");
+}
+
+void BenchKernel() {
+  std::vector<float> x(kSize), data(kSize + 2);
+  srand(1);
+  for (size_t i = 0; i < kSize; i++)
+    x[i] = (float)rand() / RAND_MAX - 0.5f;
+
+  // Forward vs a direct DFT
+  for (size_t i = 0; i < kSize; i++)
+    data[i] = x[i];
+  fft.Forward(data.data());
+  double worst = 0.0, peak = 0.0;
+  for (size_t k = 0; k <= kSize / 2; k++) {
+    double re = 0.0, im = 0.0;
+    for (size_t n = 0; n < kSize; n++) {
+      double w = 2.0 * M_PI * (double)((k * n) % kSize) / kSize;
+      re += x[n] * cos(w);
+      im -= x[n] * sin(w);
+    }
+    double err = hypot(re - data[2 * k], im - data[2 * k + 1]);
+    worst = err > worst ? err : worst;
+    double mag = hypot(re, im);
+    peak = mag > peak ? mag : peak;
+  }
+  Check("forward vs DFT, relative", worst / peak, kForwardBound, true);
+
+  // Round trip: the inverse scales by kSize / 2
+  fft.Inverse(data.data());
+  worst = 0.0;
+  peak = 0.0;
+  for (size_t i = 0; i < kSize; i++) {
+    double err = fabs(data[i] / (kSize / 2.0) - x[i]);
+    worst = err > worst ? err : worst;
+    peak = fabs(x[i]) > peak ? fabs(x[i]) : peak;
+  }
+  Check("round trip, relative", worst / peak, kRoundTripBound, true);
+
+  // Best of several runs of kFftReps transform pairs
+  double best = 1.0e30;
+  for (int run = 0; run < 10; run++) {
+    for (size_t i = 0; i < kSize; i++)
+      data[i] = x[i];
+    uint64_t t0 = NowNs();
+    for (int r = 0; r < kFftReps; r++) {
+      fft.Forward(data.data());
+      fft.Inverse(data.data());
+      for (size_t i = 0; i < kSize; i++) // Keep the level bounded
+        data[i] *= 2.0f / kSize;
+      DoNotOptimize(data[0]);
+    }
+    double ns = (double)(NowNs() - t0) / kFftReps;
+    best = ns < best ? ns : best;
+  }
+  printf("%zu-point real FFT, forward + inverse: %.0f ns (%.1f ns per "
+         "sample at a hop of %zu)\n",
+         kSize, best, best / (kSize / 4), kSize / 4);
+}
+
+// Residual after a least-squares fit of a sine at `freq`, dB below the
+// signal
+double PurityDb(const std::vector<float> &y, size_t from, float freq) {
+  double cc = 0.0, ss = 0.0, cs = 0.0, yc = 0.0, ys = 0.0, yy = 0.0;
+  for (size_t i = from; i < y.size(); i++) {
+    double w = 2.0 * M_PI * freq / kLoopRate * (double)i;
+    double c = cos(w), s = sin(w);
+    cc += c * c;
+    ss += s * s;
+    cs += c * s;
+    yc += y[i] * c;
+    ys += y[i] * s;
+    yy += (double)y[i] * y[i];
+  }
+  double det = cc * ss - cs * cs;
+  double a = (yc * ss - ys * cs) / det;
+  double b = (ys * cc - yc * cs) / det;
+  double fit = a * yc + b * ys; // Energy of the fitted sine
+  double residual = yy - fit;
+  if (!(yy > 0.0) || !std::isfinite(yy))
+    return -INFINITY;
+  return 10.0 * log10(fit / (residual > 1.0e-30 ? residual : 1.0e-30));
+}
+
+struct Result {
+  double ns;
+  double purity;
+};
+
+// Shift a sine of `freq` by `semitones` through `process` (in place blocks)
+template <typename F> Result Shift(float freq, float semitones, F process) {
+  size_t n = (size_t)(kShiftSeconds * kLoopRate);
+  n -= n % kBlock;
+  std::vector<float> y(n);
+  for (size_t i = 0; i < n; i++)
+    y[i] = 0.5f * sinf((float)(2.0 * M_PI * freq / kLoopRate * (double)i));
+  uint64_t t0 = NowNs();
+  for (size_t i = 0; i < n; i += kBlock)
+    process(&y[i], kBlock);
+  double ns = (double)(NowNs() - t0) / n;
+  float target = freq * powf(2.0f, semitones / 12.0f);
+  return {ns, PurityDb(y, (size_t)(kSettleSeconds * kLoopRate), target)};
+}
+
+// Vocoder at 2^kLog2 points on one case
+template <int kLog2> Result ShiftVocoder(float freq, float semitones) {
+  static PhaseVocoder<kLog2> v;
+  v.Init(kLoopRate);
+  v.SetTransposition(semitones);
+  return Shift(freq, semitones,
+               [](float *x, size_t size) { v.ProcessBlock(x, size); });
+}
+
+void BenchShifters() {
+  struct Case {
+    float freq;
+    float semitones;
+  };
+  static const Case kCases[] = {
+      {220.0f, 12.0f}, {440.0f, 12.0f}, {440.0f, 7.0f},
+      {1000.0f, 7.0f}, {440.0f, -12.0f}, {1000.0f, -12.0f},
+  };
+  constexpr size_t kCaseCount = sizeof(kCases) / sizeof(kCases[0]);
+  constexpr int kSizes = 3; // Vocoder frames of 256, 512 and 1024 points
+  printf("\nShift of a sine at %.0f Hz, per mono shifter: ns per sample "
+         "and tone purity\n",
+         kLoopRate);
+  printf("%6s %5s | %17s | %17s | %17s | %17s\n", "freq", "semi",
+         "PitchShifter", "vocoder 256", "vocoder 512", "vocoder 1024");
+  double delay_ns = 0.0, vocoder_ns[kSizes] = {};
+  bool equal[kSizes] = {true, true, true}; // At least the delay's purity
+  for (const Case &c : kCases) {
+    delay_shifter.Init(kLoopRate);
+    delay_shifter.SetTransposition(c.semitones);
+    Result d = Shift(c.freq, c.semitones, [](float *x, size_t size) {
+      for (size_t i = 0; i < size; i++)
+        x[i] = delay_shifter.Process(x[i]);
+    });
+    Result v[kSizes] = {ShiftVocoder<8>(c.freq, c.semitones),
+                        ShiftVocoder<9>(c.freq, c.semitones),
+                        ShiftVocoder<10>(c.freq, c.semitones)};
+    printf("%6.0f %+5.0f | %5.1f ns %5.1f dB", c.freq, c.semitones, d.ns,
+           d.purity);
+    delay_ns += d.ns;
+    for (int k = 0; k < kSizes; k++) {
+      printf(" | %5.1f ns %5.1f dB", v[k].ns, v[k].purity);
+      vocoder_ns[k] += v[k].ns;
+      equal[k] = equal[k] && v[k].purity >= d.purity;
+    }
+    printf("\n");
+    // The shimmer's size must stay clean and beat the delay shifter
+    bool ok = v[kSizes - 1].purity >= kPurityBound && equal[kSizes - 1];
+    failures += !ok;
+    if (!ok)
+      printf("  vocoder 1024 below %.0f dB or below PitchShifter: FAIL\n",
+             kPurityBound);
+  }
+  for (int k = 0; k < kSizes; k++)
+    printf("vocoder %4d: x%.2f PitchShifter's cost, %s its purity on all %zu "
+           "cases\n",
+           256 << k, vocoder_ns[k] / delay_ns, equal[k] ? "at least" : "below",
+           kCaseCount);
+  printf("memory: PitchShifter %zu B, vocoder 1024 %zu B\n",
+         sizeof(PitchShifter), sizeof(PhaseVocoder<10>));
+}
+
+} // namespace
+
+int BenchPitch() {
+  failures = 0;
+  fft.Init();
+  BenchKernel();
+  BenchShifters();
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
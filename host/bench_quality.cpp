@@ -0,0 +1,236 @@
+// Quality governor: reactions to load patterns, and what each level saves
+//
+// QualityGovernor is fed synthetic window maxima (as BlockLoadHistogram
+// publishes them) and must: step down under sustained overload, one level
+// per kDownWindows windows plus the settle window; ignore a single long
+// block; step back up only after kHoldWindows calm windows; stay put inside
+// the band between the two thresholds; and, when a level that fits keeps
+// being left for one that does not, back off so that the level changes
+// grow rarer. Then every mode renders at each of its quality levels: the
+// cost per block, against full quality.
+#include "../MemoryBudget.h"
+#include "../ModeConvolution.h"
+#include "../ModeFilterDrive.h"
+#include "../ModeShepardTone.h"
+#include "../ModeShimmerReverb.h"
+#include "../ModeSpaceEcho.h"
+#include "../QualityGovernor.h"
+#include "../ReverbService.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = memory_budget::kNominalSampleRate;
+constexpr int kLevels = 4;     // Of the governor under test
+constexpr int kModeLevels = 4; // Most of any mode (table columns)
+constexpr int kBackoffWindows = 2000; // ~1 min of 48-sample blocks
+constexpr int kMaxBackoffSteps = 16;  // Without backoff: ~110
+constexpr size_t kBlockSize = 48;
+constexpr int kWarmBlocks = 200;
+constexpr int kTimedBlocks = 4000;
+
+int failures = 0;
+
+ReverbSc reverb_sc;
+PlateReverb reverb_plate;
+ReverbService reverb;
+ModeFilterDrive mode_filter;
+ModeSpaceEcho mode_echo;
+ModeShimmerReverb mode_shimmer;
+ModeShepardTone mode_shepard;
+ModeConvolution mode_convolution;
+
+void Report(const char *name, bool ok, const char *detail) {
+  printf("%-28s %-40s %s\n", name, detail, ok ? "ok" : "FAIL");
+  failures += !ok;
+}
+
+// Windows until `governor` first reaches `level` under `load`, at most
+// `limit`; the governor is left there
+template <typename Load>
+int WindowsTo(QualityGovernor &governor, int level, int limit, Load load) {
+  for (int w = 1; w <= limit; w++) {
+    governor.Update(load(governor.Level()));
+    if (governor.Level() == level)
+      return w;
+  }
+  return -1;
+}
+
+void CheckGovernor() {
+  char detail[64];
+  QualityGovernor g;
+
+  // Sustained overload: kDownWindows per level, plus a settle window after
+  // every change but the last
+  g.Reset(kLevels);
+  int w = WindowsTo(g, kLevels - 1, 100, [](int) { return 0.95f; });
+  int expected = (kLevels - 1) * (QualityGovernor::kDownWindows + 1) - 1;
+  snprintf(detail, sizeof(detail), "level %d after %d windows (expect %d)",
+           g.Level(), w, expected);
+  Report("sustained overload", w == expected, detail);
+
+  // One long block (a worst-case window) every 10 windows
+  g.Reset(kLevels);
+  int changes = 0;
+  for (int i = 0; i < 1000; i++)
+    changes += g.Update(i % 10 == 0 ? 2.0f : 0.3f);
+  snprintf(detail, sizeof(detail), "%d level changes in 1000 windows",
+           changes);
+  Report("isolated spikes", changes == 0, detail);
+
+  // Between the thresholds, from a cheaper level: nothing moves
+  g.Reset(kLevels);
+  WindowsTo(g, 2, 100, [](int) { return 0.95f; });
+  changes = 0;
+  for (int i = 0; i < 1000; i++)
+    changes += g.Update(i & 1 ? 0.62f : 0.84f);
+  snprintf(detail, sizeof(detail), "%d level changes in 1000 windows",
+           changes);
+  Report("load inside the band", changes == 0, detail);
+
+  // Recovery: one level per hold once the load drops
+  // (the band windows above already settled the last step down)
+  w = WindowsTo(g, 1, 1000, [](int) { return 0.3f; });
+  expected = QualityGovernor::kHoldWindows;
+  int w2 = WindowsTo(g, 0, 1000, [](int) { return 0.3f; });
+  int expected2 = 1 + QualityGovernor::kHoldWindows; // Settle window first
+  snprintf(detail, sizeof(detail), "up after %d, %d windows (expect %d, %d)",
+           w, w2, expected, expected2);
+  Report("recovery", w == expected && w2 == expected2, detail);
+
+  // Level 0 overloads, level 1 is calm: each retry of level 0 fails, so
+  // the hold doubles up to kMaxHoldWindows
+  g.Reset(kLevels);
+  changes = 0;
+  for (int i = 0; i < kBackoffWindows; i++)
+    changes += g.Update(g.Level() == 0 ? 0.95f : 0.5f);
+  snprintf(detail, sizeof(detail), "%d level changes in %d windows", changes,
+           kBackoffWindows);
+  Report("oscillation backoff", changes <= kMaxBackoffSteps, detail);
+
+  // A pinned level holds whatever the load
+  g.Pin(1);
+  g.Reset(kLevels);
+  changes = 0;
+  for (int i = 0; i < 100; i++)
+    changes += g.Update(i < 50 ? 0.95f : 0.1f);
+  snprintf(detail, sizeof(detail), "level %d, %d changes", g.Level(),
+           changes);
+  Report("pinned", g.Level() == 1 && changes == 0, detail);
+}
+
+// ns per block of `mode` at each of its `levels` quality levels; `init()`
+// brings it up as on activation
+template <typename Mode, typename Init>
+void ModeRow(const char *name, Mode &mode, int levels, Init init) {
+  if (levels > kModeLevels) {
+    printf("%-12s widen the table\n", name);
+    failures++;
+    return;
+  }
+  float in_l[kBlockSize], in_r[kBlockSize];
+  float out_l[kBlockSize], out_r[kBlockSize];
+  double deadline_ns = 1e9 * kBlockSize / kSampleRate;
+  double full_ns = 0.0;
+  printf("%-12s", name);
+  for (int level = 0; level < levels; level++) {
+    if (!init()) {
+      printf(" (arena too small)\n");
+      return;
+    }
+    reverb.Service(); // As the main loop: a quality step may switch engines
+    // Mid panel, a few encoder detents so the encoder-driven sends are on
+    ControlFrame frame;
+    frame.knob_top = frame.knob_bottom = 0.5f;
+    frame.sw_left = frame.sw_right = 1;
+    frame.encoder = 8;
+    typename Mode::Controls c;
+    mode.MapControls(frame, c);
+    mode.SetQuality(level);
+    mode.ApplyControls(c);
+
+    uint32_t phase = 0;
+    uint64_t total_ns = 0;
+    for (int b = 0; b < kWarmBlocks + kTimedBlocks; b++) {
+      for (size_t i = 0; i < kBlockSize; i++, phase++) {
+        in_l[i] = 0.5f * sinf(0.031f * phase);
+        in_r[i] = 0.5f * sinf(0.023f * phase);
+      }
+      uint64_t t0 = NowNs();
+      mode.ApplyControls(c);
+      mode.ProcessBlock(in_l, in_r, out_l, out_r, kBlockSize);
+      if (b >= kWarmBlocks)
+        total_ns += NowNs() - t0;
+    }
+    DoNotOptimize(out_l);
+    double ns = (double)total_ns / kTimedBlocks;
+    if (level == 0)
+      full_ns = ns;
+    printf(" %8.0f %5.1f%% %4.0f%%", ns, 100.0 * ns / deadline_ns,
+           100.0 * ns / full_ns);
+  }
+  printf("\n");
+}
+
+} // namespace
+
+int BenchQuality() {
+  failures = 0;
+  CheckGovernor();
+
+  reverb.Init(kSampleRate, &reverb_sc, &reverb_plate);
+  size_t arena_bytes =
+      std::max({ModeSpaceEcho::ArenaBytes(kSampleRate),
+                ModeShimmerReverb::ArenaBytes(kSampleRate),
+                ModeConvolution::ArenaBytes(kSampleRate)});
+  std::vector<char> pool;
+  MemoryArena arena;
+  auto fresh_arena = [&]() -> MemoryArena & {
+    pool.assign(arena_bytes + MemoryArena::kAlignment, 0);
+    arena.Init(pool.data(), pool.size());
+    return arena;
+  };
+
+  printf("\ncost per %zu-sample block at each quality level: ns, share of "
+         "the deadline, share of level 0 (host)\n",
+         kBlockSize);
+  printf("%-12s", "mode");
+  for (int level = 0; level < kModeLevels; level++)
+    printf(" %15s %-5d", "level", level);
+  printf("\n");
+  // The panel ModeRow sets puts the filter on Hard
+  ModeRow("filter", mode_filter,
+          ModeFilterDrive::QualityLevels(ModeFilterDrive::DRIVE_HARD), [&]() {
+            mode_filter.Init(kSampleRate);
+            return true;
+          });
+  ModeRow("echo", mode_echo, ModeSpaceEcho::kQualityLevels, [&]() {
+    return mode_echo.Init(kSampleRate, fresh_arena(), reverb);
+  });
+  ModeRow("shimmer", mode_shimmer, ModeShimmerReverb::kQualityLevels, [&]() {
+    return mode_shimmer.Init(kSampleRate, fresh_arena(), reverb);
+  });
+  ModeRow("shepard", mode_shepard, ModeShepardTone::kQualityLevels, [&]() {
+    mode_shepard.Init(kSampleRate, reverb);
+    return true;
+  });
+  ModeRow("convolution", mode_convolution, ModeConvolution::kQualityLevels,
+          [&]() {
+            if (!mode_convolution.Init(kSampleRate, fresh_arena()))
+              return false;
+            while (!mode_convolution.PrepareStep()) {
+            }
+            return true;
+          });
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+// Reverb engines behind ReverbService: cost per sample and memory
+//
+// Runs noise through ReverbSc (per sample, as the service drives it) and
+// PlateReverb (block kernel, and per sample as inside a feedback loop) at
+// the settings Space Echo uses, and reports the time and, on x86, the TSC
+// cycles per sample with the bytes each engine keeps resident. Both engines
+// are checked for a decaying, finite impulse response, the plate's block
+// kernel against its own per-sample path, and the block kernel must cost
+// less than ReverbSc.
+//
+// ReverbSc comes from DAISYSP_DIR: the comparison only means something
+// against the real DaisySP-LGPL, not a reduced stand-in.
+#include "../MemoryBudget.h"
+#include "../PlateReverb.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LEGIO_HAVE_TSC 1
+#endif
+
+namespace {
+
+constexpr float kSampleRate = memory_budget::kNominalSampleRate;
+constexpr float kFeedback = 0.85f;
+constexpr float kLpFreq = 4000.0f;
+constexpr size_t kBlock = 48;
+constexpr int kTimingBlocks = 5000;  // 5 s
+constexpr int kTimingRuns = 8;      // Best of, against host noise
+constexpr int kTailSeconds = 12;
+constexpr double kTailBoundDb = -40.0; // Last second vs first, after a click
+constexpr double kBlockMismatchBound = 1.0e-3; // Relative to the peak
+
+ReverbSc sc;
+PlateReverb plate;
+PlateReverb plate_ref;
+
+inline uint64_t Cycles() {
+#ifdef LEGIO_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Cost {
+  double ns;
+  double cycles;
+};
+
+// Time of `process(in_l, in_r, out_l, out_r, n)` per sample over noise,
+// best of kTimingRuns
+template <typename F> Cost Measure(F process) {
+  constexpr size_t kNoise = 1 << 16;
+  std::vector<float> in_l(kNoise + kBlock), in_r(kNoise + kBlock);
+  std::vector<float> out_l(kBlock), out_r(kBlock);
+  srand(1);
+  for (size_t i = 0; i < in_l.size(); i++) {
+    in_l[i] = (float)rand() / RAND_MAX - 0.5f;
+    in_r[i] = (float)rand() / RAND_MAX - 0.5f;
+  }
+  float acc = 0.0f;
+  double samples = (double)kTimingBlocks * kBlock;
+  Cost best = {INFINITY, INFINITY};
+  for (int run = 0; run < kTimingRuns; run++) {
+    uint64_t c0 = Cycles();
+    uint64_t t0 = NowNs();
+    for (int b = 0; b < kTimingBlocks; b++) {
+      size_t at = (b * kBlock) % kNoise;
+      process(&in_l[at], &in_r[at], out_l.data(), out_r.data(), kBlock);
+      acc += out_l[0] + out_r[kBlock - 1];
+      DoNotOptimize(acc);
+    }
+    double ns = (double)(NowNs() - t0) / samples;
+    if (ns < best.ns)
+      best = {ns, (double)(Cycles() - c0) / samples};
+  }
+  return best;
+}
+
+// Energy of the last second of a click's tail relative to the first, dB;
+// +inf if the output is not finite or is silent
+template <typename F> double TailDb(F process) {
+  int n = (int)kSampleRate;
+  double first = 0.0, last = 0.0;
+  for (int s = 0; s < kTailSeconds; s++) {
+    double energy = 0.0;
+    for (int i = 0; i < n; i++) {
+      float x = s == 0 && i == 0 ? 1.0f : 0.0f;
+      float l, r;
+      process(x, x, &l, &r);
+      if (!std::isfinite(l) || !std::isfinite(r))
+        return INFINITY;
+      energy += (double)l * l + (double)r * r;
+    }
+    if (s == 0)
+      first = energy;
+    last = energy;
+  }
+  if (first <= 0.0)
+    return INFINITY;
+  return 10.0 * log10(last / first + 1.0e-30);
+}
+
+int failures = 0;
+
+void Report(const char *name, Cost cost, size_t resident, size_t used,
+            double tail_db) {
+  bool ok = tail_db <= kTailBoundDb;
+  failures += !ok;
+  printf("%-16s %6.2f ns", name, cost.ns);
+#ifdef LEGIO_HAVE_TSC
+  printf(" %7.1f cyc", cost.cycles);
+#endif
+  printf(" %5.2f%% of 48k | %7zu B resident, %7zu B used | tail %7.1f dB "
+         "(<= %.0f) %s\n",
+         100.0 * cost.ns * kSampleRate * 1.0e-9, resident, used, tail_db,
+         kTailBoundDb, ok ? "ok" : "FAIL");
+}
+
+} // namespace
+
+int BenchReverb() {
+  failures = 0;
+  printf("Reverb engines at %.0f Hz, feedback %.2f, LP %.0f Hz: cost per "
+         "sample",
+         kSampleRate, kFeedback, kLpFreq);
+#ifdef LEGIO_HAVE_TSC
+  printf(" (time, TSC cycles, share of a sample period)");
+#endif
+  printf(", SDRAM, click tail after %d s\n", kTailSeconds);
+
+  auto init_sc = [] {
+    sc.Init(kSampleRate);
+    sc.SetFeedback(kFeedback);
+    sc.SetLpFreq(kLpFreq);
+  };
+  auto init_plate = [](PlateReverb &p) {
+    p.Init(kSampleRate);
+    p.SetDecay(kFeedback);
+    p.SetLpFreq(kLpFreq);
+  };
+  auto sc_sample = [](float l, float r, float *ol, float *or_) {
+    sc.Process(l, r, ol, or_);
+  };
+  auto plate_sample = [](float l, float r, float *ol, float *or_) {
+    plate.Process(l, r, ol, or_);
+  };
+
+  init_sc();
+  Cost sc_cost = Measure([](const float *l, const float *r, float *ol,
+                            float *or_, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      sc.Process(l[i], r[i], &ol[i], &or_[i]);
+  });
+  init_sc();
+  Report("ReverbSc", sc_cost, sizeof(ReverbSc), sizeof(ReverbSc),
+         TailDb(sc_sample));
+
+  init_plate(plate);
+  Cost plate_cost = Measure([](const float *l, const float *r, float *ol,
+                               float *or_, size_t n) {
+    plate.ProcessBlock(l, r, ol, or_, n);
+  });
+  init_plate(plate);
+  double plate_tail = TailDb(plate_sample);
+  Report("plate block", plate_cost, sizeof(PlateReverb),
+         PlateReverb::UsedBytes(kSampleRate), plate_tail);
+
+  init_plate(plate);
+  Cost plate_sample_cost = Measure([](const float *l, const float *r,
+                                      float *ol, float *or_, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      plate.Process(l[i], r[i], &ol[i], &or_[i]);
+  });
+  Report("plate per sample", plate_sample_cost, sizeof(PlateReverb),
+         PlateReverb::UsedBytes(kSampleRate), plate_tail);
+
+  // Block kernel vs per sample: the same filter, up to the LFO ramped
+  // across each chunk
+  init_plate(plate);
+  init_plate(plate_ref);
+  std::vector<float> in_l(kBlock), in_r(kBlock), out_l(kBlock), out_r(kBlock);
+  double worst = 0.0, peak = 0.0;
+  srand(2);
+  for (int b = 0; b < 2000; b++) {
+    for (size_t i = 0; i < kBlock; i++) {
+      in_l[i] = (float)rand() / RAND_MAX - 0.5f;
+      in_r[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    plate.ProcessBlock(in_l.data(), in_r.data(), out_l.data(), out_r.data(),
+                       kBlock);
+    for (size_t i = 0; i < kBlock; i++) {
+      float l, r;
+      plate_ref.Process(in_l[i], in_r[i], &l, &r);
+      worst = fmax(worst, fmax(fabs((double)l - out_l[i]),
+                               fabs((double)r - out_r[i])));
+      peak = fmax(peak, fmax(fabs((double)l), fabs((double)r)));
+    }
+  }
+  bool match = worst <= kBlockMismatchBound * peak;
+  failures += !match;
+  printf("plate block vs per sample: max diff %.2e of peak %.2f (<= %.0e) "
+         "%s\n",
+         worst, peak, kBlockMismatchBound, match ? "ok" : "FAIL");
+  double ratio = plate_cost.ns / sc_cost.ns;
+  bool cheaper = ratio < 1.0;
+  failures += !cheaper;
+  printf("plate block / ReverbSc cost: x%.2f (< 1) %s\n", ratio,
+         cheaper ? "ok" : "FAIL");
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
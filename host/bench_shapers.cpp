@@ -0,0 +1,148 @@
+// DriveShapers.h table accuracy and speed check
+//
+// Sweeps each drive shaper over (and past) its table range, compares the
+// table lookup with the analytic curve evaluated in double precision, and
+// times it against the analytic float code ModeFilterDrive ran per
+// oversampled sample before the tables. The hard clip has no table: its
+// float formula is checked against the double curve and timed alone.
+#include "../DriveShapers.h"
+#include "../FastMath.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace {
+
+using fastmath::Tier;
+
+constexpr int kErrorPoints = 1000000;
+constexpr int kTimingPoints = 4096;
+constexpr int kTimingRepeats = 512;
+
+// The analytic float versions the tables replace
+float SoftClipAnalytic(float x) {
+  if (x > 1.5f)
+    return 0.85f;
+  if (x < -1.5f)
+    return -0.45f;
+  float pos = x * 0.7f;
+  float neg = x * 0.5f;
+  return x > 0.0f ? pos + (x - pos) * fastmath::Exp<Tier::kAccurate>(-x * x)
+                  : neg + (x - neg) *
+                              fastmath::Exp<Tier::kAccurate>(-x * x * 0.5f);
+}
+
+float WavefoldAnalytic(float x) {
+  if (x > 5.0f)
+    x = 5.0f;
+  if (x < -5.0f)
+    x = -5.0f;
+  if (x > 1.0f)
+    x = 2.0f - x;
+  else if (x < -1.0f)
+    x = -2.0f - x;
+  x *= 1.5f;
+  if (x > 1.0f) {
+    float overshoot = x - 1.0f;
+    x = 1.0f - (overshoot * overshoot * overshoot);
+  } else if (x < -1.0f) {
+    float overshoot = -x - 1.0f;
+    x = -1.0f + (overshoot * overshoot * overshoot);
+  }
+  x *= 1.2f;
+  if (x > 1.0f)
+    x = 2.0f - x;
+  else if (x < -1.0f)
+    x = -2.0f - x;
+  return x * 0.7f;
+}
+
+// Worst error relative to the curve's peak output over the sweep: the
+// wavefolder reaches about +/-36 at the clamp, the other two stay within +/-1
+template <typename F, typename R>
+double MaxError(F fn, R ref, float lo, float hi) {
+  double worst = 0.0, peak = 0.0;
+  for (int i = 0; i < kErrorPoints; i++) {
+    float x = lo + (hi - lo) * (float)i / (float)(kErrorPoints - 1);
+    double r = ref((double)x);
+    double e = fabs((double)fn(x) - r);
+    if (e > worst)
+      worst = e;
+    if (fabs(r) > peak)
+      peak = fabs(r);
+  }
+  return worst / peak;
+}
+
+template <typename F> double NsPerCall(F fn, float lo, float hi) {
+  std::vector<float> xs(kTimingPoints);
+  for (int i = 0; i < kTimingPoints; i++)
+    xs[i] = lo + (hi - lo) * (float)((i * 2654435761u) % kTimingPoints) /
+                     (float)kTimingPoints;
+  float acc = 0.0f;
+  uint64_t t0 = NowNs();
+  for (int r = 0; r < kTimingRepeats; r++) {
+    for (float x : xs)
+      acc += fn(x);
+    DoNotOptimize(acc);
+  }
+  return (double)(NowNs() - t0) / ((double)kTimingPoints * kTimingRepeats);
+}
+
+int failures = 0;
+
+template <typename Table, typename Analytic, typename Ref>
+void Check(const char *name, Table table, Analytic analytic, Ref ref,
+           float lo, float hi, size_t bytes, double bound) {
+  double err_table = MaxError(table, ref, lo, hi);
+  double err_analytic = MaxError(analytic, ref, lo, hi);
+  double ns_table = NsPerCall(table, lo, hi);
+  double ns_analytic = NsPerCall(analytic, lo, hi);
+  bool ok = err_table <= bound;
+  failures += !ok;
+  printf("%-9s %5zu B  table %9.2e (<= %.1e) %s %5.2f ns | analytic "
+         "%9.2e %5.2f ns | x%4.1f\n",
+         name, bytes, err_table, bound, ok ? "ok  " : "FAIL", ns_table,
+         err_analytic, ns_analytic, ns_analytic / ns_table);
+}
+
+// A shaper evaluated from its formula, no table to compare against
+template <typename Analytic, typename Ref>
+void CheckAnalytic(const char *name, Analytic analytic, Ref ref, float lo,
+                   float hi, double bound) {
+  double err = MaxError(analytic, ref, lo, hi);
+  double ns = NsPerCall(analytic, lo, hi);
+  bool ok = err <= bound;
+  failures += !ok;
+  printf("%-9s %5d B  analytic %9.2e (<= %.1e) %s %5.2f ns\n", name, 0, err,
+         bound, ok ? "ok  " : "FAIL", ns);
+}
+
+} // namespace
+
+int BenchShapers() {
+  using namespace drive_shapers;
+  failures = 0;
+  Init();
+  printf("DriveShapers.h: max error vs double curve (relative to peak "
+         "output), cost per call (speedup vs analytic float)\n");
+
+  Check("SoftClip", SoftClip, SoftClipAnalytic,
+        [](double x) {
+          return x > 1.5 ? 0.85 : x < -1.5 ? -0.45 : SoftClipCurve::Eval(x);
+        },
+        -2.0f, 2.0f, sizeof(SoftClipTable), 8.0e-6);
+  CheckAnalytic("Hard", Hard,
+                [](double x) { return x / sqrt(1.0 + x * x); }, -24.0f,
+                24.0f, 1.0e-6);
+  Check("Wavefold", Wavefold, WavefoldAnalytic,
+        [](double x) { return WavefoldCurve::Eval(x); }, -6.0f, 6.0f,
+        sizeof(WavefoldTable), 5.0e-4);
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+// Delay-line storage policies: SNR, cost and SDRAM traffic
+//
+// Each BlockDelayBuffer policy is written with test signals and read back
+// through ReadBlock; the SNR is the signal against the decoding error.
+// Then the echo's access pattern is timed: 64-sample chunks written, each
+// read back by four heads as spans of the chunk plus the modulation swing
+// (ModeSpaceEcho's Med combination). The traffic column is what that
+// pattern moves through SDRAM for both channels at 48 kHz, and the last
+// column the longest loop that fits the memory of the float one.
+#include "../BlockDelayBuffer.h"
+#include "../ModeSpaceEcho.h"
+#include "benchmarks.h"
+#include "host_timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+namespace {
+
+constexpr float kSampleRate = 48000.0f;
+constexpr size_t kChunk = 64;
+constexpr size_t kSpan = 98; // Chunk + modulation swing + Hermite points
+constexpr int kHeads = 4;
+constexpr float kSpacing = 0.3f * kSampleRate;
+constexpr size_t kTestLength = 1 << 16;
+constexpr int kTimingChunks = 20000;
+constexpr float kLoopSeconds = 32.0f; // The echo's Long range
+
+int failures = 0;
+
+float Noise() { return (float)rand() / RAND_MAX - 0.5f; }
+
+// A signal through the line and back, written and read in odd-sized
+// blocks so spans cross the block being collected: SNR in dB
+template <class Storage>
+double Snr(const std::vector<float> &signal) {
+  using Line = BlockDelayBuffer<Storage>;
+  std::vector<typename Line::Block> buf(Line::BufferBlocks(kTestLength));
+  Line line;
+  line.Init(buf.data(), kTestLength);
+  constexpr size_t kDelay = 1000;
+  std::vector<float> back(signal.size());
+  double sig = 0.0, err = 0.0;
+  size_t at = 0;
+  while (at < signal.size()) {
+    size_t n = 1 + (size_t)rand() % 100;
+    if (n > signal.size() - at)
+      n = signal.size() - at;
+    line.WriteBlock(&signal[at], n);
+    at += n;
+    // The last n written, delayed: out[i] is signal[at - kDelay - n + i]
+    if (at >= kDelay + n) {
+      float out[100];
+      line.ReadBlock(out, n, kDelay + n);
+      for (size_t i = 0; i < n; i++) {
+        double x = signal[at - kDelay - n + i];
+        sig += x * x;
+        err += (out[i] - x) * (out[i] - x);
+      }
+    }
+  }
+  return err > 0.0 ? 10.0 * log10(sig / err) : INFINITY;
+}
+
+template <class Storage>
+void Row(const char *name, const std::vector<float> *signals, int count,
+         double min_snr) {
+  using Line = BlockDelayBuffer<Storage>;
+  double bytes = (double)sizeof(typename Line::Block) / Line::kBlock;
+  double worst = INFINITY;
+  printf("%-8s %6.3f", name, bytes);
+  for (int s = 0; s < count; s++) {
+    double snr = Snr<Storage>(signals[s]);
+    worst = fmin(worst, snr);
+    printf(" %8.1f", snr);
+  }
+  bool ok = worst >= min_snr;
+  failures += !ok;
+
+  // The echo's pattern on a loop of its length
+  size_t length = ModeSpaceEcho::DelayLength(kSampleRate);
+  std::vector<typename Line::Block> buf(Line::BufferBlocks(length));
+  Line line;
+  line.Init(buf.data(), length);
+  float in[kChunk], span[kSpan];
+  for (float &v : in)
+    v = Noise();
+  float sink = 0.0f;
+  uint64_t t0 = NowNs();
+  for (int c = 0; c < kTimingChunks; c++)
+    line.WriteBlock(in, kChunk);
+  double write_ns = (double)(NowNs() - t0) / ((double)kTimingChunks * kChunk);
+  t0 = NowNs();
+  for (int c = 0; c < kTimingChunks; c++) {
+    size_t base = 4800 + (size_t)(c % 1000) * 3;
+    for (int h = 0; h < kHeads; h++) {
+      line.ReadBlock(span, kSpan, base + (size_t)(h * kSpacing));
+      sink += span[kSpan / 2];
+    }
+  }
+  double read_ns =
+      (double)(NowNs() - t0) / ((double)kTimingChunks * kHeads * kSpan);
+  DoNotOptimize(sink);
+
+  double traffic =
+      2.0 * kSampleRate * bytes * (1.0 + kHeads * (double)kSpan / kChunk);
+  printf(" %9.2f %9.2f %10.1f %8.1f s  %s\n", write_ns, read_ns,
+         traffic * 1.0e-6, kLoopSeconds * 4.0 / bytes, ok ? "ok" : "FAIL");
+}
+
+} // namespace
+
+int BenchStorage() {
+  failures = 0;
+  srand(1);
+  // Full-scale and -40 dB sines, and noise bursts with sharp attacks and
+  // decays (blocks whose peak is far above most of their samples)
+  constexpr int kSignals = 3;
+  std::vector<float> signals[kSignals];
+  for (auto &s : signals)
+    s.resize(kTestLength);
+  for (size_t i = 0; i < kTestLength; i++) {
+    float phase = 6.2831853f * 440.0f * (float)i / kSampleRate;
+    signals[0][i] = 0.99f * sinf(phase);
+    signals[1][i] = 0.01f * sinf(phase);
+    float env = expf(-(float)(i % 4800) / 300.0f);
+    signals[2][i] = Noise() * 2.0f * env;
+  }
+
+  printf("%-8s %6s %8s %8s %8s %9s %9s %10s %10s\n", "storage", "B/smp",
+         "0 dB", "-40 dB", "bursts", "write ns", "read ns", "echo MB/s",
+         "max loop");
+  printf("%-8s %6s %8s %8s %8s %9s %9s %10s %10s\n", "", "", "SNR dB",
+         "SNR dB", "SNR dB", "/sample", "/sample", "4 heads", "same mem");
+  Row<Float32Storage>("float32", signals, kSignals, INFINITY);
+  Row<Int16BlockStorage>("int16", signals, kSignals, 85.0);
+  Row<Packed24Storage>("packed24", signals, kSignals, 95.0);
+  printf("SNR bounds: float32 exact, int16 >= 85 dB, packed24 >= 95 dB\n");
+
+  printf("%s\n", failures ? "FAILED" : "all bounds met");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Host benchmarks and accuracy checks, run with `legio_host -B <name>`.
+// Each returns 0 on success and non-zero if a documented bound is exceeded.
+
+int BenchMath();
+int BenchOversampling();
+int BenchShapers();
+int BenchFootprint();
+int BenchReverb();
+int BenchPitch();
+int BenchConvolution();
+int BenchEcho();
+int BenchStorage();
+int BenchControls();
+int BenchLoad();
+int BenchQuality();
+
+struct HostBenchmark {
+  const char *name;
+  const char *description;
+  int (*run)();
+};
+
+static const HostBenchmark kHostBenchmarks[] = {
+    {"math", "FastMath.h accuracy vs libm and speed per tier", BenchMath},
+    {"oversampling", "Oversampler.h alias rejection and cost per factor",
+     BenchOversampling},
+    {"shapers", "DriveShapers.h table error vs analytic curves and speed",
+     BenchShapers},
+    {"footprint", "MemoryBudget.h DTCM/SDRAM footprint per mode vs budgets",
+     BenchFootprint},
+    {"reverb", "ReverbSc vs PlateReverb cost per sample, memory and tail",
+     BenchReverb},
+    {"pitch", "RealFft kernel and PhaseVocoder vs PitchShifter cost and purity",
+     BenchPitch},
+    {"convolution", "PartitionedConvolver accuracy and cost per partition count",
+     BenchConvolution},
+    {"echo", "Multi-head tape echo read cost per head, shared vs per-head setup",
+     BenchEcho},
+    {"storage", "BlockDelayBuffer storage policies: SNR, cost and SDRAM traffic",
+     BenchStorage},
+    {"controls", "Control curve tables, knob hysteresis and cost per block",
+     BenchControls},
+    {"load", "Block load histogram percentiles vs exact, cost, NaN recovery",
+     BenchLoad},
+    {"quality", "Quality governor reactions and cost per mode quality level",
+     BenchQuality},
+};
@@ -0,0 +1,118 @@
+#pragma once
+// Host stand-in for libDaisy's DaisyLegio board support.
+//
+// Only the surface used by the firmware is provided: knobs, 3-position
+// switches, the encoder, LEDs and the audio callback types. Control values
+// are set directly by the host harness instead of being scanned from the ADC.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Memory placement attributes are meaningless on the host
+#define DSY_SDRAM_BSS
+#define DTCM_MEM_SECTION
+
+namespace daisy {
+
+class AudioHandle {
+public:
+  typedef const float *const *InputBuffer;
+  typedef float **OutputBuffer;
+  typedef void (*AudioCallback)(InputBuffer in, OutputBuffer out, size_t size);
+};
+
+class System {
+public:
+  static uint32_t GetNow() { return (uint32_t)(GetUs() / 1000); }
+  static uint32_t GetUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+  }
+  static void Delay(uint32_t) {}
+};
+
+class AnalogControl {
+public:
+  float Value() const { return val_; }
+  void Process() {}
+
+  // Host only: set the normalised (0..1) knob position
+  void SetValue(float v) { val_ = v; }
+
+private:
+  float val_ = 0.5f;
+};
+
+class Switch3 {
+public:
+  enum { POS_CENTER = 0, POS_LEFT = 1, POS_UP = 1, POS_RIGHT = 2, POS_DOWN = 2 };
+  int Read() { return pos_; }
+
+  // Host only: force the switch position (0=Bot, 1=Mid, 2=Top)
+  void SetPosition(int pos) { pos_ = pos; }
+
+private:
+  int pos_ = 1;
+};
+
+class Encoder {
+public:
+  void Debounce() {}
+  int32_t Increment() {
+    int32_t inc = pending_;
+    pending_ = 0;
+    return inc;
+  }
+  bool RisingEdge() const { return false; }
+  bool Pressed() const { return false; }
+
+  // Host only: queue detents to be returned by the next Increment()
+  void Turn(int32_t detents) { pending_ += detents; }
+
+private:
+  int32_t pending_ = 0;
+};
+
+class DaisyLegio {
+public:
+  enum LegioLed { LED_LEFT, LED_RIGHT, LED_LAST };
+  enum LegioControl {
+    CONTROL_PITCH,
+    CONTROL_KNOB_TOP,
+    CONTROL_KNOB_BOTTOM,
+    CONTROL_LAST
+  };
+  enum LegioToggle3 { SW_LEFT, SW_RIGHT, SW_LAST };
+
+  void Init(bool boost = false) { (void)boost; }
+  void StartAdc() {}
+  void StopAdc() {}
+  void StartAudio(AudioHandle::AudioCallback cb) { callback_ = cb; }
+  void StopAudio() { callback_ = nullptr; }
+  float AudioSampleRate() { return sample_rate_; }
+  size_t AudioBlockSize() { return block_size_; }
+  void SetAudioBlockSize(size_t size) { block_size_ = size; }
+  void ProcessAnalogControls() {}
+  void ProcessDigitalControls() {}
+  void ProcessAllControls() {}
+  void SetLed(size_t idx, float r, float g, float b) {
+    (void)idx, (void)r, (void)g, (void)b;
+  }
+  void UpdateLeds() {}
+
+  // Host only
+  void SetAudioSampleRate(float sr) { sample_rate_ = sr; }
+
+  Encoder encoder;
+  AnalogControl controls[CONTROL_LAST];
+  Switch3 sw[SW_LAST];
+
+private:
+  AudioHandle::AudioCallback callback_ = nullptr;
+  float sample_rate_ = 48000.0f;
+  size_t block_size_ = 48;
+};
+
+} // namespace daisy
@@ -0,0 +1,15 @@
+#pragma once
+// Monotonic nanosecond clock for host measurements
+#include <stdint.h>
+#include <time.h>
+
+inline uint64_t NowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Keeps the optimiser from discarding benchmark results
+template <typename T> inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
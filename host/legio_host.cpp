@@ -0,0 +1,355 @@
+// LegioDualFX host harness
+//
+// Builds the firmware's modes and AudioCallback output stage against a host
+// stand-in for DaisyLegio, streams a WAV file (or a generated test signal)
+// through each mode one block at a time and reports the cost per sample and
+// per block. `-B <name>` runs one of the standalone benchmarks instead.
+// Build with `make -f Makefile.host`.
+#include "../main.cpp"
+
+#include "benchmarks.h"
+#include "host_timer.h"
+#include "wav_io.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct HostOptions {
+  const char *input = nullptr;
+  const char *output_prefix = nullptr;
+  int mode = -1; // -1 = all
+  size_t block_size = 48;
+  float seconds = 10.0f;
+  float knob_top = 0.5f;
+  float knob_bottom = 0.5f;
+  int sw_left = 1;
+  int sw_right = 1;
+  int encoder = 0;
+  float target_scale = 1.0f; // host time -> target time
+  int quality = 0;           // Pinned quality level, -1 = follows the load
+};
+
+const char *const kModeNames[] = {"filter", "echo", "shimmer", "shepard",
+                                  "convolution"};
+constexpr int kNumModes = sizeof(kModeNames) / sizeof(kModeNames[0]);
+
+// Deterministic stereo test signal: decaying saw plucks over low-level noise
+void GenerateTestSignal(WavData *wav, float seconds) {
+  static const float kNotes[] = {110.0f, 164.8f, 220.0f, 146.8f,
+                                 329.6f, 82.4f,  261.6f, 196.0f};
+  size_t frames = (size_t)(seconds * wav->sample_rate);
+  wav->left.resize(frames);
+  wav->right.resize(frames);
+  size_t note_len = (size_t)(0.5f * wav->sample_rate);
+  uint32_t noise = 22222;
+  float phase = 0.0f;
+  for (size_t i = 0; i < frames; i++) {
+    size_t n = i / note_len;
+    float t = (float)(i % note_len) / wav->sample_rate;
+    float freq = kNotes[n % (sizeof(kNotes) / sizeof(kNotes[0]))];
+    phase += freq / wav->sample_rate;
+    if (phase >= 1.0f)
+      phase -= 1.0f;
+    float env = expf(-6.0f * t);
+    noise = noise * 1103515245 + 12345;
+    float nz = ((float)(noise >> 16) / 32768.0f - 1.0f) * 0.01f;
+    float s = (2.0f * phase - 1.0f) * env * 0.5f;
+    wav->left[i] = s + nz;
+    wav->right[i] = s * 0.8f - nz;
+  }
+}
+
+// Panel state for the main loop to scan
+void SetPanel(const HostOptions &opt) {
+  hw.controls[DaisyLegio::CONTROL_KNOB_TOP].SetValue(opt.knob_top);
+  hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].SetValue(opt.knob_bottom);
+  hw.sw[DaisyLegio::SW_LEFT].SetPosition(opt.sw_left);
+  hw.sw[DaisyLegio::SW_RIGHT].SetPosition(opt.sw_right);
+  hw.encoder.Turn(opt.encoder);
+}
+
+struct RenderStats {
+  double ns_per_sample;
+  double load_avg;
+  double load_p99;
+  double load_max;
+  double load_p999;   // From the firmware's histogram, switch-in included
+  uint32_t misses;    // Blocks over the deadline, likewise
+  double switch_ms;   // Encoder press to fade-in start
+  double activate_us; // Longest main-loop pass while muted for the switch
+  int quality;        // Lowest quality (highest level) the governor chose
+};
+
+// Firmware boot: InitAudio, then time to the first callback
+uint32_t BootToAudio(size_t block_size) {
+  std::vector<float> zero(block_size, 0.0f), out_l(block_size),
+      out_r(block_size);
+  const float *in_bufs[2] = {zero.data(), zero.data()};
+  float *out_bufs[2] = {out_l.data(), out_r.data()};
+  current_mode = MODE_FILTER;
+  audio_started = false;
+  boot_start_us = System::GetUs();
+  InitAudio(hw.AudioSampleRate());
+  AudioCallback(in_bufs, out_bufs, block_size);
+  return boot_to_audio_us;
+}
+
+// Switches from the boot mode to `mode` the way the firmware main loop does,
+// with a free CPU between callbacks (the loop spins while clearing)
+void SwitchTo(int mode, size_t block_size, double deadline_ns,
+              RenderStats *st) {
+  std::vector<float> zero(block_size, 0.0f), out_l(block_size),
+      out_r(block_size);
+  const float *in_bufs[2] = {zero.data(), zero.data()};
+  float *out_bufs[2] = {out_l.data(), out_r.data()};
+
+  uint64_t activate_ns = 0;
+  uint64_t t0 = NowNs();
+  RequestModeSwitch(mode);
+  bool busy = true;
+  while (busy) {
+    ServiceControls();
+    ServiceQuality();
+    uint64_t block_start = NowNs();
+    AudioCallback(in_bufs, out_bufs, block_size);
+    do {
+      bool activating = mode_activating;
+      uint64_t t = NowNs();
+      busy = ServiceModeSwitch();
+      if (activating)
+        activate_ns = std::max<uint64_t>(activate_ns, NowNs() - t);
+    } while ((clearing_next || mode_activating) &&
+             NowNs() - block_start < deadline_ns);
+  }
+  st->switch_ms = (NowNs() - t0) * 1e-6;
+  st->activate_us = activate_ns * 1e-3;
+}
+
+// The firmware's block deadline in host ticks, shrunk by the host -> target
+// scale so its histograms hold target loads
+void ScaleBlockDeadline(const HostOptions &opt) {
+  block_ticks_per_sample /= opt.target_scale;
+}
+
+RenderStats RenderMode(int mode, const HostOptions &opt, const WavData &in,
+                       WavData *out) {
+  RenderStats st = {};
+  double deadline_ns = 1e9 * opt.block_size / in.sample_rate;
+  for (BlockLoadHistogram &h : block_load)
+    h.Reset();
+  current_mode = MODE_FILTER;
+  InitAudio(hw.AudioSampleRate());
+  ScaleBlockDeadline(opt);
+  SwitchTo(mode, opt.block_size, deadline_ns, &st);
+
+  // Render from a freshly initialised mode: boot into the filter (SwitchTo
+  // left current_mode at `mode`) and activate `mode` once
+  current_mode = MODE_FILTER;
+  InitAudio(hw.AudioSampleRate());
+  ScaleBlockDeadline(opt);
+  ActivateMode((FxMode)mode);
+  while (!PrepareModeStep()) {
+  }
+  st.quality = quality_governor.Level();
+  crossfade_vol = 1.0f;
+  SetPanel(opt);
+  ServiceControls(); // Switch reads settle over two main-loop passes
+
+  size_t frames = in.left.size();
+  out->sample_rate = in.sample_rate;
+  out->left.assign(frames, 0.0f);
+  out->right.assign(frames, 0.0f);
+
+  std::vector<double> loads;
+  loads.reserve(frames / opt.block_size + 1);
+  uint64_t total_ns = 0;
+
+  std::vector<float> in_l(opt.block_size), in_r(opt.block_size);
+#ifdef LEGIO_PROFILE
+  profiler::Reset(); // Stage timings of this render only
+#endif
+  for (size_t pos = 0; pos + opt.block_size <= frames;
+       pos += opt.block_size) {
+    // Copy so the callback sees the same non-aliased buffers as on target
+    std::copy_n(&in.left[pos], opt.block_size, in_l.data());
+    std::copy_n(&in.right[pos], opt.block_size, in_r.data());
+    const float *in_bufs[2] = {in_l.data(), in_r.data()};
+    float *out_bufs[2] = {&out->left[pos], &out->right[pos]};
+
+    // Main-loop pass between callbacks, outside the timed region
+    ServiceControls();
+    ServiceQuality();
+    st.quality = std::max(st.quality, quality_governor.Level());
+    uint64_t t0 = NowNs();
+    AudioCallback(in_bufs, out_bufs, opt.block_size);
+    uint64_t dt = NowNs() - t0;
+
+    total_ns += dt;
+    loads.push_back(dt * opt.target_scale / deadline_ns);
+  }
+
+  if (loads.empty())
+    return st;
+  size_t processed = loads.size() * opt.block_size;
+  st.ns_per_sample = (double)total_ns * opt.target_scale / processed;
+  double sum = 0.0;
+  for (double l : loads)
+    sum += l;
+  st.load_avg = sum / loads.size();
+  std::sort(loads.begin(), loads.end());
+  st.load_p99 = loads[(loads.size() - 1) * 99 / 100];
+  st.load_max = loads.back();
+  st.load_p999 = block_load[mode].Percentile(0.999f);
+  st.misses = block_load[mode].Misses();
+  return st;
+}
+
+#ifdef LEGIO_PROFILE
+// Stages timed during the last render (last profiler::kWindow calls each),
+// in target us
+void PrintProfile(const HostOptions &opt) {
+  float us_per_tick = opt.target_scale / profiler::TicksPerUs();
+  for (int i = 0; i < profiler::StageCount(); i++) {
+    profiler::Stats s;
+    if (!profiler::Summarize(i, s))
+      continue;
+    printf("  %-20s %10lu calls %8.2f min %8.2f avg %8.2f p99 %8.2f max us\n",
+           s.name, (unsigned long)s.calls, s.min * us_per_tick,
+           s.avg * us_per_tick, s.p99 * us_per_tick, s.max * us_per_tick);
+  }
+}
+#endif
+
+void PrintUsage(const char *argv0) {
+  printf("usage: %s [options]\n"
+         "  -i FILE    input WAV (16/24/32-bit PCM or float, mono/stereo)\n"
+         "  -o PREFIX  write PREFIX_<mode>.wav for each rendered mode\n"
+         "  -m MODE    filter|echo|shimmer|shepard|convolution|all (default "
+         "all)\n"
+         "  -b N       audio block size in samples (default 48)\n"
+         "  -s SEC     length of the generated test signal (default 10)\n"
+         "  -k T,B     top,bottom knob positions 0..1 (default 0.5,0.5)\n"
+         "  -w L,R     left,right switch positions 0..2 (default 1,1)\n"
+         "  -e N       encoder detents applied before rendering\n"
+         "  -x SCALE   host-to-target time scale for the load estimate\n"
+         "  -q LEVEL   quality level of every mode, or auto to follow the\n"
+         "             (scaled) load as the firmware does (default 0)\n"
+         "  -B NAME    run a benchmark instead of rendering:\n",
+         argv0);
+  for (const HostBenchmark &b : kHostBenchmarks)
+    printf("               %-10s %s\n", b.name, b.description);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  HostOptions opt;
+  int c;
+  while ((c = getopt(argc, argv, "i:o:m:b:s:k:w:e:x:q:B:h")) != -1) {
+    switch (c) {
+    case 'i':
+      opt.input = optarg;
+      break;
+    case 'o':
+      opt.output_prefix = optarg;
+      break;
+    case 'm':
+      opt.mode = -1;
+      for (int m = 0; m < kNumModes; m++)
+        if (!strcmp(optarg, kModeNames[m]))
+          opt.mode = m;
+      if (opt.mode < 0 && strcmp(optarg, "all")) {
+        fprintf(stderr, "unknown mode '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case 'b':
+      opt.block_size = (size_t)atoi(optarg);
+      break;
+    case 's':
+      opt.seconds = (float)atof(optarg);
+      break;
+    case 'k':
+      sscanf(optarg, "%f,%f", &opt.knob_top, &opt.knob_bottom);
+      break;
+    case 'w':
+      sscanf(optarg, "%d,%d", &opt.sw_left, &opt.sw_right);
+      break;
+    case 'e':
+      opt.encoder = atoi(optarg);
+      break;
+    case 'x':
+      opt.target_scale = (float)atof(optarg);
+      break;
+    case 'q':
+      opt.quality = strcmp(optarg, "auto") ? atoi(optarg) : -1;
+      break;
+    case 'B':
+      for (const HostBenchmark &b : kHostBenchmarks)
+        if (!strcmp(optarg, b.name))
+          return b.run();
+      fprintf(stderr, "unknown benchmark '%s'\n", optarg);
+      return 1;
+    default:
+      PrintUsage(argv[0]);
+      return c == 'h' ? 0 : 1;
+    }
+  }
+  if (opt.block_size == 0) {
+    fprintf(stderr, "block size must be > 0\n");
+    return 1;
+  }
+
+  WavData in;
+  if (opt.input) {
+    if (!ReadWav(opt.input, &in)) {
+      fprintf(stderr, "cannot read '%s'\n", opt.input);
+      return 1;
+    }
+  } else {
+    GenerateTestSignal(&in, opt.seconds);
+  }
+  hw.SetAudioSampleRate(in.sample_rate);
+  hw.SetAudioBlockSize(opt.block_size);
+  profiler::Init();
+  quality_governor.Pin(opt.quality);
+
+  printf("%zu frames @ %.0f Hz, block %zu (deadline %.1f us), scale %.2f\n",
+         in.left.size(), in.sample_rate, opt.block_size,
+         1e6 * opt.block_size / in.sample_rate, opt.target_scale);
+  printf("boot-to-audio %u us (InitAudio + first block)\n",
+         BootToAudio(opt.block_size));
+  printf("%-11s %12s %10s %10s %11s %10s %7s %7s %10s %12s\n", "mode",
+         "ns/sample", "load avg", "load p99", "load p99.9", "load max",
+         "misses", "quality", "switch ms", "activate us");
+
+  for (int m = 0; m < kNumModes; m++) {
+    if (opt.mode >= 0 && opt.mode != m)
+      continue;
+    WavData out;
+    RenderStats st = RenderMode(m, opt, in, &out);
+    printf("%-11s %12.1f %9.2f%% %9.2f%% %10.2f%% %9.2f%% %7u %7d %10.1f "
+           "%12.1f\n",
+           kModeNames[m], st.ns_per_sample, 100.0 * st.load_avg,
+           100.0 * st.load_p99, 100.0 * st.load_p999, 100.0 * st.load_max,
+           st.misses, st.quality, st.switch_ms, st.activate_us);
+#ifdef LEGIO_PROFILE
+    PrintProfile(opt);
+#endif
+    if (opt.output_prefix) {
+      char path[512];
+      snprintf(path, sizeof(path), "%s_%s.wav", opt.output_prefix,
+               kModeNames[m]);
+      if (!WriteWav(path, out))
+        fprintf(stderr, "cannot write '%s'\n", path);
+    }
+  }
+  return 0;
+}
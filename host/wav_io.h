@@ -0,0 +1,126 @@
+#pragma once
+// Minimal RIFF/WAVE reader and writer for the host harness.
+//
+// Reads 16/24/32-bit PCM and 32-bit float files (mono or stereo, mono is
+// duplicated to both channels). Writes 32-bit float stereo.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct WavData {
+  float sample_rate = 48000.0f;
+  std::vector<float> left, right;
+};
+
+inline uint32_t WavReadU32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint16_t WavReadU16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+inline bool ReadWav(const char *path, WavData *wav) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  std::vector<uint8_t> bytes;
+  uint8_t chunk[4096];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk + got);
+  fclose(f);
+
+  if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) ||
+      memcmp(&bytes[8], "WAVE", 4))
+    return false;
+
+  uint16_t format = 0, channels = 0, bits = 0;
+  const uint8_t *data = nullptr;
+  size_t data_size = 0;
+  size_t pos = 12;
+  while (pos + 8 <= bytes.size()) {
+    const uint8_t *hdr = &bytes[pos];
+    size_t size = WavReadU32(hdr + 4);
+    size_t avail = bytes.size() - pos - 8;
+    if (size > avail)
+      size = avail;
+    if (!memcmp(hdr, "fmt ", 4) && size >= 16) {
+      format = WavReadU16(hdr + 8);
+      channels = WavReadU16(hdr + 10);
+      wav->sample_rate = (float)WavReadU32(hdr + 12);
+      bits = WavReadU16(hdr + 22);
+      if (format == 0xFFFE && size >= 40) // WAVE_FORMAT_EXTENSIBLE
+        format = WavReadU16(hdr + 32);
+    } else if (!memcmp(hdr, "data", 4)) {
+      data = hdr + 8;
+      data_size = size;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  if (!data || channels < 1 || channels > 2)
+    return false;
+  if (!((format == 1 && (bits == 16 || bits == 24 || bits == 32)) ||
+        (format == 3 && bits == 32)))
+    return false;
+
+  size_t frame_bytes = channels * (bits / 8);
+  size_t frames = data_size / frame_bytes;
+  wav->left.resize(frames);
+  wav->right.resize(frames);
+  for (size_t i = 0; i < frames; i++) {
+    float ch[2] = {0.0f, 0.0f};
+    for (int c = 0; c < channels; c++) {
+      const uint8_t *s = data + i * frame_bytes + c * (bits / 8);
+      if (format == 3) {
+        memcpy(&ch[c], s, 4);
+      } else if (bits == 16) {
+        ch[c] = (int16_t)WavReadU16(s) / 32768.0f;
+      } else if (bits == 24) {
+        int32_t v = (int32_t)((s[0] << 8) | (s[1] << 16) | (s[2] << 24)) >> 8;
+        ch[c] = v / 8388608.0f;
+      } else {
+        ch[c] = (int32_t)WavReadU32(s) / 2147483648.0f;
+      }
+    }
+    wav->left[i] = ch[0];
+    wav->right[i] = channels == 2 ? ch[1] : ch[0];
+  }
+  return true;
+}
+
+inline bool WriteWav(const char *path, const WavData &wav) {
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  uint32_t frames = (uint32_t)wav.left.size();
+  uint32_t data_size = frames * 2 * 4;
+  uint32_t sr = (uint32_t)wav.sample_rate;
+  uint8_t hdr[44];
+  auto put32 = [&](int at, uint32_t v) {
+    for (int i = 0; i < 4; i++)
+      hdr[at + i] = (v >> (8 * i)) & 0xFF;
+  };
+  auto put16 = [&](int at, uint16_t v) {
+    hdr[at] = v & 0xFF;
+    hdr[at + 1] = v >> 8;
+  };
+  memcpy(hdr, "RIFF", 4);
+  put32(4, 36 + data_size);
+  memcpy(hdr + 8, "WAVEfmt ", 8);
+  put32(16, 16);
+  put16(20, 3); // IEEE float
+  put16(22, 2);
+  put32(24, sr);
+  put32(28, sr * 8);
+  put16(32, 8);
+  put16(34, 32);
+  memcpy(hdr + 36, "data", 4);
+  put32(40, data_size);
+  fwrite(hdr, 1, sizeof(hdr), f);
+  for (uint32_t i = 0; i < frames; i++) {
+    float frame[2] = {wav.left[i], wav.right[i]};
+    fwrite(frame, sizeof(float), 2, f);
+  }
+  fclose(f);
+  return true;
+}
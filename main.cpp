@@ -1,38 +1,113 @@
+#include "BlockLoad.h"
+#include "ControlSnapshot.h"
+#include "MemoryArena.h"
+#include "MemoryBudget.h"
+#include "ModeConvolution.h"
 #include "ModeFilterDrive.h"
 #include "ModeShepardTone.h"
 #include "ModeShimmerReverb.h"
 #include "ModeSpaceEcho.h"
+#include "Profiler.h"
+#include "QualityGovernor.h"
+#include "ReverbService.h"
 #include "daisy_legio.h"
 #include "daisysp.h"
 
 using namespace daisy;
 using namespace daisysp;
 
-#include <new>
-
 DaisyLegio hw;
-ModeFilterDrive mode_filter;
-
-// Allocate memory for ModeSpaceEcho in SDRAM
-DSY_SDRAM_BSS char mode_echo_mem[sizeof(ModeSpaceEcho)];
-ModeSpaceEcho *mode_echo;
-
-// Allocate memory for ModeShimmerReverb in SDRAM
-DSY_SDRAM_BSS char mode_shimmer_mem[sizeof(ModeShimmerReverb)];
-ModeShimmerReverb *mode_shimmer;
 
-// Allocate memory for ModeShepardTone in SDRAM
-DSY_SDRAM_BSS char mode_shepard_mem[sizeof(ModeShepardTone)];
-ModeShepardTone *mode_shepard;
-
-enum FxMode { MODE_FILTER, MODE_ECHO, MODE_SHIMMER, MODE_SHEPARD };
+// Hot per-sample state of every mode, resident in DTCM (see MemoryBudget.h)
+ModeFilterDrive mode_filter DTCM_MEM_SECTION;
+ModeSpaceEcho mode_echo DTCM_MEM_SECTION;
+ModeShimmerReverb mode_shimmer DTCM_MEM_SECTION;
+ModeShepardTone mode_shepard DTCM_MEM_SECTION;
+ModeConvolution mode_convolution DTCM_MEM_SECTION;
+
+// SDRAM pool for the bulk buffers of the active mode only, reset on every
+// mode switch
+DSY_SDRAM_BSS char sdram_pool[memory_budget::kSdramArenaBytes];
+MemoryArena sdram_arena;
+
+// One reverb for all modes: engines in SDRAM, send/return service resident
+DSY_SDRAM_BSS ReverbSc reverb_sc;
+DSY_SDRAM_BSS PlateReverb reverb_plate;
+ReverbService reverb DTCM_MEM_SECTION;
+
+// Let the previous mode's reverb tail ring on through a switch; false drops
+// it (and re-initialises the engine on every activation)
+static constexpr bool kReverbTailHandover = true;
+
+enum FxMode {
+  MODE_FILTER,
+  MODE_ECHO,
+  MODE_SHIMMER,
+  MODE_SHEPARD,
+  MODE_CONVOLUTION,
+  MODE_COUNT
+};
 FxMode current_mode = MODE_FILTER;
+float audio_sample_rate;
+
+// Control targets of every mode, published as one snapshot
+struct ModeControls {
+  ModeFilterDrive::Controls filter;
+  ModeSpaceEcho::Controls echo;
+  ModeShimmerReverb::Controls shimmer;
+  ModeShepardTone::Controls shepard;
+  ModeConvolution::Controls convolution;
+  int quality = 0; // Of the current mode (see QualityGovernor.h)
+};
+
+// Main loop -> callback hand-off (see ControlSnapshot.h): the main loop
+// scans the panel, maps it to the current mode's targets and publishes them;
+// the callback only applies the latest snapshot
+ControlFrame control_frame;     // Main loop only
+ModeControls mapped_controls;   // Main loop only: targets being built
+ControlSnapshot<ModeControls> control_snapshot;
+
+// Main loop only: panel conditioning, the frame the published targets were
+// mapped from, and a forced remap (mode activation)
+KnobHysteresis knob_top_hysteresis, knob_bottom_hysteresis;
+SwitchDebounce sw_left_debounce, sw_right_debounce;
+ControlFrame published_frame;
+bool controls_dirty = true;
+
+// Main loop -> callback mode-switch requests
+enum ModeCommand { MODE_COMMAND_FADE_OUT };
+CommandQueue<ModeCommand, 4> mode_commands;
 
 // Global Crossfade Variables
 float crossfade_vol = 1.0f;
-bool switching_mode = false;
+bool switching_mode = false; // Callback only: fading out
 int next_mode = -1;
 
+// Set by the callback once the fade-out is silent; the main loop activates
+// next_mode and clears it
+std::atomic<bool> mode_activating{false};
+
+// Main loop only: a requested switch has not been activated yet, and
+// next_mode's SDRAM share is still being zeroed
+bool switch_pending = false;
+bool clearing_next = false;
+
+// Boot-to-audio time. System::GetUs() counts from the clock bring-up in
+// hw.Init(); the host harness sets its own start.
+uint32_t boot_start_us = 0;
+volatile uint32_t boot_to_audio_us = 0;
+volatile bool audio_started = false;
+
+// Callback execution time per block, by mode (see BlockLoad.h). Kept across
+// InitAudio; the deadline is in profiler clock ticks per sample.
+BlockLoadHistogram block_load[MODE_COUNT];
+float block_ticks_per_sample = 1.0f;
+
+// Main loop only: quality level of the current mode from its block loads,
+// and the load windows it has seen
+QualityGovernor quality_governor;
+uint32_t quality_windows = 0;
+
 // Global Limiters
 Limiter lim_l, lim_r;
 
@@ -43,22 +118,42 @@ float stereo_width = 0.5f; // 0.0 = mono, 0.5 = normal, 1.0 = wide
 static constexpr float kCrossfadeSpeed = 0.006f;
 static constexpr float kCrossfadeThreshold = 0.001f;
 static constexpr float kStereoWidthScale = 1.0f;
+static constexpr size_t kMaxBlockSize = 256;
+static constexpr size_t kClearChunkBytes = 64 * 1024; // Per main-loop pass
 
 // Mode-specific input gains
 static constexpr float kFilterInputGain = 1.0f;
 static constexpr float kEchoInputGain = 1.2f;
 static constexpr float kShimmerInputGain = 1.0f;
 static constexpr float kShepardInputGain = 0.0f; // Generator, ignore input
+static constexpr float kConvolutionInputGain = 1.0f;
 
 // Mode-specific limiter pregains
 static constexpr float kFilterLimiterGain = 1.3f;
 static constexpr float kEchoLimiterGain = 1.5f;
 static constexpr float kShimmerLimiterGain = 1.2f;
 static constexpr float kShepardLimiterGain = 1.4f;
+static constexpr float kConvolutionLimiterGain = 1.2f;
+
+// Scratch buffers for block processing (input gain applied, pre-widening)
+float mode_in_l[kMaxBlockSize], mode_in_r[kMaxBlockSize];
+float mode_out_l[kMaxBlockSize], mode_out_r[kMaxBlockSize];
 
 void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out,
                    size_t size) {
-  hw.ProcessAnalogControls();
+  LEGIO_PROFILE_SCOPE("callback");
+  BlockTimer block_timer(block_load[current_mode],
+                         (float)size * block_ticks_per_sample);
+  if (!audio_started) {
+    boot_to_audio_us = System::GetUs() - boot_start_us;
+    audio_started = true;
+  }
+
+  ModeCommand command;
+  while (mode_commands.Pop(command)) {
+    if (command == MODE_COMMAND_FADE_OUT)
+      switching_mode = true; // Start fade out
+  }
 
   // Handle Crossfade Logic with Exponential Curves
   if (switching_mode) {
@@ -66,10 +161,21 @@ void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out,
     crossfade_vol = crossfade_vol * crossfade_vol; // Exponential fade out
     if (crossfade_vol <= kCrossfadeThreshold) {
       crossfade_vol = 0.0f;
-      current_mode = (FxMode)next_mode; // Switch mode when silent
-      switching_mode = false;           // Start fading in
+      switching_mode = false;
+      mode_activating = true; // Switch mode when silent
+    }
+  }
+
+  // The old mode is being torn down: output silence until the new one is up
+  if (mode_activating) {
+    for (size_t i = 0; i < size; i++) {
+      out[0][i] = 0.0f;
+      out[1][i] = 0.0f;
     }
-  } else {
+    return;
+  }
+
+  if (!switching_mode) {
     if (crossfade_vol < 1.0f) {
       crossfade_vol += kCrossfadeSpeed;
       crossfade_vol = sqrtf(crossfade_vol); // Exponential fade in
@@ -78,119 +184,441 @@ void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out,
     }
   }
 
-  // Update Controls based on Mode (once per buffer)
-  if (current_mode == MODE_FILTER) {
-    mode_filter.UpdateControls(hw);
-  } else if (current_mode == MODE_ECHO) {
-    mode_echo->UpdateControls(hw);
-  } else if (current_mode == MODE_SHIMMER) {
-    mode_shimmer->UpdateControls(hw);
-  } else {
-    mode_shepard->UpdateControls(hw);
-  }
-
-  // Get mode-specific parameters (moved outside loop for efficiency)
+  // Apply the latest control targets and get mode-specific parameters (once
+  // per buffer)
+  const ModeControls &controls = control_snapshot.Read();
   float input_gain = kFilterInputGain;
   float limiter_pregain = kFilterLimiterGain;
 
-  if (current_mode == MODE_FILTER) {
-    input_gain = kFilterInputGain;
-    limiter_pregain = kFilterLimiterGain;
-  } else if (current_mode == MODE_ECHO) {
-    input_gain = kEchoInputGain;
-    limiter_pregain = kEchoLimiterGain;
-  } else if (current_mode == MODE_SHIMMER) {
-    input_gain = kShimmerInputGain;
-    limiter_pregain = kShimmerLimiterGain;
-  } else {
-    input_gain = kShepardInputGain;
-    limiter_pregain = kShepardLimiterGain;
-  }
-
-  // Process Audio Block
-  for (size_t i = 0; i < size; i++) {
-    float in_l = in[0][i] * input_gain;
-    float in_r = in[1][i] * input_gain;
-
-    float out_l, out_r;
-
-    // Process based on current mode
-    if (current_mode == MODE_FILTER) {
-      mode_filter.Process(in_l, in_r, &out_l, &out_r);
-    } else if (current_mode == MODE_ECHO) {
-      mode_echo->Process(in_l, in_r, &out_l, &out_r);
-    } else if (current_mode == MODE_SHIMMER) {
-      mode_shimmer->Process(in_l, in_r, &out_l, &out_r);
-    } else {
-      mode_shepard->Process(in_l, in_r, &out_l, &out_r);
+  {
+    LEGIO_PROFILE_SCOPE("callback/controls");
+    switch (current_mode) {
+    case MODE_FILTER:
+      mode_filter.SetQuality(controls.quality);
+      mode_filter.ApplyControls(controls.filter);
+      input_gain = kFilterInputGain;
+      limiter_pregain = kFilterLimiterGain;
+      break;
+    case MODE_ECHO:
+      mode_echo.SetQuality(controls.quality);
+      mode_echo.ApplyControls(controls.echo);
+      input_gain = kEchoInputGain;
+      limiter_pregain = kEchoLimiterGain;
+      break;
+    case MODE_SHIMMER:
+      mode_shimmer.SetQuality(controls.quality);
+      mode_shimmer.ApplyControls(controls.shimmer);
+      input_gain = kShimmerInputGain;
+      limiter_pregain = kShimmerLimiterGain;
+      break;
+    case MODE_CONVOLUTION:
+      mode_convolution.SetQuality(controls.quality);
+      mode_convolution.ApplyControls(controls.convolution);
+      input_gain = kConvolutionInputGain;
+      limiter_pregain = kConvolutionLimiterGain;
+      break;
+    default:
+      mode_shepard.SetQuality(controls.quality);
+      mode_shepard.ApplyControls(controls.shepard);
+      input_gain = kShepardInputGain;
+      limiter_pregain = kShepardLimiterGain;
+      break;
     }
+  }
+
+  const float side_gain = kStereoWidthScale + stereo_width;
 
-    // Stereo Widening (Mid/Side Processing)
-    float mid = (out_l + out_r) * 0.5f;
-    float side = (out_l - out_r) * 0.5f;
+  // Process Audio Block (in chunks that fit the scratch buffers)
+  for (size_t offset = 0; offset < size; offset += kMaxBlockSize) {
+    size_t n = size - offset;
+    if (n > kMaxBlockSize)
+      n = kMaxBlockSize;
 
-    // Apply width control (0.0 = mono, 0.5 = normal, 1.0 = wide)
-    side *= (kStereoWidthScale + stereo_width);
+    for (size_t i = 0; i < n; i++) {
+      mode_in_l[i] = in[0][offset + i] * input_gain;
+      mode_in_r[i] = in[1][offset + i] * input_gain;
+    }
 
-    out_l = mid + side;
-    out_r = mid - side;
+    // Dispatch once per buffer
+    switch (current_mode) {
+    case MODE_FILTER:
+      mode_filter.ProcessBlock(mode_in_l, mode_in_r, mode_out_l, mode_out_r, n);
+      reverb.Drain(mode_out_l, mode_out_r, n); // No reverb: let a tail out
+      break;
+    case MODE_ECHO:
+      mode_echo.ProcessBlock(mode_in_l, mode_in_r, mode_out_l, mode_out_r, n);
+      break;
+    case MODE_SHIMMER:
+      mode_shimmer.ProcessBlock(mode_in_l, mode_in_r, mode_out_l, mode_out_r,
+                                 n);
+      break;
+    case MODE_CONVOLUTION:
+      mode_convolution.ProcessBlock(mode_in_l, mode_in_r, mode_out_l,
+                                    mode_out_r, n);
+      reverb.Drain(mode_out_l, mode_out_r, n); // Own reverb: let a tail out
+      break;
+    default:
+      mode_shepard.ProcessBlock(mode_in_l, mode_in_r, mode_out_l, mode_out_r,
+                                 n);
+      break;
+    }
 
-    // Apply Crossfade Volume
-    out[0][i] = out_l * crossfade_vol;
-    out[1][i] = out_r * crossfade_vol;
+    float *out_l = out[0] + offset;
+    float *out_r = out[1] + offset;
+    {
+      LEGIO_PROFILE_SCOPE("callback/widen");
+      for (size_t i = 0; i < n; i++) {
+        // Stereo Widening (Mid/Side Processing)
+        float mid = (mode_out_l[i] + mode_out_r[i]) * 0.5f;
+        float side = (mode_out_l[i] - mode_out_r[i]) * 0.5f;
+
+        // Apply width control (0.0 = mono, 0.5 = normal, 1.0 = wide)
+        side *= side_gain;
+
+        // Apply Crossfade Volume
+        out_l[i] = (mid + side) * crossfade_vol;
+        out_r[i] = (mid - side) * crossfade_vol;
+      }
+    }
   }
 
   // Adaptive Output Limiters (applied once per buffer)
-  lim_l.ProcessBlock(out[0], size, limiter_pregain);
-  lim_r.ProcessBlock(out[1], size, limiter_pregain);
+  {
+    LEGIO_PROFILE_SCOPE("callback/limiter");
+    lim_l.ProcessBlock(out[0], size, limiter_pregain);
+    lim_r.ProcessBlock(out[1], size, limiter_pregain);
+  }
 }
 
-int main(void) {
-  hw.Init();
-  hw.StartAdc();
+// SDRAM a mode takes from the arena at the current sample rate
+size_t ModeArenaBytes(FxMode mode) {
+  switch (mode) {
+  case MODE_FILTER:
+    return 0;
+  case MODE_ECHO:
+    return ModeSpaceEcho::ArenaBytes(audio_sample_rate);
+  case MODE_SHIMMER:
+    return ModeShimmerReverb::ArenaBytes(audio_sample_rate);
+  case MODE_CONVOLUTION:
+    return ModeConvolution::ArenaBytes(audio_sample_rate);
+  default:
+    return 0;
+  }
+}
+
+// Main loop: reads the panel into control_frame. Encoder detents add up
+// until the frame is published.
+void ScanControls() {
+  hw.ProcessAnalogControls();
+  control_frame.knob_top = knob_top_hysteresis.Process(
+      hw.controls[DaisyLegio::CONTROL_KNOB_TOP].Value());
+  control_frame.knob_bottom = knob_bottom_hysteresis.Process(
+      hw.controls[DaisyLegio::CONTROL_KNOB_BOTTOM].Value());
+  control_frame.sw_left =
+      sw_left_debounce.Process(hw.sw[DaisyLegio::SW_LEFT].Read());
+  control_frame.sw_right =
+      sw_right_debounce.Process(hw.sw[DaisyLegio::SW_RIGHT].Read());
+  control_frame.encoder += hw.encoder.Increment();
+}
+
+// Main loop: maps the frame to the current mode's targets and publishes
+// them, unless nothing moved since the last publish. Returns true if it
+// published.
+bool PublishControls() {
+  if (!controls_dirty && control_frame.encoder == 0 &&
+      control_frame.SamePanel(published_frame))
+    return false;
+
+  switch (current_mode) {
+  case MODE_FILTER:
+    mode_filter.MapControls(control_frame, mapped_controls.filter);
+    break;
+  case MODE_ECHO:
+    mode_echo.MapControls(control_frame, mapped_controls.echo);
+    break;
+  case MODE_SHIMMER:
+    mode_shimmer.MapControls(control_frame, mapped_controls.shimmer);
+    break;
+  case MODE_CONVOLUTION:
+    mode_convolution.MapControls(control_frame, mapped_controls.convolution);
+    break;
+  default:
+    mode_shepard.MapControls(control_frame, mapped_controls.shepard);
+    break;
+  }
+  published_frame = control_frame;
+  control_frame.encoder = 0;
+  controls_dirty = false;
+  control_snapshot.Publish(mapped_controls);
+  return true;
+}
 
-  float sample_rate = hw.AudioSampleRate();
+// Call from the main loop, once per pass; true if new targets were published
+bool ServiceControls() {
+  ScanControls();
+  return PublishControls();
+}
+
+// The filter's follow its drive mode, as published
+int ModeQualityLevels(FxMode mode) {
+  switch (mode) {
+  case MODE_FILTER:
+    return ModeFilterDrive::QualityLevels(mapped_controls.filter.drive_mode);
+  case MODE_ECHO:
+    return ModeSpaceEcho::kQualityLevels;
+  case MODE_SHIMMER:
+    return ModeShimmerReverb::kQualityLevels;
+  case MODE_CONVOLUTION:
+    return ModeConvolution::kQualityLevels;
+  default:
+    return ModeShepardTone::kQualityLevels;
+  }
+}
+
+// Full quality (or the pinned level) for the current mode, judged on its
+// loads from here on only
+void ResetQuality() {
+  quality_governor.Reset(ModeQualityLevels(current_mode));
+  quality_windows = block_load[current_mode].Windows();
+  mapped_controls.quality = quality_governor.Level();
+}
+
+// Call from the main loop, once per pass: feeds each completed load window
+// of the current mode to the governor and publishes a new quality level.
+// Returns true if it changed.
+bool ServiceQuality() {
+  // Clears the reverb engine a quality step would switch to
+  reverb.Service();
+
+  // A new set of levels (the filter's drive mode) starts over
+  if (quality_governor.Levels() != ModeQualityLevels(current_mode)) {
+    ResetQuality();
+    controls_dirty = true;
+    PublishControls();
+    return true;
+  }
+
+  uint32_t windows = block_load[current_mode].Windows();
+  if (windows == quality_windows)
+    return false;
+  quality_windows = windows;
+  if (!quality_governor.Update(block_load[current_mode].WindowMax()))
+    return false;
+  mapped_controls.quality = quality_governor.Level();
+  controls_dirty = true;
+  PublishControls();
+  return true;
+}
+
+// Releases the previous mode's SDRAM buffers and initialises `mode` with
+// fresh ones from the arena, then publishes its targets for the panel as it
+// is. Must not run concurrently with its mode's ProcessBlock. Falls back to
+// the filter mode (no SDRAM) if the arena is too small for `mode`.
+bool ActivateMode(FxMode mode) {
+  sdram_arena.Reset();
+  if (!kReverbTailHandover)
+    reverb.Clear();
+
+  bool ok = true;
+  switch (mode) {
+  case MODE_FILTER:
+    break;
+  case MODE_ECHO:
+    ok = mode_echo.Init(audio_sample_rate, sdram_arena, reverb);
+    mapped_controls.echo = ModeSpaceEcho::Controls();
+    break;
+  case MODE_SHIMMER:
+    ok = mode_shimmer.Init(audio_sample_rate, sdram_arena, reverb);
+    mapped_controls.shimmer = ModeShimmerReverb::Controls();
+    break;
+  case MODE_CONVOLUTION:
+    ok = mode_convolution.Init(audio_sample_rate, sdram_arena);
+    mapped_controls.convolution = ModeConvolution::Controls();
+    break;
+  default:
+    mode_shepard.Init(audio_sample_rate, reverb);
+    mapped_controls.shepard = ModeShepardTone::Controls();
+    break;
+  }
+
+  current_mode = ok ? mode : MODE_FILTER;
+
+  ResetQuality();
+
+  controls_dirty = true;
+  PublishControls();
+  return ok;
+}
+
+// Main loop, after ActivateMode: one step of the setup a mode leaves out of
+// its Init (the convolution IRs); true once the mode can run
+bool PrepareModeStep() {
+  if (current_mode == MODE_CONVOLUTION)
+    return mode_convolution.PrepareStep();
+  return true;
+}
+
+// Initialise limiters and the first mode (shared by the firmware and host
+// harness)
+void InitAudio(float sample_rate) {
+  audio_sample_rate = sample_rate;
+  block_ticks_per_sample = profiler::TicksPerUs() * 1.0e6f / sample_rate;
 
   // Init Limiters
   lim_l.Init();
   lim_r.Init();
 
-  // Init Modes
+  // Init Modes: the filter needs no SDRAM, the others get theirs on
+  // activation
   mode_filter.Init(sample_rate);
+  mapped_controls = ModeControls();
+  knob_top_hysteresis.Reset();
+  knob_bottom_hysteresis.Reset();
+  sw_left_debounce.Reset();
+  sw_right_debounce.Reset();
+  ScanControls();
+  sdram_arena.Init(sdram_pool, sizeof(sdram_pool));
+  reverb.Init(sample_rate, &reverb_sc, &reverb_plate);
+  ActivateMode(current_mode);
+  while (!PrepareModeStep()) {
+  }
+}
+
+// Main-loop side of a mode switch. The callback fades the current mode out
+// while the new mode's share of the arena (the end the current mode is not
+// using) is zeroed here in bounded steps; activation then only initialises
+// state, and the rest of the mode's setup (PrepareModeStep) runs one step
+// per pass while the callback stays silent.
+void RequestModeSwitch(int mode) {
+  next_mode = mode;
+  sdram_arena.Prepare(ModeArenaBytes((FxMode)mode));
+  clearing_next = true;
+  switch_pending = true;
+  mode_commands.Push(MODE_COMMAND_FADE_OUT);
+}
+
+// Call from the main loop; returns true while a switch is in progress
+bool ServiceModeSwitch() {
+  if (clearing_next)
+    clearing_next = !sdram_arena.ClearStep(kClearChunkBytes);
+
+  // Bring up the next mode once faded out and cleared, then prepare it
+  if (mode_activating && !clearing_next) {
+    if (switch_pending) {
+      ActivateMode((FxMode)next_mode);
+      switch_pending = false;
+    } else if (PrepareModeStep()) {
+      mode_activating = false; // Callback starts fading in
+    }
+  }
+  return switch_pending || clearing_next || mode_activating;
+}
 
-  // Construct ModeSpaceEcho in SDRAM memory
-  mode_echo = new (mode_echo_mem) ModeSpaceEcho();
-  mode_echo->Init(sample_rate);
+#ifndef LEGIO_HOST
+static constexpr uint32_t kDebugLogMs = 2000; // Serial readout period
+
+#ifdef LEGIO_PROFILE
+// Main loop: prints every stage's timings over USB serial, in CPU cycles,
+// every kDebugLogMs (`make PROFILE=1`)
+void DumpProfile() {
+  static uint32_t last_dump_ms = 0;
+  uint32_t now = System::GetNow();
+  if (now - last_dump_ms < kDebugLogMs)
+    return;
+  last_dump_ms = now;
+  hw.seed.PrintLine("%-20s %8s %8s %8s %8s %8s", "stage (cycles)", "calls",
+                    "min", "avg", "p99", "max");
+  for (int i = 0; i < profiler::StageCount(); i++) {
+    profiler::Stats s;
+    if (profiler::Summarize(i, s))
+      hw.seed.PrintLine("%-20s %8lu %8lu %8lu %8lu %8lu", s.name,
+                        (unsigned long)s.calls, (unsigned long)s.min,
+                        (unsigned long)s.avg, (unsigned long)s.p99,
+                        (unsigned long)s.max);
+  }
+}
+#endif
 
-  // Construct ModeShimmerReverb in SDRAM memory
-  mode_shimmer = new (mode_shimmer_mem) ModeShimmerReverb();
-  mode_shimmer->Init(sample_rate);
+#ifdef LEGIO_LOAD_LOG
+// Percent of the block deadline, rounded up
+static unsigned long LoadPercent(float load) {
+  return (unsigned long)ceilf(load * 100.0f);
+}
 
-  // Construct ModeShepardTone in SDRAM memory
-  mode_shepard = new (mode_shepard_mem) ModeShepardTone();
-  mode_shepard->Init(sample_rate);
+// Main loop: prints each mode's block loads since boot over USB serial
+// every kDebugLogMs (`make LOAD_LOG=1`): tail percentiles, worst block and
+// deadline misses
+void DumpBlockLoad() {
+  static const char *const kModeNames[MODE_COUNT] = {
+      "filter", "echo", "shimmer", "shepard", "convolution"};
+  static uint32_t last_dump_ms = 0;
+  uint32_t now = System::GetNow();
+  if (now - last_dump_ms < kDebugLogMs)
+    return;
+  last_dump_ms = now;
+  float deadline_us = hw.AudioBlockSize() * 1.0e6f / audio_sample_rate;
+  hw.seed.PrintLine("%-12s %10s %6s %6s %6s %6s %8s %8s", "load (%)",
+                    "blocks", "p50", "p99", "p99.9", "max", "max us",
+                    "misses");
+  for (int m = 0; m < MODE_COUNT; m++) {
+    const BlockLoadHistogram &h = block_load[m];
+    if (h.Blocks() == 0)
+      continue;
+    hw.seed.PrintLine("%-12s %10lu %6lu %6lu %6lu %6lu %8lu %8lu",
+                      kModeNames[m], (unsigned long)h.Blocks(),
+                      LoadPercent(h.Percentile(0.5f)),
+                      LoadPercent(h.Percentile(0.99f)),
+                      LoadPercent(h.Percentile(0.999f)),
+                      LoadPercent(h.Max()),
+                      (unsigned long)ceilf(h.Max() * deadline_us),
+                      (unsigned long)h.Misses());
+  }
+}
+#endif
+
+int main(void) {
+  hw.Init();
+  hw.StartAdc();
+
+  // Cycle counter for the block and stage timings
+  profiler::Init();
+
+  // Only the boot mode is initialised here, the rest on first selection
+  InitAudio(hw.AudioSampleRate());
 
   hw.StartAudio(AudioCallback);
 
+#ifdef LEGIO_BOOT_LOG
+  // Boot-to-audio report over USB serial (`make BOOT_LOG=1`)
+  while (!audio_started) {
+  }
+  hw.seed.StartLog(false);
+  hw.seed.PrintLine("boot-to-audio: %lu us", (unsigned long)boot_to_audio_us);
+#elif defined(LEGIO_PROFILE) || defined(LEGIO_LOAD_LOG)
+  hw.seed.StartLog(false);
+#endif
+
   while (1) {
     hw.ProcessDigitalControls();
+    ServiceControls();
+    ServiceQuality();
+
+    bool switch_busy = ServiceModeSwitch();
 
     // Handle Mode Switching (Encoder Press)
     if (hw.encoder.RisingEdge()) {
-      if (!switching_mode) {   // Only switch if not already switching
-        switching_mode = true; // Start fade out
-
+      if (!switch_busy) { // Only switch if not already switching
         // Simple, robust cycling logic
         int next_val = (int)current_mode + 1;
-        if (next_val > 3) {
+        if (next_val >= MODE_COUNT) {
           next_val = 0; // Wrap to start (MODE_FILTER)
         }
-        next_mode = next_val;
+        RequestModeSwitch(next_val);
       }
     }
 
     // Update LEDs
-    int mode_to_display = switching_mode ? next_mode : current_mode;
+    int mode_to_display = switch_busy ? next_mode : current_mode;
 
     if (mode_to_display == MODE_FILTER) {
       hw.SetLed(DaisyLegio::LED_LEFT, 1.0f, 0.0f, 0.0f); // RED
@@ -201,12 +629,25 @@ int main(void) {
     } else if (mode_to_display == MODE_SHIMMER) {
       hw.SetLed(DaisyLegio::LED_LEFT, 1.0f, 1.0f, 1.0f); // WHITE
       hw.SetLed(DaisyLegio::LED_RIGHT, 1.0f, 1.0f, 1.0f);
-    } else {
+    } else if (mode_to_display == MODE_SHEPARD) {
       hw.SetLed(DaisyLegio::LED_LEFT, 0.0f, 1.0f, 1.0f); // CYAN
       hw.SetLed(DaisyLegio::LED_RIGHT, 0.0f, 1.0f, 1.0f);
+    } else {
+      hw.SetLed(DaisyLegio::LED_LEFT, 1.0f, 0.0f, 1.0f); // MAGENTA
+      hw.SetLed(DaisyLegio::LED_RIGHT, 1.0f, 0.0f, 1.0f);
     }
     hw.UpdateLeds();
 
-    System::Delay(1);
+#ifdef LEGIO_PROFILE
+    DumpProfile();
+#endif
+#ifdef LEGIO_LOAD_LOG
+    DumpBlockLoad();
+#endif
+
+    // Spin while clearing so the switch is not paced by the delay
+    if (!clearing_next)
+      System::Delay(1);
   }
 }
+#endif // LEGIO_HOST